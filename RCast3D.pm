@@ -132,6 +132,7 @@ use RCommon;
 use RCommonLoad;
 use RHamilton3D;
 use RCommonPlot3D;
+use RCommonCache;
 
 use constant EPS => 2**(-52);
 my $EPS = EPS;
@@ -243,6 +244,10 @@ $rps->{ambient} = {
         # Set to 1 to include effect of vertical gravity, 0 is no gravity, any value ok.
     dragSpecsNormal          => "24,-1,1",
     dragSpecsAxial           => "1,-1,0.01",
+    dragVariation            => 0,
+        # If positive, the drag on each segment is multiplied by its own random factor, with mean 1 and this standard deviation, drawn once per run.  A crude stand-in for turbulence and other unresolved variation in the flow.
+    dragSeed                 => 1,
+        # Seeds the drag variation draws, so a run can be repeated exactly.
 };
 
 
@@ -270,6 +275,10 @@ $rps->{driver} = {
     driftVelSkewness        => 0,   # Positive is faster later.
 	
 	smoothingOrder			=> 8,
+	smoothingMethod			=> "fourier",
+		# "fourier" fits sines and cosines up to smoothingOrder.  "savgol" is Savitzky-Golay smoothing, with smoothingOrder the polynomial order, for very long tracks.
+	savGolHalfWidth			=> 10,
+		# Points on each side of center in the savgol window.
 	
     showTrackPlot           => 1,
     plotSplines				=> 0,
@@ -295,6 +304,24 @@ $rps->{integration} = {
     eps             => 1.e-6,   # Target error.  Typically 1.e-6.
     
     stepperName     => "msbdf_j",
+    staticStart     => 0,
+        # If set, and no state was loaded from the rod file, the starting rod and line are first brought to rest in static equilibrium under gravity and the holding spring, with the handle in its starting pose, instead of being left to settle during the run.  See Calc_StaticEquilibrium() in RHamilton3D.
+    energyAccounting    => 0,
+        # If set, keep a record of the kinetic and elastic energies and the cumulative work done by damping, drag, the other applied forces and the driver, one row for each stored time.  Saved with the data.
+    streamFile          => '',
+        # If set, each stored row (time, dynams, node and tip coords, and energies if accounting) is also appended to this tab separated file as the run goes, so a crash doesn't lose it.  Relative to the RHex directory.
+    streamSyncSecs      => 5,
+        # Longest time buffered stream rows wait before being written and synced to disk.
+    streamMemoryRows    => 0,
+        # If positive and streaming, keep only the most recent rows in memory, between this many and three times as many, and no longer have the solver return more than this many at a time.  The plot and saved data are read back from the stream at the end.  Memory then stays bounded however long the run, except between release events.  Not used with the run cache.
+    streamResume        => 0,
+        # If set, and streamFile holds an earlier run with the same settings, spec files and code that stopped short of t1, continue it from its last row and append to it, rather than starting over.  Not used with energy accounting, or when there are release events.
+    livePlot            => 0,
+        # If set, while the solver runs a separate window shows the traces as they are computed, so a run that goes bad can be seen and stopped early.  It closes when the run ends, and the usual plot replaces it.
+    livePlotFPS         => 4,
+        # Most times a second the live plot is redrawn.  Redrawing is done by its own gnuplot process and never holds up the solver.
+    runCacheDir         => '',
+        # If set, completed runs are kept in this directory, and a later run with the same settings, spec files and code uses them instead of integrating, or continues from the end of a shorter one.  Not used when there are release events.  Relative to the RHex directory.
     
     showLineVXs     => 0,
     plotLineVYs     => 0,
@@ -304,6 +331,8 @@ $rps->{integration} = {
 
     savePlot    => 1,
     saveData    => 1,
+    saveBinary  => 0,
+        # Also save the data as an .rhb file, which RHexReplot3D can open much faster than the .txt.
 
     debugVerboseName    => "debugVerbose - 4",
 	switchOnSlowing		=> 1,
@@ -606,6 +635,13 @@ sub CheckParams{
         if ($verbose>=1 and ($a<10 or $a>12 or $b<-0.78 or $b>-0.70 or $c<0.01 or $c>1)){print "WARNING: $str = $a,$b,$c - Experiments are unclear, try  1,-1,0.01.  The last value should be much less than the equivalent value in the normal spec.\n"}
     }
 
+    $str = "dragVariation"; $sval = $rps->{ambient}{$str}; $val = eval($sval);
+    if (!looks_like_number($val) or $val < 0){$ok=0; print "ERROR: $str - $sval - Must be non-negative.\n"}
+    elsif($verbose>=1 and $val > 0.5){print "WARNING: $str - $sval - Typical range is [0,0.5].\n"}
+
+    $str = "dragSeed"; $sval = $rps->{ambient}{$str};
+    if (!defined($sval) or $sval !~ /^\d+$/){$ok=0; print "ERROR: $str - ".($sval//'')." - Must be a non-negative integer.\n"}
+
     $str = "angle0Deg"; $sval = $rps->{line}{$str}; $val = eval($sval);
 	if (!looks_like_number($val) or $val <= -180 or $val > 180){$ok=0; print "ERROR: line $str - $sval - Initial line angle must be in the range (-180,180].\n"}
     if($verbose>=1 and ($val < -110 or $val > -70)){print "WARNING: line $str - $sval -90 is horizontal to the left, usual range is [-110,-70].\n"}
@@ -792,6 +828,12 @@ sub CheckParams{
 		elsif($verbose>=1 and ($val < -1 or $val > 1)){print "WARNING: $str - $sval - Zero disables smoothing, higher numbers give closer approximations.\n"}
 	}
 
+    $str = "smoothingMethod"; $sval = $rps->{driver}{$str};
+	if ($sval ne "fourier" and $sval ne "savgol"){$ok=0; print "ERROR: $str - $sval - Must be fourier or savgol.\n"}
+
+    $str = "savGolHalfWidth"; $sval = $rps->{driver}{$str}; $val = eval($sval);
+	if (!looks_like_number($val) or $val<1 or $val != POSIX::floor($val)){$ok=0; print "ERROR: $str - $sval - Must be a positive integer.\n"}
+
     $str = "t0"; $sval = $rps->{integration}{$str}; $val = eval($sval);
 	if (!looks_like_number($val)){$ok=0; print "ERROR: $str - $sval - Must be a numerical value.\n"}
     if($verbose>=1 and ($val != 0)){print "WARNING: $str - $sval - Typical integration start time is 0.\n"}
@@ -812,6 +854,23 @@ sub CheckParams{
     if($verbose>=1 and ($val < 0.01 or $val > 0.10)){print "WARNING: $str - $sval - Intervals at which intergrator results are reported and traces are plotted.  Typical values are in the range [0.010,0.100].\n"}
 	if ($val ne ''){$rps->{integration}{$str} = DecimalRound($val)}
 
+	if ($rps->{integration}{streamFile}){
+		$str = "streamSyncSecs"; $sval = $rps->{integration}{$str}; $val = eval($sval);
+		if (!looks_like_number($val) or $val < 0){$ok=0; print "ERROR: $str - $sval - Must be non-negative.\n"}
+
+		$str = "streamMemoryRows"; $sval = $rps->{integration}{$str}; $val = eval($sval);
+		if (!looks_like_number($val) or ($val and ($val < 2 or POSIX::ceil($val) != $val))){$ok=0; print "ERROR: $str - $sval - Must be 0, or an integer no less than 2.\n"}
+		if ($verbose>=1 and $val and $rps->{integration}{runCacheDir}){print "WARNING: The run cache is not used when keeping only the most recent rows in memory.\n"}
+
+		if ($verbose>=1 and $rps->{integration}{streamResume} and $rps->{integration}{energyAccounting}){print "WARNING: streamResume is not used with energy accounting.\n"}
+	}
+
+	if ($rps->{integration}{livePlot}){
+		$str = "livePlotFPS"; $sval = $rps->{integration}{$str}; $val = eval($sval);
+		if (!looks_like_number($val) or $val <= 0){$ok=0; print "ERROR: $str - $sval - Must be positive.\n"}
+		if ($verbose>=1 and $val > 30){print "WARNING: $str - $sval - Redrawing more often than 30 times a second gains nothing, and may slow the machine.\n"}
+	}
+
 	
     return $ok;
 }
@@ -926,6 +985,7 @@ sub LoadRod {
         	$inData = <INFILE>;
 		}
         close INFILE;
+		my $inIndex = DataStringIndexNew($inData,$rodFile);
 		
 		# Always swap the currently enabled fields to level storage.  This keeps the storage up to date:
 		if ($updatingPanel){
@@ -947,26 +1007,26 @@ sub LoadRod {
 
         # Look for rod params in the file.  If found, overwrite globals or widget fields:
 		# Start with the mandatory fields:
-        $rodLenFt	= GetValueFromDataString($inData,"RodLength","first");
+        $rodLenFt	= GetValueFromDataString($inIndex,"RodLength","first");
         if (!defined($rodLenFt)){$ok = 0; print "ERROR: Unable to find RodLength in $rodFile.\n"; $rodLenFt = "---"}	# Let the user see there's a problem.
  
-        $rodActionLenFt	= GetValueFromDataString($inData,"ActionLength","first");
+        $rodActionLenFt	= GetValueFromDataString($inIndex,"ActionLength","first");
         if (!defined($rodActionLenFt)){$ok = 0; print "ERROR: Unable to find ActionLength in $rodFile.\n"; $rodActionLenFt = "---"}	# Let the user see there's a problem.
 		
         # In order to achieve better reproducibility by avoiding spline fitting when possible, if calculational arrays are available, use them in preference to station data:
             
         # Try to extract a calculated taper (diams) from the file.  These are assumed to be uniformly spaced.
-        $loadedRodDiamsIn = GetMatFromDataString($inData,"Taper","last");
+        $loadedRodDiamsIn = GetMatFromDataString($inIndex,"Taper","last");
 
         if ($loadedRodDiamsIn->isempty) {
 
             # Try to pull a x stations out of the file:
-            my $statXs = GetMatFromDataString($inData,"X_station","first");
+            my $statXs = GetMatFromDataString($inIndex,"X_station","first");
 
             if ($statXs->isempty){$ok = 0; print "Error:  If Taper data is not present in file, then X_station and Taper_station data must be there.\n"}
 
             # Look for the corresponding taper stations:
-            my $statDiams = GetMatFromDataString($inData,"Taper_station","first");
+            my $statDiams = GetMatFromDataString($inIndex,"Taper_station","first");
 
             if ($statDiams->isempty){$ok = 0; print "Error: If Taper data is not present in file, then X_station and Taper_station data must be there.\n"}
             if ($statXs->nelem != $statDiams->nelem){$ok = 0; print "Error: X_station and Taper_station sizes must agree.\n"}
@@ -990,8 +1050,8 @@ sub LoadRod {
 		if ($updatingPanel){
 		
 			# Fields not defined in the file will be enabled, allowing user change:
-			$numPieces		= GetValueFromDataString($inData,"NumPieces","first");
-			$sectionType	= GetWordFromDataString($inData,"SectionType","first");
+			$numPieces		= GetValueFromDataString($inIndex,"NumPieces","first");
+			$sectionType	= GetWordFromDataString($inIndex,"SectionType","first");
 			if (defined($sectionType)){
 				if ($sectionType ne "hex" and $sectionType ne "round"){
 					print "Error: Unknown section type ($sectionType).  Setting section type to hex.\n";
@@ -1005,45 +1065,45 @@ sub LoadRod {
 			$tipDiam	= ($loadedRodDiamsIn->isempty) ? "---" :
 									sprintf("%.3f",sclr($loadedRodDiamsIn(-1)));
 			
-			$zeroFiberThickness	= GetValueFromDataString($inData,"ZeroFiberThickness","first");
+			$zeroFiberThickness	= GetValueFromDataString($inIndex,"ZeroFiberThickness","first");
 			$maxWallThickness	=
-				GetValueFromDataString($inData,"MaximumWallThickness","first");
+				GetValueFromDataString($inIndex,"MaximumWallThickness","first");
 			$ferruleKsMult		=
-				GetValueFromDataString($inData,"FerruleKsMultiplier","first");
-			$density        = GetValueFromDataString($inData,"Density","first");
-			$elasticModulus	= GetValueFromDataString($inData,"ElasticModulus","first");
+				GetValueFromDataString($inIndex,"FerruleKsMultiplier","first");
+			$density        = GetValueFromDataString($inIndex,"Density","first");
+			$elasticModulus	= GetValueFromDataString($inIndex,"ElasticModulus","first");
 			$dampingModulusStretch	=
-				GetValueFromDataString($inData,"DampingModulusStretch","first");
+				GetValueFromDataString($inIndex,"DampingModulusStretch","first");
 			$dampingModulusBend		=
-				GetValueFromDataString($inData,"DampingModulusBend","first");
+				GetValueFromDataString($inIndex,"DampingModulusBend","first");
 		}
  
 
 		if (!$updatingPanel){	# So running.
 			
 			# Look for integration state data in the file.  If found, use it in preference to anything else.  Expected to be used for the continuation of a previous integration.  To make sense of this, at least numRodNodes, numLineNodes, and segLens must be also preserved and read in.
-			$loadedState = GetMatFromDataString($inData,"State","last");
+			$loadedState = GetMatFromDataString($inIndex,"State","last");
 			if (!$loadedState->isempty) { # the state was loaded.
 
-				$loadedRodSegLens    = GetMatFromDataString($inData,"RodSegLengths");
-				$loadedLineSegLens   = GetMatFromDataString($inData,"LineSegLengths");
+				$loadedRodSegLens    = GetMatFromDataString($inIndex,"RodSegLengths");
+				$loadedLineSegLens   = GetMatFromDataString($inIndex,"LineSegLengths");
 				
-				$loadedT0 = GetMatFromDataString($inData,"Time");
+				$loadedT0 = GetMatFromDataString($inIndex,"Time");
 				pq($loadedT0);
 
 			} else {	# No loaded state, see if there is offset or flex data:
 
-				$dXs = GetMatFromDataString($inData,"DX");
+				$dXs = GetMatFromDataString($inIndex,"DX");
 
 				if (!$dXs->isempty){  # Got DX
 
-					$dZs = GetMatFromDataString($inData,"DZ");
+					$dZs = GetMatFromDataString($inIndex,"DZ");
 
 					if (!$dZs->isempty){	# Got DZ
 					
 						if ($dXs->nelem != $dZs->nelem){$ok = 0; print "Error:  If DX is present, so must be DZ, and their sizes must be equal.\n"}
 						else {
-							$dYs = GetMatFromDataString($inData,"DY");
+							$dYs = GetMatFromDataString($inIndex,"DY");
 							
 							if (!$dYs->isempty){	# Got DY
 							
@@ -1064,7 +1124,7 @@ sub LoadRod {
 						
 					} else {	# Got DX but not DZ. Check for 2D setup where there is DY.
 					
-						$dYs = GetMatFromDataString($inData,"DY");
+						$dYs = GetMatFromDataString($inIndex,"DY");
 						
 						if (!$dYs->isempty){	# Got DY
 						
@@ -1087,7 +1147,7 @@ sub LoadRod {
 
 				if (!$gotOffsets and $loadedThetas->isempty){	# Couldn't work with offsets, see if there is a flex array:
 
-					$loadedThetas = GetMatFromDataString($inData,"Flex");
+					$loadedThetas = GetMatFromDataString($inIndex,"Flex");
 					if (!$loadedThetas->isempty and $verbose>=2){print "Thetas set from flex.\n"}
 					
 					# To avoid later confusion, get rid of any offsets we might have gotten:
@@ -1286,7 +1346,7 @@ sub LoadDriver { my $verbose = 1?$verbose:0;
         map {zeros(0)} (0..6);
     ($timeXs,$timeYs,$timeZs) = map {zeros(0)} (0..2);
 
-    # The cast drawing is expected to be in SVG.  See http://www.w3.org/TR/SVG/ for the full protocol.  SVG does 2-DIMENSIONAL drawing only! See the function SVG_matrix() below for the details.  Ditto resplines.
+    # The cast drawing is expected to be in SVG.  See http://www.w3.org/TR/SVG/ for the full protocol.  SVG does 2-DIMENSIONAL drawing only! See the function SVG_ParseTransform() below for the details.  Ditto resplines.
     
 	my $stdPrint = (!$updatingPanel and $verbose>=2) ? 1 : 0;
 
@@ -1839,211 +1899,124 @@ sub SetDriverFromHandleTXT {
 }
 
 
-sub ReadNextLineGroupSVG {
-    my ($inData,$thisIndex,$relativize) = @_;
-    
-    ## For use with SVG files produced by Adobe Illustrator.  Finds the first line group in the data string, then seeks a line object and a text object there.  If found, returns the line segment endpoints and text value.
-	
-	my ($x1,$y1,$x2,$y2) = map {zeros(0)} (0..4);
-	my $text = "";
-	
-    my $label       = "";
-    my $nextIndex   = -1;
-	
-	#pq($inData,$thisIndex);
+sub SVG_ReadElements {
+    my ($inData,$relativize) = @_;
 
-	my $groupStr	= '';
-    my $groupStart	= CORE::index($inData,"<g>",$thisIndex);
-	#pq($groupStart);
-	
-    if ($groupStart != -1){
-        my $groupEnd = CORE::index($inData,"</g>",$groupStart);
-        $nextIndex = $groupEnd + 4;  #??
-		#pq($nextIndex);
-        if ($groupEnd != -1){
-            $groupStr = substr($inData,$groupStart,$nextIndex-$groupStart+1);
-        } else {
-            croak "Detected unended group";
-        }
-	}
-	#pq($groupStr);
-	
-	if ($groupStr ne ""){
-		
-		# Look for and process a line string:
-        if ($groupStr =~
-			m[^\s.*<line.*x1="(.*)" y1="(.*)" x2="(.*)" y2="(.*)".*/>\s.*$]m  ) {
-            $x1 = $1;
-            $y1 = $2;
-            $x2 = $3;
-            $y2 = $4;
-			#pq($x1,$y1,$x2,$y2);
-		}
-		
-		# Look for and process a text string:
-        if ($groupStr =~
-			m[^\s.*<text.*>(.*)</text>\s.*$]m) {
-            $text = $1;
-			#pq($text);
-		}
-	}
+    ## For use with the SVG files produced by Adobe Illustrator and Inkscape.  A single pass over the data string that tracks the group nesting and each group's transform, and collects, as it goes, the line groups (a group holding a line object and a text object) and the paths with their labels.  Returns a hash ref with the line endpoints in the pdls X1s, Y1s, X2s and Y2s, their texts in the array ref lineTexts, all in the drawing's outermost coords, and in paths an array ref of [$Xs,$Ys,$label] for each labeled path, as SVG_PathCoords() returns them.
 
-    return ($x1,$y1,$x2,$y2,$text,$nextIndex);
-}
+    ## Paths are labeled, by a HORRIBLE KLUGE, by a non-black stroke color, whose hex designator is converted to a number and used as the label.  I do this because Inkscape makes copying, moving, and releveling paths with text on them very delicate and tedius.  In contrast, setting a color (base 10, even) is quick and easy.  Failing that, the text of a textPath linked to the path's id is the label.
 
+    my (@X1s,@Y1s,@X2s,@Y2s,@lineTexts);
+    my (@paths,%linkedTexts);
 
-sub ReadNextLabeledPathSVG {
-    my ($inData,$thisIndex,$relativize) = @_;
-    
-    ## Finds the first path in the data string, then seeks a xlink:href="# followed by the path's id.  If successful, returns the path and the linked text.  In any case, resets the data string to after the path.
-    
-    ## Implementing a HORRIBLE KLUGE, this function actually looks for a non-black stoke color, and if it finds one, converts the hex designator to a number, which is returned as the label.  I do this because Inkscape makes copying, moving, and releveling paths with text on them very delicate and tedius.  In contrast, setting a color (base 10, even) is quick and easy.
+    my @groups      = ({transform=>[1,0,0,1,0,0]});     # The document acts as the outermost group.
+    my $textDepth   = 0;
+    my $textPathID;
 
-    my $Xs          = zeros(0);
-    my $Ys          = zeros(0);
-    my $label       = "";    
-    my $nextIndex   = -1;
+    while ($inData =~ m[\G(?:<!--.*?-->|<([/?!]?)([\w:]+)((?:[^>"]|"[^"]*")*)>|([^<]+)|<)]gs){
 
-    my $pathStr = "";
-    my $pathStart = CORE::index($inData,"<path\n",$thisIndex);
-    if ($pathStart != -1){
-        my $pathEnd = CORE::index($inData,"/>\n",$pathStart);
-        $nextIndex = $pathEnd + 2;  #??
-        if ($pathEnd != -1){
-            $pathStr = substr($inData,$pathStart,$nextIndex-$pathStart+1);
-        } else {
-            die "Detected unended path";
-        }
-#pq $pathStr;
-
-        # Look for the stroke designator:
-        my $tStroke   = CORE::index($pathStr,"stroke:#");
-        if ($tStroke != -1){
-#pq $tStroke;
-            my $tColor = substr($pathStr,$tStroke+8,6);
-#pq $tColor;
-            if ($tColor ne "000000"){
-                $label = hex($tColor);
-#pq $tColor;
+        my ($closing,$tag,$attrStr,$chars) = ($1,$2,$3,$4);
+
+        if (defined($chars)){
+            if ($textDepth){$groups[-1]{text} .= $chars}
+            if (defined($textPathID) and !$linkedTexts{$textPathID} and $chars =~ m[\S]){
+                ($linkedTexts{$textPathID} = $chars) =~ s/^\s+|\s+$//g;
             }
+            next;
         }
-        
-        # If not labeled by color, look for a text label linked to the path:
-        if (!$label and $pathStr =~ m[^\s.*id="(.*)"$]m) {  
-            my $pathID = $1;
-#pq $pathID;
-            if ($pathID){
-                my $linkStr = "xlink:href=\"#$pathID\"\n";
-#pq $linkStr;
-                
-                # The text itself always seems to be after the link:
-                my $tStart   = CORE::index($inData,$linkStr);
-                if ($tStart != -1){
-#pq $tStart;
-                    my $tEnd = CORE::index($inData,"</textPath>",$tStart);
-                    my $textPathStr = substr($inData,$tStart,$tEnd-$tStart+11);
-#pq $textPathStr;
-            
-                    # A number of different forms are used to hold the label itself:
-                    $label = XML_LookBefore($textPathStr,"<tspan");
-#print "labelA=$label\n";
-                    if (!$label){
-                        $label = XML_LookBefore($textPathStr,"</tspan>");
-#print "labelB=$label\n";
-                        if (!$label) {
-                            $label = XML_LookBefore($textPathStr,"</textPath>");
-#pq $textPathStr;
-#print "labelC=$label\n";
-                        }
-                    }
+        if (!defined($tag) or $closing eq '?' or $closing eq '!'){next}
+
+        if ($closing eq '/'){
+            if ($tag eq "g" and @groups > 1){
+                my $group = pop @groups;
+                my $text = (defined($group->{text})) ? $group->{text} : "";
+                $text =~ s/^\s+|\s+$//g;
+                if (defined($group->{line}) and $text ne ""){
+                    my ($x1,$y1,$x2,$y2) = @{$group->{line}};
+                    push @X1s,$x1; push @Y1s,$y1; push @X2s,$x2; push @Y2s,$y2;
+                    push @lineTexts,$text;
                 }
             }
+            elsif ($tag eq "text" and $textDepth){$textDepth--}
+            elsif ($tag eq "textPath"){undef $textPathID}
+            next;
         }
-    }
-                        
-    if ($label){
-#pq $label;
-        ($Xs,$Ys) = SVG_ExtractPathCoords($pathStr,$relativize);
 
-    }
-    
-    return ($Xs,$Ys,$label,$nextIndex);
-}
+        my %attrs;
+        while ($attrStr =~ m[([\w:-]+)\s*=\s*"([^"]*)"]g){$attrs{$1} = $2}
+        my $selfClosing = ($attrStr =~ m[/\s*$]);
+        my $transform   = SVG_ComposeTransforms($groups[-1]{transform},SVG_ParseTransform($attrs{transform}));
 
+        if ($tag eq "g"){
+            if (!$selfClosing){push @groups,{transform=>$transform}}
+        }
+        elsif ($tag eq "line"){
+            my ($x1,$y1) = SVG_ApplyTransform($transform,map {(defined($_)) ? $_ : 0} @attrs{qw(x1 y1)});
+            my ($x2,$y2) = SVG_ApplyTransform($transform,map {(defined($_)) ? $_ : 0} @attrs{qw(x2 y2)});
+            $groups[-1]{line} = [$x1,$y1,$x2,$y2];
+        }
+        elsif ($tag eq "text"){
+            if (!$selfClosing){$textDepth++}
+        }
+        elsif ($tag eq "textPath"){
+            my $href = (defined($attrs{"xlink:href"})) ? $attrs{"xlink:href"} : $attrs{href};
+            if (defined($href) and $href =~ m[^#(.+)$] and !$selfClosing){$textPathID = $1}
+        }
+        elsif ($tag eq "path" and defined($attrs{d})){
+            my $stroke = (defined($attrs{style}) and $attrs{style} =~ m[stroke:#(\w{6})]) ? $1 :
+                            (defined($attrs{stroke}) and $attrs{stroke} =~ m[^#(\w{6})$]) ? $1 : "";
+            push @paths,{id=>$attrs{id},stroke=>$stroke,d=>$attrs{d},transform=>$transform};
+        }
+    }
 
-sub XML_LookBefore {
-    my ($inStr,$markerStr) = @_;
-        
-    ## Seek pure text in a string before an XML marker.  Used just to make code reading easier.
-    my $outStr = "";
-    
-    my $tEnd = CORE::index($inStr,$markerStr);
-    if ($tEnd != -1) {
-        my $tStart = CORE::rindex($inStr,">",$tEnd)+1;
-        if ($tEnd-$tStart > 0){
-            $outStr = substr($inStr,$tStart,$tEnd-$tStart);
+    # The linked texts may come anywhere in the file, so label the paths only now:
+    my @labeledPaths;
+    foreach my $path (@paths){
+        my $label = ($path->{stroke} ne "" and $path->{stroke} ne "000000") ? hex($path->{stroke}) : "";
+        if (!$label and defined($path->{id}) and $linkedTexts{$path->{id}}){$label = $linkedTexts{$path->{id}}}
+        if ($label){
+            my ($Xs,$Ys) = SVG_PathCoords($path->{d},$path->{transform},$relativize);
+            push @labeledPaths,[$Xs,$Ys,$label];
         }
     }
-    return $outStr;
+
+    return {X1s=>pdl(\@X1s),Y1s=>pdl(\@Y1s),X2s=>pdl(\@X2s),Y2s=>pdl(\@Y2s),lineTexts=>\@lineTexts,paths=>\@labeledPaths};
 }
-    
-        
-sub SVG_ExtractPathCoords {
-    my ($pathStr,$relativize) = @_;        
-     
-    my $Xs = zeros(0);
-    my $Ys = zeros(0);
-
-    # Look for the coordinates line:
-    my ($code,$vector);
-    if ($pathStr =~ m[^\s.*d="(.)\s(.*?)"$]m){
-        $code    = $1;
-        $vector  = $2;
-#pq($code,$vector);
-    }
 
-    while ( $vector =~ m[(-?\d+?\.?\d*?),(-?\d+?\.?\d*?)(\s|$)] ){  ### broken by a x,0
-#print "In while: 1=[$1],2=[$2]\n";
-        $Xs = $Xs->glue(0,pdl($1));
-        $Ys = $Ys->glue(0,pdl($2));
-        $vector = $';
-#pq $vector;
-    }
 
-#print "  After read:Xs=$Xs\nYS=$Ys\n";
+sub SVG_PathCoords {
+    my ($d,$transform,$relativize) = @_;
+
+    ## Only handles paths of straight segments, with all absolute (M) or all relative (m) coords.  The transform is applied to every point, and the y's are then negated to give window-type coords.
+
+    if ($d !~ m[^\s*([A-Za-z])]){die "Detected bad vector code ().\n"}
+    my $code = $1;
+    if ($code ne "M" and $code ne "m"){die "Detected bad vector code ($code).\n"}
+
+    my @coords = ($d =~ m[(-?(?:\d+\.?\d*|\.\d+)(?:[eE][-+]?\d+)?)]g);
+    if (!@coords or @coords % 2){die "Detected bad path coordinates ($d).\n"}
+
+    my $coords  = pdl(\@coords);
+    my $Xs      = $coords(0:-1:2)->copy;
+    my $Ys      = $coords(1:-1:2)->copy;
 
     if ($code eq "m") {     # Resolve point-to-point coords:
         $Xs = cumusumover($Xs);
         $Ys = cumusumover($Ys);
-    } elsif ($code ne "M"){
-        die "Detected bad vector code ($code).\n";
     }
 
-#print "  After resolve:\nXs=$Xs\nYS=$Ys\n";
-
-    # Look for a transform to apply:
-    if ($pathStr =~ m[\stransform="(\w.*?)\((.*?)\)"]) {
-        if ($Xs->nelem > 2){die "transform only implented for 2 element paths.\n"}
-        my $transform   = $1;
-        my $content     = $2;
-        ($Xs,$Ys) = SVG_ApplyTransformToSeg($transform,$content,$Xs,$Ys);
-#print "  After transform:\nXs=$Xs\nYS=$Ys\n";
-    }
+    ($Xs,$Ys) = SVG_ApplyTransform($transform,$Xs,$Ys);
 
     # Convert from matrix to window-type coords:
     $Ys = -$Ys;
-    
-#print "  After convert:\nXs=$Xs\nYS=$Ys\n";
 
     # Translate the initial point to (0,0):
     if ($relativize){
         $Xs -= $Xs(0)->sclr;
         $Ys -= $Ys(0)->sclr;
-            
-#print "  After translate:\nXs=$Xs\nYS=$Ys\n";
     }
-    
-    return($Xs,$Ys);
+
+    return ($Xs,$Ys);
 }
 
 
@@ -2064,10 +2037,10 @@ sub SetDriverFromPathSVG {
 	my $timeThetas;
     
     my $readCount = 0;
-    while ($inData and $readCount < 5){
+    foreach my $path (@{SVG_ReadElements($inData,1)->{paths}}){
+        if ($readCount >= 5){last}
     
-        my ($Xs,$Ys,$labelStr);
-        ($Xs,$Ys,$labelStr,$inData) = ReadNextLabeledPathSVG($inData,1);
+        my ($Xs,$Ys,$labelStr) = @$path;
 die "Needs work.\n";
         
 #pq($readCount,$inData,$labelStr);
@@ -2150,23 +2123,23 @@ sub SetDriverFromHandleLineSegsSVG {
     if ($verbose>=3){print "Loading cast from handle line segments...\n"}
 #pq $inData;
 
+    my $svg = SVG_ReadElements($inData);
+	my $lineTexts = $svg->{lineTexts};
+
     my $scale;
-    my $cc          = 1000;
+    my @frameLabels = grep {m[^\d+$]} @$lineTexts;
+    my $cc          = (@frameLabels) ? pdl(\@frameLabels)->max+1 : 1;
     my $minIndex    = $cc;
     my $maxIndex    = 0;
     my $count       = 0;
 	
 	my ($X1s,$Y1s,$X2s,$Y2s,$labels) = map {$nan*ones($cc)} (0..4);
 	
-    my $thisIndex = 0;
-    do {
+    for (my $ii=0;$ii<@$lineTexts;$ii++){
     
-        my ($x1,$y1,$x2,$y2,$text);
-		
-		
-		($x1,$y1,$x2,$y2,$text,$thisIndex) =
-					ReadNextLineGroupSVG($inData,$thisIndex);
-#pq($x1,$y1,$x2,$y2,$text,$thisIndex);
+        my ($x1,$y1,$x2,$y2) = map {$svg->{$_}->at($ii)} qw(X1s Y1s X2s Y2s);
+        my $text = $lineTexts->[$ii];
+#pq($x1,$y1,$x2,$y2,$text);
         
         if ($text){
 #pq($count,$inData,$text);
@@ -2214,7 +2187,7 @@ sub SetDriverFromHandleLineSegsSVG {
 
            }
         }
-    } while ($thisIndex >= 0);
+    }
 	
 	if ($count < 1){print "ERROR: No driver data obtained from file.  Cannot proceed.\n"; return 0}
     
@@ -2275,11 +2248,16 @@ sub SetDriverFromHandleLineSegsSVG {
 		my %opts = (gnuplot=>$gnuplot);
 		my $plotOpts = ($rps->{driver}{showTrackPlot}) ? \%opts : 0;
 
-		if (2*$smoothingOrder+1 > $numTimes/2){print "Error: 2*smoothingOrder+1 must be no greater than the number of loaded timesteps divided by 2.\n"; return 0}
+		my %smoothing = (method=>$rps->{driver}{smoothingMethod},order=>$smoothingOrder,halfWidth=>eval($rps->{driver}{savGolHalfWidth}));
+		if ($smoothing{method} eq "savgol"){
+			if (2*$smoothing{halfWidth}+1 > $numTimes){print "Error: 2*savGolHalfWidth+1 must be no greater than the number of loaded timesteps.\n"; return 0}
+			if ($smoothingOrder >= 2*$smoothing{halfWidth}+1){print "Error: With savgol smoothing, smoothingOrder must be less than 2*savGolHalfWidth+1.\n"; return 0}
+		}
+		elsif (2*$smoothingOrder+1 > $numTimes/2){print "Error: 2*smoothingOrder+1 must be no greater than the number of loaded timesteps divided by 2.\n"; return 0}
 
 		my $smoothEnds		= ($numTimes >= 10) ? 5 : POSIX::floor($numTimes/2);
 			# Always smooth ends as well.
-		SmoothDriver($smoothingOrder,$smoothEnds,$plotOpts,
+		SmoothDriver(\%smoothing,$smoothEnds,$plotOpts,
 						$driverTs,$driverXs,$driverYs,$driverZs,
 						$driverDXs,$driverDYs,$driverDZs);
 	}
@@ -2304,8 +2282,11 @@ sub SetDriverFromHandleVectorsSVG {
     if ($verbose>=3){print "Loading cast from handle vectors...\n"}
 #pq $inData;
 
+    my $svgPaths = SVG_ReadElements($inData)->{paths};
+
     my $scale;
-    my $cc          = 1000;
+    my @frameLabels = grep {m[^\d+$]} map {$_->[2]} @$svgPaths;
+    my $cc          = (@frameLabels) ? pdl(\@frameLabels)->max+1 : 1;
     my $minIndex    = $cc;
     my $maxIndex    = 0;
     my $count       = 0;
@@ -2314,12 +2295,9 @@ sub SetDriverFromHandleVectorsSVG {
     my $handleYs        = $nan*ones($cc);
     my $handleThetas    = $nan*ones($cc);
     
-    my $thisIndex = 0;
-    do {
+    foreach my $path (@$svgPaths){
     
-        my ($Xs,$Ys,$labelStr);
-#pq $thisIndex;
-        ($Xs,$Ys,$labelStr,$thisIndex) = ReadNextLabeledPathSVG($inData,$thisIndex);
+        my ($Xs,$Ys,$labelStr) = @$path;
         
         if ($labelStr){
 #pq($count,$inData,$labelStr);
@@ -2366,7 +2344,7 @@ sub SetDriverFromHandleVectorsSVG {
 
            }
         }
-    } while ($thisIndex >= 0);
+    }
     
     if ($count != ($maxIndex-$minIndex)+1) {
         $handleLabels = $handleLabels($minIndex:$maxIndex);
@@ -3028,6 +3006,20 @@ my %opts_plot;
 my $holding;		# Currently unused.
 my ($T,$Dynams);
 	# Will hold the complete integration record.  I put them up here since $T will be undef'd in SetupIntegration() as a way of indicating that the CastRun() initialization has not yet been done.
+my $Energies;
+	# If energy accounting, parallel to $T, one column of DE_EnergyColumns() values per stored time.  Otherwise undef.
+my ($TStore,$DynamsStore,$EnergiesStore);
+	# Growable backing for the three above, which are slices of these.  See RowStoreNew().
+my $resultStream;
+	# Defined only while streaming.  See ResultStreamOpen().
+my ($streamRunKey,$streamMemoryRows);
+	# The key written into the stream header, so a later run can tell whether it may resume from it.  Memory rows are 0 unless only the tail of the record is kept in the stores, the rest being in the stream.
+my $streamedEnergyRows;
+	# When the tail is all that is in memory, the energy rows for saving, read back from the stream with the plot data.
+my $livePlot;
+	# Defined only while the live plot is up.  See LivePlotOpen().
+my ($runCacheKey,$cacheHit);
+	# Key is '' if the run cache is not in use.  Hit is set if the cache supplied the whole run.
 
 sub SetupIntegration { my $verbose = 1?$verbose:0;
     
@@ -3165,6 +3157,9 @@ OLD WAY
                     $tipReleaseStartTime,$tipReleaseEndTime,
                     $T0,$Dynams0,$dT0,$dTPlot,
                     $runControlPtr,$loadedStateIsEmpty);
+
+    if ($loadedStateIsEmpty and $rps->{integration}{staticStart}){Calc_StaticEquilibrium($T0)}
+        # DoRun() starts from Get_DynamsCopy(), so takes the relaxed configuration from here.
 }
 
 
@@ -3216,6 +3211,10 @@ sub DoRun {
 		if ($verbose>=2 and $t1 != $t1_GSL){print "Reducing stop time to last uniform step, from $t1 to $t1_GSL\n"}
         
         $Dynams             = Get_DynamsCopy(); # This includes good initial $ps.
+
+        DE_SetEnergyAccounting($rps->{integration}{energyAccounting});
+        DE_SetDragMultipliers(RandomMultipliers($segLens->nelem,eval($rps->{ambient}{dragVariation}),$rps->{ambient}{dragSeed}));
+        $Energies = ($rps->{integration}{energyAccounting}) ? DE_EnergyColumns($t0_GSL,$Dynams)->dummy(1) : undef;
         if($verbose>=3){pq($t0_GSL,$t1_GSL,$dt_GSL,$Dynams)}
         
         
@@ -3250,7 +3249,48 @@ sub DoRun {
         %opts_GSL	= (type=>$rps->{integration}{stepperName},h_init=>$h_init);
         if ($verbose>=3){pq(\%opts_GSL)}
         
-        $T = pdl($t0_GSL);   # To indicate that initialization has been done.  Prevents repeated initializations even if the user interrups during the first plot interval.
+        $streamMemoryRows	= ($rps->{integration}{streamFile}) ? eval($rps->{integration}{streamMemoryRows}) : 0;
+
+        # Room for every uniform time plus a held event stop, so a run that isn't interrupted never regrows.  When keeping only the tail, room for the most it can grow to between trims:
+        my $capacity	= ($streamMemoryRows) ? 3*$streamMemoryRows+2 : $lastStep_GSL+2;
+        $TStore			= RowStoreNew(0,$capacity);
+        $DynamsStore	= RowStoreNew($Dynams->dim(0),$capacity);
+        $Dynams			= RowStoreAppend($DynamsStore,$Dynams);
+        if (defined($Energies)){
+			$EnergiesStore	= RowStoreNew($Energies->dim(0),$capacity);
+			$Energies		= RowStoreAppend($EnergiesStore,$Energies);
+		}
+
+        $T = RowStoreAppend($TStore,$t0_GSL);   # To indicate that initialization has been done.  Prevents repeated initializations even if the user interrups during the first plot interval.
+
+        ($runCacheKey,$cacheHit) = ('',0);
+        if ($rps->{integration}{runCacheDir} and $eventTs->isempty and !$streamMemoryRows){
+            $runCacheKey = RunCacheKey($rps,'cast');
+            $cacheHit = UseCachedRun(RunCacheFind($rps->{integration}{runCacheDir},$runCacheKey));
+        }
+
+        ResultStreamClose($resultStream);   # From any earlier run.
+        $resultStream = undef;
+        if ($rps->{integration}{streamFile}){
+            $streamRunKey = RunCacheKey($rps,'cast');
+            my $resumeBytes;
+            if ($rps->{integration}{streamResume} and $T->nelem == 1 and !defined($Energies) and $eventTs->isempty){
+                $resumeBytes = UseStreamedRun($rps->{integration}{streamFile});
+            }
+            $resultStream = ResultStreamOpen($rps->{integration}{streamFile},$rCastOutFileTag,$rps->{file}{save},
+                                    [StreamColumnNames()],eval($rps->{integration}{streamSyncSecs}),{runKey=>$streamRunKey,resumeBytes=>$resumeBytes});
+            if (defined($resumeBytes)){StreamRows($T(-1),$Dynams(:,-1),undef)}
+                # The file was cut back to just before its last row, which is held again, as at the end of any block.
+            else {StreamRows($T,$Dynams,$Energies)}
+        }
+        if (!defined($resultStream)){$streamMemoryRows = 0}
+
+        LivePlotClose($livePlot);
+        $livePlot = undef;
+        if ($rps->{integration}{livePlot} and !$cacheHit){
+            $livePlot = LivePlotOpen($rps->{file}{save},$numRodNodes+1,$t0_GSL,$t1_GSL,eval($rps->{integration}{livePlotFPS}));
+            LiveRows($T,$Dynams);
+        }
         
         if ($verbose>=2){print "Solver startup can be especially slow.  BE PATIENT.\n"}
         else {print "RUNNING SILENTLY, wait for return, or hit PAUSE to see the results thus far.\n"}
@@ -3324,6 +3364,12 @@ sub DoRun {
             $thisNumSteps_GSL	= DecimalFloor(($thisStop_GSL-$thisStart_GSL)/$dt_GSL);
             $stopIsUniform		= 1;
 
+			if ($streamMemoryRows and $thisNumSteps_GSL > $streamMemoryRows){
+				# The solver returns the whole block at once, so it too must be no bigger than the kept tail:
+				$thisNumSteps_GSL	= $streamMemoryRows;
+				$thisStop_GSL		= DecimalRound($thisStart_GSL+$streamMemoryRows*$dt_GSL);
+			}
+
 			if (DEBUG and $verbose>=2){print "thisStart_GSL=$thisStart_GSL,startIsUniform=$startIsUniform,thisStop_GSL=$thisStop_GSL,stopIsUniform=$stopIsUniform\n"}
         }
         else {    # There are events.
@@ -3425,8 +3471,8 @@ sub DoRun {
             if (DEBUG and $verbose>=4){pq($tStatus,$tErrMsg,$interruptT,$interruptDynams)}
         }
         
-        # Start a subsequent run with the latest average dts of the just completed run:
-        my $next_h_init = Get_movingAvDt();
+        # Start a subsequent run near the step the just completed run had settled on:
+        my $next_h_init = Get_stepHintDt();
         $opts_GSL{h_init} = $next_h_init;
         if (DEBUG and $verbose>=4){pq($next_h_init)}
         
@@ -3438,6 +3484,16 @@ sub DoRun {
         $nextStart_GSL  = $solution(0,-1)->sclr;
         $nextDynams_GSL = $solution(1:-1,-1)->flat;
 
+		my $blockEnergies;
+		if (defined($Energies)){
+			# Must be figured on the configuration the solver just used, so before any restart:
+			my ($nCols,$nTimes) = $solution->dims;
+			$blockEnergies = zeros($Energies->dim(0),$nTimes-1);
+			for (my $ii=1;$ii<$nTimes;$ii++){
+				$blockEnergies(:,$ii-1) .= DE_EnergyColumns($solution(0,$ii)->sclr,$solution(1:-1,$ii)->flat);
+			}
+		}
+
         if (DEBUG and $verbose>=3){print "END_TIME=$nextStart_GSL\nEND_DYNAMS=$nextDynams_GSL\n\n"}
         #pq($T,$Dynams);
 
@@ -3451,8 +3507,12 @@ sub DoRun {
 		
 			# However, if the start was not uniform, remove the last stored data row, which we can do because we have something more recent to start with next time:
 			if (!$startIsUniform){
-				$T		= $T(0:-2);
-				$Dynams	= $Dynams(:,0:-2);
+				my $numKeep	= $T->nelem-1;
+				$T		= RowStoreTruncate($TStore,$numKeep);
+				$Dynams	= RowStoreTruncate($DynamsStore,$numKeep);
+				if (defined($Energies)){$Energies = RowStoreTruncate($EnergiesStore,$numKeep)}
+				ResultStreamDropLast($resultStream);
+				LivePlotDropLast($livePlot);
 				if (DEBUG and $verbose>=2){pq($T,$Dynams)}
 			}
         }
@@ -3467,8 +3527,17 @@ sub DoRun {
         my ($ts,$paddedDynams) = PadSolution($solution,$wasHolding);
 			# Just gives back the keeper dynams in the solution.
 		
-		$T		= $T->glue(0,$ts);
-		$Dynams	= $Dynams->glue(1,$paddedDynams);
+		$T		= RowStoreAppend($TStore,$ts);
+		$Dynams	= RowStoreAppend($DynamsStore,$paddedDynams);
+		if (defined($Energies)){$Energies = RowStoreAppend($EnergiesStore,$blockEnergies)}
+		if (defined($resultStream)){StreamRows($ts,$paddedDynams,$blockEnergies)}
+		if (defined($livePlot)){LiveRows($ts,$paddedDynams)}
+		if ($streamMemoryRows and $T->nelem > 2*$streamMemoryRows){
+			# The older rows are in the stream:
+			$T		= RowStoreKeepLast($TStore,$streamMemoryRows);
+			$Dynams	= RowStoreKeepLast($DynamsStore,$streamMemoryRows);
+			if (defined($Energies)){$Energies = RowStoreKeepLast($EnergiesStore,$streamMemoryRows)}
+		}
 		if (DEBUG and $verbose>=4){pq($T,$Dynams)}
 		
         if ($nextStart_GSL < $t1_GSL and $tStatus >= 0) {
@@ -3484,6 +3553,22 @@ sub DoRun {
     my $timeEnd = time();
     $elapsedTime_GSL += $timeEnd-$timeStart;
     
+    # Keep the stream open in case of CONTINUE, but get everything that can't be retracted onto the disk:
+    if (defined($resultStream)){
+        if ($nextStart_GSL >= $t1_GSL or $tStatus < 0){
+            ResultStreamClose($resultStream);
+            $resultStream = undef;
+        } else {
+            ResultStreamFlush($resultStream);
+        }
+    }
+
+    # On PAUSE the live plot stays up for CONTINUE:
+    if (defined($livePlot) and ($nextStart_GSL >= $t1_GSL or $tStatus < 0)){
+        LivePlotClose($livePlot);
+        $livePlot = undef;
+    }
+    
     if ($verbose>=3){
         my $JACfac = JACget();
         pq($JACfac);
@@ -3492,27 +3577,64 @@ sub DoRun {
     
     if (DEBUG and $verbose>=4){print "After run\n";pq($T,$Dynams)};
     
-    $finalT     = $T(-1)->flat;
-    $finalState = $Dynams(:,-1)->flat;
+    $finalT     = $T(-1)->flat->copy;
+    $finalState = $Dynams(:,-1)->flat->copy;
+		# Copies, since $T and $Dynams share their stores' buffers, which a CONTINUE may overwrite.
     #pq($finalT,$finalState);
     
-    $plotTs = zeros(0);
+    # If only the tail is in memory, the rows before it come back from the stream, which the flush above has brought up to date except for the held newest row, which is in the tail:
+    my ($streamed,$numStreamed) = (undef,0);
+    $streamedEnergyRows = undef;
+    if ($streamMemoryRows){
+        $streamed = ResultStreamRead($rps->{integration}{streamFile},$rCastOutFileTag,$streamRunKey,[StreamColumnNames()],0);
+        if (defined($streamed)){$numStreamed = sum($streamed->{rows}(0,:) < $T->at(0))}
+        else {print "WARNING: Could not read back the stream.  Plotting only the last ".$T->nelem." stored rows.\n"}
+    }
+
+    my $traceCount = $T->nelem;
+    my $numTraces = ($tStatus) ? $numStreamed+$traceCount+1 : $numStreamed+$traceCount;
+		# The count is known, so fill preallocated traces rather than glue them on one at a time.
+
+    $plotTs = zeros($numTraces);
     
     $plotNumRodNodes    = $numRodNodes+1;   #includes handle butt and handle top.
-    my $numPlotNodes    = $numSegs+2;       #includes handle butt and handle top.
-    ($plotXs,$plotYs,$plotZs) = map {zeros($numPlotNodes,0)} (0..2);
-
-    my $plotRs = zeros($numSegs,0);
+    my $plotRs;
+		# These and the coord traces are sized from the first trace.
     
-    ($plotXLineTips,$plotYLineTips,$plotZLineTips)          = map {zeros(1,0)} (0..2);
-    ($plotXLeaderTips,$plotYLeaderTips,$plotZLeaderTips)    = map {zeros(1,0)} (0..2);
+    ($plotXLineTips,$plotYLineTips,$plotZLineTips)          = map {zeros(1,$numTraces)} (0..2);
+    ($plotXLeaderTips,$plotYLeaderTips,$plotZLeaderTips)    = map {zeros(1,$numTraces)} (0..2);
+
+    if ($numStreamed){
+        my $rows	= $streamed->{rows}(:,0:$numStreamed-1);
+        my $iCols	= $streamed->{columns};
+        my $iX0		= $iCols->{X0};
+        my $numNodes = $iCols->{Y0}-$iX0;
+        
+        $plotTs(0:$numStreamed-1) .= $rows($iCols->{T},:)->flat;
+        ($plotXs,$plotYs,$plotZs) = map {zeros($numNodes,$numTraces)} (0..2);
+        $plotXs(:,0:$numStreamed-1) .= $rows($iX0:$iX0+$numNodes-1,:);
+        $plotYs(:,0:$numStreamed-1) .= $rows($iX0+$numNodes:$iX0+2*$numNodes-1,:);
+        $plotZs(:,0:$numStreamed-1) .= $rows($iX0+2*$numNodes:$iX0+3*$numNodes-1,:);
+        
+        $plotXLineTips(:,0:$numStreamed-1)      .= $rows($iCols->{XLineTip},:);
+        $plotYLineTips(:,0:$numStreamed-1)      .= $rows($iCols->{YLineTip},:);
+        $plotZLineTips(:,0:$numStreamed-1)      .= $rows($iCols->{ZLineTip},:);
+        
+        $plotXLeaderTips(:,0:$numStreamed-1)    .= $rows($iCols->{XLeaderTip},:);
+        $plotYLeaderTips(:,0:$numStreamed-1)    .= $rows($iCols->{YLeaderTip},:);
+        $plotZLeaderTips(:,0:$numStreamed-1)    .= $rows($iCols->{ZLeaderTip},:);
+        
+        if (defined($Energies)){
+            my $numEnergies = $Energies->dim(0);
+            $streamedEnergyRows = $rows($iCols->{T},:)->glue(0,$rows(-$numEnergies:-1,:))->glue(1,$T->dummy(0)->glue(0,$Energies));
+        }
+    }
     
     #my $nextPlotTime = $tt[0];
     
     #my $iTrace=0;
     #my $iLastPlotted = -1;
     my $tPlot;
-    my $traceCount = $T->nelem;
     for (my $ii=0;$ii<$traceCount;$ii++){
         
         # So, if we got here, either this is the next requested trace to plot or it is bad and the previous step was not plotted.
@@ -3529,19 +3651,25 @@ sub DoRun {
         #pq($XLineTip,$XLeaderTip);
         #die;
         
-        $plotTs = $plotTs->glue(0,pdl($tPlot));
-        $plotXs = $plotXs->glue(1,$tXs);
-        $plotYs = $plotYs->glue(1,$tYs);
-        $plotZs = $plotZs->glue(1,$tZs);
-        $plotRs = $plotRs->glue(1,$tRs);
+        if (!$ii){
+            if (!$numStreamed){($plotXs,$plotYs,$plotZs) = map {zeros($tXs->nelem,$numTraces)} (0..2)}
+            $plotRs = zeros($tRs->nelem,$numTraces);
+                # Radii aren't streamed, so those of any streamed traces are left zero.
+        }
+        my $iTrace = $numStreamed+$ii;
+        $plotTs($iTrace) .= $tPlot;
+        $plotXs(:,$iTrace) .= $tXs;
+        $plotYs(:,$iTrace) .= $tYs;
+        $plotZs(:,$iTrace) .= $tZs;
+        $plotRs(:,$iTrace) .= $tRs;
         
-        $plotXLineTips      = $plotXLineTips->glue(1,$XLineTip);
-        $plotYLineTips      = $plotYLineTips->glue(1,$YLineTip);
-        $plotZLineTips      = $plotZLineTips->glue(1,$ZLineTip);
+        $plotXLineTips(:,$iTrace)      .= $XLineTip;
+        $plotYLineTips(:,$iTrace)      .= $YLineTip;
+        $plotZLineTips(:,$iTrace)      .= $ZLineTip;
         
-        $plotXLeaderTips    = $plotXLeaderTips->glue(1,$XLeaderTip);
-        $plotYLeaderTips    = $plotYLeaderTips->glue(1,$YLeaderTip);
-        $plotZLeaderTips    = $plotZLeaderTips->glue(1,$ZLeaderTip);
+        $plotXLeaderTips(:,$iTrace)    .= $XLeaderTip;
+        $plotYLeaderTips(:,$iTrace)    .= $YLeaderTip;
+        $plotZLeaderTips(:,$iTrace)    .= $ZLeaderTip;
         
     }
     #pq($traceCount,$plotTs,$plotXs,$plotYs);
@@ -3563,19 +3691,19 @@ sub DoRun {
         if (DEBUG and $verbose>=5){pq($tXs,$tYs,$tZs)}
         
         
-        $plotTs = $plotTs->glue(0,pdl($tt));
-        $plotXs = $plotXs->glue(1,$tXs);
-        $plotYs = $plotYs->glue(1,$tYs);
-        $plotZs = $plotZs->glue(1,$tZs);
-        $plotRs = $plotRs->glue(1,$tRs);
+        $plotTs(-1) .= $tt;
+        $plotXs(:,-1) .= $tXs;
+        $plotYs(:,-1) .= $tYs;
+        $plotZs(:,-1) .= $tZs;
+        $plotRs(:,-1) .= $tRs;
         
-        $plotXLineTips      = $plotXLineTips->glue(1,$XLineTip);
-        $plotYLineTips      = $plotYLineTips->glue(1,$YLineTip);
-        $plotZLineTips      = $plotZLineTips->glue(1,$ZLineTip);
+        $plotXLineTips(:,-1)      .= $XLineTip;
+        $plotYLineTips(:,-1)      .= $YLineTip;
+        $plotZLineTips(:,-1)      .= $ZLineTip;
         
-        $plotXLeaderTips    = $plotXLeaderTips->glue(1,$XLeaderTip);
-        $plotYLeaderTips    = $plotYLeaderTips->glue(1,$YLeaderTip);
-        $plotZLeaderTips    = $plotZLeaderTips->glue(1,$ZLeaderTip);
+        $plotXLeaderTips(:,-1)    .= $XLeaderTip;
+        $plotYLeaderTips(:,-1)    .= $YLeaderTip;
+        $plotZLeaderTips(:,-1)    .= $ZLeaderTip;
         
         if (DEBUG and $verbose>=5){
             print "Appending interrupt data\n";
@@ -3616,11 +3744,21 @@ sub DoRun {
     
 	
     
+    if ($runCacheKey and !$cacheHit and !$tStatus and $tPlot >= $t1_GSL){
+        RunCacheStore($rps->{integration}{runCacheDir},$runCacheKey,$T,$Dynams,$Energies,
+            $rCastOutFileTag,$titleStr,$paramsStr,
+            $plotTs,$plotXs,$plotYs,$plotZs,$plotXLineTips,$plotYLineTips,$plotZLineTips,$plotXLeaderTips,$plotYLeaderTips,$plotZLeaderTips,$plotNumRodNodes,$plotBottom,$plotErrMsg,
+            $finalT,$finalState,$segLens);
+    }
+    
     # If integration has completed, tell the caller:
     if ($tPlot>=$t1_GSL or $tStatus < 0) {
         if ($tStatus < 0){print "\n";pq($tStatus,$tErrMsg)}
         &{$runControl{callerStop}}();
     }    
+
+    return $tStatus;
+        # The control panel ignores this.  Batch runs use it for their exit code.
 }
 
 
@@ -3749,6 +3887,118 @@ sub PadSolution {
 
 
 
+sub UseCachedRun {
+    my ($cached) = @_;
+
+    ## Replace the just initialized stored solution with as much of a cached one as applies.  Returns 1 if that covers the whole run.  If it covers only part, the run continues from its end, except with energy accounting, whose running totals were not cached.
+
+    if (!defined($cached)){return 0}
+
+    my $cachedTs	= $cached->{StoredTs};
+    my $numUse		= sum($cachedTs <= $t1_GSL);
+    my $tLast		= $cachedTs->at($numUse-1);
+    if ($cachedTs->at(0) != $t0_GSL or $cached->{StoredDynams}->dim(0) != $Dynams->dim(0)
+            or (defined($Energies) and (!defined($cached->{StoredEnergies}) or $tLast < $t1_GSL))){
+        if ($verbose>=2){print "Cached run found, but it can't be used for this one.\n"}
+        return 0;
+    }
+
+    if ($numUse > 1){
+        $T		= RowStoreAppend($TStore,$cachedTs(1:$numUse-1));
+        $Dynams	= RowStoreAppend($DynamsStore,$cached->{StoredDynams}(:,1:$numUse-1));
+        if (defined($Energies)){$Energies = RowStoreAppend($EnergiesStore,$cached->{StoredEnergies}(:,1:$numUse-1))}
+    }
+
+    if ($tLast >= $t1_GSL){
+        if ($verbose>=1){print "Using cached run.  No integration needed.\n"}
+        return 1;
+    }
+
+    if ($verbose>=1){printf("Using cached run up to t=%.4f, continuing from there.\n",$tLast)}
+    Init_Hamilton("restart_cast",$tLast,$Dynams(:,-1)->flat);
+    return 0;
+}
+
+
+sub UseStreamedRun {
+    my ($filename) = @_;
+
+    ## Replace the just initialized stored solution with the end of an earlier, unfinished run of this one, read back from its stream.  Returns the length of the stream file up to the start of its last row, or undef if there is nothing to resume.  The run then continues from that last row.  Compare UseCachedRun().
+
+    my $streamed = ResultStreamRead($filename,$rCastOutFileTag,$streamRunKey,[StreamColumnNames()],$streamMemoryRows);
+    if (!defined($streamed) or !$streamed->{numRows}){return undef}
+
+    my $rows	= $streamed->{rows};
+    my $tLast	= $rows->at(0,-1);
+    if ($streamed->{firstT} != $t0_GSL or $tLast > $t1_GSL){
+        if ($verbose>=2){print "Stream $filename found, but it can't be resumed by this run.\n"}
+        return undef;
+    }
+
+    $T		= RowStoreTruncate($TStore,0);
+    $Dynams	= RowStoreTruncate($DynamsStore,0);
+    $T		= RowStoreAppend($TStore,$rows(0,:)->flat);
+    $Dynams	= RowStoreAppend($DynamsStore,$rows(1:$DynamsStore->{rowLen},:));
+
+    if ($verbose>=1){printf("Resuming the run in $filename from t=%.4f.\n",$tLast)}
+    if ($tLast < $t1_GSL){Init_Hamilton("restart_cast",$tLast,$Dynams(:,-1)->flat)}
+    return $streamed->{lastRowBytes};
+}
+
+
+sub StreamColumnNames {
+
+    ## Matches the rows StreamRows() makes.  The node count is taken from the initial configuration.
+
+    my $numDynams	= $Dynams->dim(0);
+    my ($tXs)		= Calc_Qs($T(0)->sclr,$Dynams(:,0),$lineTipOffset,$leaderTipOffset,1);
+    my $numNodes	= $tXs->nelem;
+    my @names = ('T',(map {"D$_"} (0..$numDynams-1)));
+    foreach my $coord (qw(X Y Z)){push @names,map {"$coord$_"} (0..$numNodes-1)}
+    push @names,qw(XLineTip YLineTip ZLineTip XLeaderTip YLeaderTip ZLeaderTip);
+    if (defined($Energies)){push @names,Get_EnergyColumnNames()}
+    return @names;
+}
+
+
+sub StreamRows {
+    my ($ts,$dynams,$energies) = @_;
+
+    ## Append stored rows to the result stream, with the node and tip coords figured from the dynams.
+
+    my $numTs = $ts->nelem;
+    if (!defined($resultStream) or !$numTs){return}
+
+    my $rows;
+    for (my $ii=0;$ii<$numTs;$ii++){
+        my $t		= $ts($ii)->sclr;
+        my $tDynams	= $dynams(:,$ii);
+        my ($tXs,$tYs,$tZs,$tRs,@tips) = Calc_Qs($t,$tDynams,$lineTipOffset,$leaderTipOffset,1);
+        my @vals = ($t,$tDynams->list,$tXs->list,$tYs->list,$tZs->list,(map {pdl($_)->list} @tips));
+        if (defined($energies)){push @vals,$energies(:,$ii)->list}
+
+        if (!$ii){$rows = zeros(scalar(@vals),$numTs)}
+        $rows(:,$ii) .= pdl(\@vals);
+    }
+    ResultStreamAppend($resultStream,$rows);
+}
+
+
+sub LiveRows {
+    my ($ts,$dynams) = @_;
+
+    ## Send stored rows to the live plot as node coords.
+
+    if (!defined($livePlot)){return}
+
+    for (my $ii=0;$ii<$ts->nelem;$ii++){
+        my $t = $ts($ii)->sclr;
+        my ($tXs,$tYs,$tZs) = Calc_Qs($t,$dynams(:,$ii),$lineTipOffset,$leaderTipOffset,1);
+        LivePlotAppend($livePlot,$t,$tXs,$tYs,$tZs);
+    }
+}
+
+
 sub Calc_Qs {
     my ($t,$tDynams,$lineTipOffset,$leaderTipOffset,$includeHandleButt) = @_;
     
@@ -3840,68 +4090,64 @@ sub Calc_QOffset {
 
 # SVG FILE UTILITIES ===================================================================
 
-# The cast drawing is expected to be in SVG.  See http://www.w3.org/TR/SVG/ for the full protocol.  SVG does 2-DIMENSIONAL drawing only!  Transformations nest:  apply innermost transformation to innermost vector to get the vector expressed in the next coordinate system out.  If there is a transformation outside that, apply it to what you got to get the vector in the next outer coords.  And so forth until you get to the outermost (canvas) coords.  See the function SVG_matrix() below for the details.
+# The cast drawing is expected to be in SVG.  See http://www.w3.org/TR/SVG/ for the full protocol.  SVG does 2-DIMENSIONAL drawing only!  Transformations nest:  apply innermost transformation to innermost vector to get the vector expressed in the next coordinate system out.  If there is a transformation outside that, apply it to what you got to get the vector in the next outer coords.  And so forth until you get to the outermost (canvas) coords.  SVG_ReadElements() does this as it reads, composing each element's transform with those of the groups that hold it.
 
 # In particular, from Wikipedia:
 # Paths - Simple or compound shape outlines are drawn with curved or straight lines that can be filled in, outlined, or used as a clipping path. Paths have a compact coding. For example M (for 'move to') precedes initial numeric x and y coordinates and L (line to) precedes a point to which a line should be drawn. Further command letters (C, S, Q, T and A) precede data that is used to draw various Bézier and elliptical curves. Z is used to close a path. In all cases, absolute coordinates follow capital letter commands and relative coordinates are used after the equivalent lower-case letters.
 
-# These are barebones functions just adequate to handle my drawing simple segments.
-# $seg=pdl($x0,$y0,$x1,$y1).
+# These are barebones functions just adequate to handle my drawing simple segments.  A transform is held as the array ref [a,b,c,d,e,f] of the SVG matrix(a,b,c,d,e,f), which takes (x,y) to (a*x+c*y+e,b*x+d*y+f).
 
-sub SVG_matrix {
-    my ($a,$b,$c,$d,$e,$f,$inSeg) = @_;
+sub SVG_ParseTransform {
+    my ($transformStr) = @_;
 
-#print "in matrix\n";
-    my $mat = pdl($a,$c,$e,$b,$d,$f,0,0,1)->reshape(3,3);
-    $inSeg = $inSeg->reshape(2,2)->transpose->glue(1,ones(2));    
-#pq($mat,$inSeg);
-    
-    my $outSeg = $mat x $inSeg;
-#pq $outSeg";
+    ## Returns the transform described by the value of a transform attribute, the identity if there is none.  A list of transforms is composed, so that the rightmost is applied first.
 
-    return $outSeg(:,0:1)->transpose->flat;
-}
+    my $transform = [1,0,0,1,0,0];
+    if (!defined($transformStr)){return $transform}
+
+    while ($transformStr =~ m[(\w+)\s*\(([^)]*)\)]g){
+        my ($name,$content) = ($1,$2);
+        my @args = grep {$_ ne ""} split(/[\s,]+/,$content);
+        if (grep {!looks_like_number($_)} @args){die "\n\nDetected bad argument:  $name($content)\n"}
 
+        my $this;
+        if ($name eq "matrix" and @args == 6)                       {$this = [@args]}
+        elsif ($name eq "translate" and (@args == 1 or @args == 2)) {$this = [1,0,0,1,$args[0],(@args == 2) ? $args[1] : 0]}
+        elsif ($name eq "scale" and (@args == 1 or @args == 2))     {$this = [$args[0],0,0,(@args == 2) ? $args[1] : $args[0],0,0]}
+        elsif ($name eq "rotate" and @args == 1){
+            my $angle = $args[0]*$pi/180;
+            $this = [cos($angle),sin($angle),-sin($angle),cos($angle),0,0];
+        }
+        else {die "\n\nDectected unimplemented transform ($name($content)).\n\n"}
 
-sub SVG_translate {
-    my ($tx,$ty,$inSeg) = @_;
+        $transform = SVG_ComposeTransforms($transform,$this);
+    }
 
-#print "in trans\n";    
-    return SVG_matrix(1,0,0,1,$tx,$ty,$inSeg);
+    return $transform;
 }
 
 
+sub SVG_ComposeTransforms {
+    my ($outer,$inner) = @_;
 
-sub SVG_ApplyTransformToSeg {
-    my ($transform,$content,$Xs,$Ys) = @_;
-    
-    # WARNING:  This code applies only a single transformation.  The user needs to make sure that there are no nested transformations!  It is ok to ignore the single global transformation.
-    
-#pq($transform,$content);        
-    my $seg = $Xs(0)->glue(0,$Ys(0))->glue(0,$Xs(1))->glue(0,$Ys(1));    
-#pq $seg;
+    ## The transform that applies $inner and then $outer, as a nested element's transform is applied before its group's.
+
+    my ($oa,$ob,$oc,$od,$oe,$of) = @$outer;
+    my ($ia,$ib,$ic,$id,$ie,$if) = @$inner;
+
+    return [$oa*$ia+$oc*$ib,$ob*$ia+$od*$ib,
+            $oa*$ic+$oc*$id,$ob*$ic+$od*$id,
+            $oa*$ie+$oc*$if+$oe,$ob*$ie+$od*$if+$of];
+}
 
-    my $ok = 0;                                                        
-    switch($transform) {
-        case "matrix"       {
-            if ($content =~ m[^(-?\d+?\.?\d*?),(-?\d+?\.?\d*?),(-?\d+?\.?\d*?),(-?\d+?\.?\d*?),(-?\d+?\.?\d*?),(-?\d+?\.?\d*?)$]) {
-                $ok = 1;
-                $seg = SVG_matrix($1,$2,$3,$4,$5,$6,$seg);
-            }
-        }
-        case "translate"    {
-            if ($content =~ m[^(-?\d+?\.?\d*?),(-?\d+?\.?\d*?)$]) {
-                $ok = 1;
-                $seg = SVG_translate($1,$2,$seg);
-            }
-        }
-        else    {die "\n\nDectected unimplemented transform ($transform).\n\n"}
-    }
-    
-    if (!$ok) { die "\n\nDetected bad argument:  $transform($content)\n"}
 
-#pq $seg;
-    my ($outXs,$outYs) = ($seg(0)->glue(0,$seg(2)),$seg(1)->glue(0,$seg(3)));        
+sub SVG_ApplyTransform {
+    my ($transform,$Xs,$Ys) = @_;
+
+    ## Works equally on perl numbers and on pdls of coords.
+
+    my ($a,$b,$c,$d,$e,$f) = @$transform;
+    return ($a*$Xs+$c*$Ys+$e,$b*$Xs+$d*$Ys+$f);
 }
 
 
@@ -3971,6 +4217,7 @@ sub GetAmbientStr {
     my $str = "AMBIENT: Gravity=$rps->{ambient}{nominalG}; ";
     $str .= "DragSpecsNormal=($rps->{ambient}{dragSpecsNormal}); ";
     $str .= "DragSpecsAxial=($rps->{ambient}{dragSpecsAxial})";
+    if (eval($rps->{ambient}{dragVariation})){$str .= "; DragVariation=$rps->{ambient}{dragVariation}, seed $rps->{ambient}{dragSeed}"}
     
     return $str;
 }
@@ -4114,10 +4361,19 @@ sub DoSave { my $verbose = 1?$verbose:0;
 
 #pq($plotTs,$plotXs,$plotYs,$plotZs);
                    
+    my $energyRows = (defined($streamedEnergyRows)) ? $streamedEnergyRows : (defined($Energies)) ? $T->dummy(0)->glue(0,$Energies) : undef;
     if ($rps->{integration}{saveData}){
-        RCommonSave3D($dirs.$basename,$rSwingOutFileTag,$titleStr,$paramsStr,
+        RCommonSave3D($dirs.$basename,$rCastOutFileTag,$titleStr,$paramsStr,
+        $plotTs,$plotXs,$plotYs,$plotZs,$plotXLineTips,$plotYLineTips,$plotZLineTips,$plotXLeaderTips,$plotYLeaderTips,$plotZLeaderTips,$plotNumRodNodes,$plotBottom,$plotErrMsg,
+        $finalT,$finalState,$segLens,
+        $energyRows,[Get_EnergyColumnNames()]);
+    }
+
+    if ($rps->{integration}{saveBinary}){
+        RCommonSaveBinary3D($dirs.$basename,$rCastOutFileTag,$titleStr,$paramsStr,
         $plotTs,$plotXs,$plotYs,$plotZs,$plotXLineTips,$plotYLineTips,$plotZLineTips,$plotXLeaderTips,$plotYLeaderTips,$plotZLeaderTips,$plotNumRodNodes,$plotBottom,$plotErrMsg,
-        $finalT,$finalState,$segLens);
+        $finalT,$finalState,$segLens,
+        $energyRows,[Get_EnergyColumnNames()]);
     }
 }
 
@@ -47,7 +47,7 @@ use strict;
 our $VERSION='0.01';
 
 use Exporter 'import';
-our @EXPORT = qw(DEBUG $verbose $restoreVerbose $debugVerbose $reportVerbose $switchVerbose %runControl $rps $doSetup $doRun $doSave $loadRod $loadDriver @rodFieldsDisable @driverFieldsDisable $rSwingOutFileTag $rCastOutFileTag  $vs $inf $neginf $nan $pi $smallNum $waterDensity $waterKinematicViscosity $airDensity $airKinematicViscosity $inchesToCms $feetToCms $ouncesToGrains $grainsToDynes $ouncesToDynes $lbsToDynes $psiToDynesPerCm2 $grainsToGms $ouncesToGms $lbsPerFt3ToGmsPerCm3 $surfaceGravityCmPerSec2 $waterDensityGrsPerIn3 $specificGravity_Nylon $specificGravity_Fluoro $elasticModPSI_Nylon $elasticModPSI_Fluoro $dampingModPSI_Dummy $hexAreaFactor $hex2ndAreaMoment GradedFiberMoments GradedUnitLengthSegments StationDataToDiams DiamsToStationData DefaultDiams DefaultThetas IntegrateThetas ResampleThetas OffsetsToThetasAndSegs NodeCenteredSegs SegShares RodSegMasses RodSegExtraMasses FerruleLocs FerruleMasses RodTorqueKs SmoothDriver GetValueFromDataString GetWordFromDataString GetArrayFromDataString GetQuotedStringFromDataString SetDataStringFromMat GetMatFromDataString Str2Vect BoxcarVect LowerTri ResampleVectLin ResampleVect SplineNew SplineEvaluate SmoothChar SmoothZeroLinear SmoothLinear SecantOffsets SkewSequence RelocateOnArc DecimalRound DecimalFloor ReplaceNonfiniteValues exp10 MinMerge MaxMerge FindFileOnSearchPath PrintSeparator StripLeadingUnderscores HashCopy1 HashCopy2 ShortDateTime);
+our @EXPORT = qw(DEBUG $verbose $restoreVerbose $debugVerbose $reportVerbose $switchVerbose %runControl $rps $doSetup $doRun $doSave $loadRod $loadDriver @rodFieldsDisable @driverFieldsDisable $rSwingOutFileTag $rCastOutFileTag  $vs $inf $neginf $nan $pi $smallNum $waterDensity $waterKinematicViscosity $airDensity $airKinematicViscosity $inchesToCms $feetToCms $ouncesToGrains $grainsToDynes $ouncesToDynes $lbsToDynes $psiToDynesPerCm2 $grainsToGms $ouncesToGms $lbsPerFt3ToGmsPerCm3 $surfaceGravityCmPerSec2 $waterDensityGrsPerIn3 $specificGravity_Nylon $specificGravity_Fluoro $elasticModPSI_Nylon $elasticModPSI_Fluoro $dampingModPSI_Dummy $hexAreaFactor $hex2ndAreaMoment GradedFiberMoments GradedUnitLengthSegments StationDataToDiams DiamsToStationData DefaultDiams DefaultThetas IntegrateThetas ResampleThetas OffsetsToThetasAndSegs NodeCenteredSegs SegShares RodSegMasses RodSegExtraMasses FerruleLocs FerruleMasses RodTorqueKs SmoothDriver DataStringIndexNew GetValueFromDataString GetWordFromDataString GetArrayFromDataString GetQuotedStringFromDataString SetDataStringFromMat GetMatFromDataString Str2Vect BoxcarVect LowerTri ResampleVectLin ResampleVect SplineNew SplineEvaluate SmoothChar SmoothZeroLinear SmoothLinear SecantOffsets SkewSequence RelocateOnArc DecimalRound DecimalFloor ReplaceNonfiniteValues exp10 MinMerge MaxMerge RowStoreNew RowStoreData RowStoreAppend RowStoreTruncate RowStoreKeepLast RandomMultipliers FindFileOnSearchPath PrintSeparator StripLeadingUnderscores HashCopy1 HashCopy2 HashCopyContent ShortDateTime);
 
 #use Carp;
 use Carp qw(carp croak confess cluck longmess shortmess);
@@ -58,6 +58,8 @@ use Carp qw(carp croak confess cluck longmess shortmess);
 use Switch;
 use Try::Tiny;
 use Scalar::Util qw(looks_like_number);
+use Digest::SHA qw(sha1_hex);
+use File::Spec;
 
 
 use PDL;
@@ -167,13 +169,122 @@ sub FindFileOnSearchPath {
 # TEXT FILE UTILITIES ===================================================================
 
 
+## Any of the Get...FromDataString() functions below also accepts, in place of the data string, an index made from it by DataStringIndexNew().  The index finds every label in one pass, so the lookups no longer search the whole string, and keeps each labeled matrix once it has been asked for, so it is parsed only once.  Given the file the string came from, the label offsets are also kept as a small text sidecar in DataIndexCacheDir() and reused while the file's modification time, size and digest are unchanged.
+
+our $dataIndexCacheDir = File::Spec->catdir(File::Spec->tmpdir(),"RHexDataIndex-$<");
+    # Per user, since whatever is read from it is believed.  Set to '' to neither read nor write sidecars.
+my $dataIndexVersion = 2;
+    # Bump when the index layout changes.
+my %dataIndexDirRefused;
+    # Directories already warned about.
+
+sub DataIndexCacheDir {
+
+    ## Returns $dataIndexCacheDir, made if need be, or '' if sidecars are off, or the directory is not one this user alone can write to.  It must not be a symlink, must be owned by this user, and must not be group or world writable.  Otherwise anyone could plant sidecars there.
+
+    my $dir = $dataIndexCacheDir;
+    if (!$dir){return ''}
+    if (!-e $dir){mkdir($dir,0700)}
+        # If someone else got there first, the checks below refuse it.
+    my @stat = lstat($dir);
+    if (!@stat or !-d _ or $stat[4] != $< or ($stat[2] & 022)){
+        if ($verbose>=1 and !$dataIndexDirRefused{$dir}++){print "WARNING: Not using $dir for data index sidecars, since it is not a directory of your own that others can't write to.\n"}
+        return '';
+    }
+    return $dir;
+}
+
+sub DataIndexSidecarOk {
+    my ($sidecar) = @_;
+
+    ## True if $sidecar exists, and is a plain file of this user's, not a link to something else.
+
+    my @stat = lstat($sidecar);
+    return (@stat and -f _ and $stat[4] == $<) ? 1 : 0;
+}
+
+sub DataStringIndexNew {
+    my ($data,$filename) =  @_;
+
+    ## Returns a hash ref holding the data string itself, the offsets just past the colon of the first and last occurrence of each label, and an initially empty cache of the matrices GetMatFromDataString() has parsed.
+
+    my ($sidecar,$stamp);
+    my $cacheDir = ($filename) ? DataIndexCacheDir() : '';
+    if ($cacheDir){
+        my @stat = stat($filename);
+        if (@stat){
+            $stamp      = join("\t",$dataIndexVersion,$stat[9],$stat[7],sha1_hex($data));
+            $sidecar    = File::Spec->catfile($cacheDir,sha1_hex(File::Spec->rel2abs($filename)).".rhi");
+            if (DataIndexSidecarOk($sidecar)){
+                my $labels = ReadDataIndexSidecar($sidecar,$stamp,\$data);
+                if (defined($labels)){
+                    if ($verbose>=3){print "Using the data index in $sidecar.\n"}
+                    return {data=>$data,labels=>$labels,mats=>{}};
+                }
+            }
+        }
+    }
+
+    my %labels;
+    while ($data =~ m/^([^\s:#]+):/mg){
+        if (exists($labels{$1})){$labels{$1}[1] = pos($data)}
+        else {$labels{$1} = [pos($data),pos($data)]}
+    }
+
+    if (defined($sidecar)){
+        # Write and rename, so a reader never sees a partial file.  Failure just means no sidecar:
+        my $tmpFile = "$sidecar.$$";
+        my $fh;
+        if (open($fh,'>',$tmpFile)){
+            print $fh "$stamp\n";
+            foreach my $label (sort keys %labels){print $fh join("\t",$label,@{$labels{$label}})."\n"}
+            if (!close($fh) or !rename($tmpFile,$sidecar)){unlink($tmpFile)}
+        }
+    }
+
+    return {data=>$data,labels=>\%labels,mats=>{}};
+}
+
+sub ReadDataIndexSidecar {
+    my ($sidecar,$stamp,$dataRef) = @_;
+
+    ## Returns the labels hash from a sidecar written by DataStringIndexNew(), or undef if it is stale, or any of its offsets doesn't fall just after its label and colon in the data.
+
+    my $fh;
+    if (!open($fh,'<',$sidecar)){return undef}
+    my $line = <$fh>;
+    if (!defined($line) or $line ne "$stamp\n"){close $fh; return undef}
+
+    my %labels;
+    my $dataLen = length($$dataRef);
+    while ($line = <$fh>){
+        chomp $line;
+        my ($label,@offsets) = split(/\t/,$line);
+        if (@offsets != 2){close $fh; return undef}
+        foreach my $offset (@offsets){
+            if ($offset !~ /^\d+$/ or $offset <= length($label) or $offset > $dataLen
+                    or substr($$dataRef,$offset-length($label)-1,length($label)+1) ne "$label:"){close $fh; return undef}
+        }
+        $labels{$label} = \@offsets;
+    }
+    close $fh;
+    return \%labels;
+}
+
+
 sub FindLabelInDataString {
     my ($data,$label,$direction) =  @_;
     
-    ## Find a label in the data string.  Label must be at the start of the data or of a line, and directly followed by a colon.  $direction is one of the strings "first", "last".  Returns the index of the first character after the colon.
+    ## Find a label in the data string.  Label must be at the start of the data or of a line, and directly followed by a colon.  $direction is one of the strings "first", "last".  Returns the index of the first character after the colon.  $data may instead be an index from DataStringIndexNew(), which answers without searching.
     
     if (!defined($direction)){$direction = "first"}
 
+    if (ref($data) eq 'HASH'){
+        my $offsets = $data->{labels}{$label};
+        if (!defined($offsets)){return -1}
+        return $offsets->[($direction eq "last") ? 1 : 0];
+    }
+
     # Look at first line by hand:
     my $foundAtZero = 0;
     my $searchStr   = $label.":";
@@ -230,12 +341,13 @@ sub GetValueFromDataString {
     }
     
     # Don't read past the next newline.
-    my $endIndex = CORE::index($data,"\n",$index);
+    my $text = (ref($data) eq 'HASH') ? \$data->{data} : \$data;
+    my $endIndex = CORE::index($$text,"\n",$index);
     #pq($endIndex);
     
     my $str;
-    if ($endIndex eq -1){$str = substr($data,$index)}
-    else {$str = substr($data,$index,$endIndex-$index)}
+    if ($endIndex eq -1){$str = substr($$text,$index)}
+    else {$str = substr($$text,$index,$endIndex-$index)}
     #pq($str);
     
     my $ss;
@@ -280,12 +392,13 @@ sub GetWordFromDataString {
     }
     
     # Don't read past the next newline.
-    my $endIndex = CORE::index($data,"\n",$index);
+    my $text = (ref($data) eq 'HASH') ? \$data->{data} : \$data;
+    my $endIndex = CORE::index($$text,"\n",$index);
     #pq($endIndex);
     
     my $str;
-    if ($endIndex eq -1){$str = substr($data,$index)}
-    else {$str = substr($data,$index,$endIndex-$index)}
+    if ($endIndex eq -1){$str = substr($$text,$index)}
+    else {$str = substr($$text,$index,$endIndex-$index)}
     #pq($str);
 
     my $ss;
@@ -310,12 +423,13 @@ sub FindLabelLineInDataString {
     if ($index < 0){return $index}
     
     # Don't read past the next newline.
-    my $endIndex = CORE::index($data,"\n",$index);
+    my $text = (ref($data) eq 'HASH') ? \$data->{data} : \$data;
+    my $endIndex = CORE::index($$text,"\n",$index);
     #pq($endIndex);
     
     my $str;
     if ($endIndex eq -1){return -3}     # No room for data.  Next line is eof.
-    else {$str = substr($data,$index,$endIndex-$index)}
+    else {$str = substr($$text,$index,$endIndex-$index)}
     #pq($str);
     
     # Check that there is nothing else, except possibly a comment on the label line:
@@ -351,20 +465,21 @@ sub GetQuotedStringFromDataString {
     
     # So $index points to the beginning of the line after the label line.
     
+    my $text = (ref($data) eq 'HASH') ? \$data->{data} : \$data;
     my $string = "";
-    my $tStr = substr($data,$index,1);
-    if (substr($data,$index,1) ne "\'"){return $string}
+    if (substr($$text,$index,1) ne "\'"){return $string}
     $index++;
     
-    my $endIndex = CORE::index($data,"\'\n",$index);
+    my $endIndex = CORE::index($$text,"\'\n",$index);
     if ($endIndex eq -1){return $string}
     
-    return substr($data,$index,$endIndex-$index);
+    return substr($$text,$index,$endIndex-$index);
 }
 
 sub GetMatFromDataString {
     my ($data,$label,$direction,$minVerbose) =  @_;
     if (!defined($minVerbose)){$minVerbose = 4}
+    if (!defined($direction)){$direction = "first"}
     
     ## Label must be at the beginning of a line, followed directly by a colon and a newline.  The next lines must be tab separated numbers, all with the same count.  Loading stops when this condition is not met.  $direction is one of the strings "first", "last".  If undefined, defaults to "first".  Failure to load returns empty pdl.
     
@@ -385,39 +500,44 @@ sub GetMatFromDataString {
     if ($index < 0){return $mat}
     
     # So $index points to the beginning of the line after the label line.
+
+    if (ref($data) ne 'HASH'){return ParseMatInDataString(\$data,$index)}
+
+    # An index keeps each matrix once it has been parsed:
+    my $ii = ($direction eq "last") ? 1 : 0;
+    my $parsed = $data->{mats}{$label}[$ii];
+    if (!defined($parsed)){$parsed = $data->{mats}{$label}[$ii] = ParseMatInDataString(\$data->{data},$index)}
     
-    my $continue = 1;
-    do {
-        #pq $index;
-        my $str;
-        my $endIndex = CORE::index($data,"\n",$index);
-        #pq $endIndex;
-        if ($endIndex eq -1){$str = substr($data,$index)}
-        else {$str = substr($data,$index,$endIndex-$index)}
-        if ($str ne ""){
-            try {
-                my @aArray  = split(/\t/,$str);
-                #print "STR TEST: str=$str\n";
-                #print "aArray=@aArray\n";
-                # Force an error if first array element isn't numeric:
-                if (!looks_like_number($aArray[0])){die}
-                
-                my $count = @aArray;
-                #pq $count;
-                my $row;
-                if ($count == 1)    {$row = $aArray[0]*ones(1)} # Force pdl
-                else                {$row = pdl(@aArray)}
-                #pq $row;
-                $mat = $mat->glue(1,$row);
-            } catch {
-                $continue = 0;
-            };
-            $index = $endIndex+1;
-        } else {$continue = 0}
-        
-    } while ($continue);
-    
-    return $mat;
+    return $parsed->copy;
+}
+
+
+sub ParseMatInDataString {
+    my ($text,$index) =  @_;
+
+    ## Reads the tab separated numerical rows that start at $index in the string $text refers to, stopping at an empty line, a line whose first field is not a number, or a line with a different count.  The values are collected in a single list and made into a pdl once, rather than glued row by row.  A single row gives a 1D pdl, and no rows the empty pdl.
+
+    my (@values,$ncols);
+    my $nrows   = 0;
+    my $length  = length($$text);
+    while ($index < $length){
+        my $endIndex = CORE::index($$text,"\n",$index);
+        if ($endIndex == -1){$endIndex = $length}
+        if ($endIndex == $index){last}
+
+        my @aRow = split(/\t/,substr($$text,$index,$endIndex-$index));
+        if (!@aRow or !looks_like_number($aRow[0])){last}
+        if (!defined($ncols)){$ncols = @aRow}
+        elsif (@aRow != $ncols){last}
+
+        push @values,@aRow;
+        $nrows++;
+        $index = $endIndex+1;
+    }
+
+    if (!$nrows){return zeros(0)}
+    my $mat = pdl(\@values);
+    return ($nrows == 1) ? $mat : $mat->reshape($ncols,$nrows);
 }
 
 
@@ -538,6 +658,105 @@ sub MaxMerge {
     return $comp*$A+!$comp*$B;
 }
 
+
+## Growable result storage.  Appending with glue copies the whole accumulated pdl every time, which goes quadratic over a long run.  A store keeps a buffer with spare room along its last dimension, doubles it when it fills, and hands back a slice of the filled part.  $rowLen of 0 makes a 1D store (times).  Otherwise each row is a column of $rowLen values, as in $Dynams.
+
+# The returned slices share the buffer, so anything that must survive a later truncate and append should be copied.
+
+sub RowStoreNew {
+    my ($rowLen,$capacity) = @_;
+
+	$capacity = ($capacity and $capacity >= 1) ? int($capacity) : 16;
+	my $buf = ($rowLen) ? zeros($rowLen,$capacity) : zeros($capacity);
+	return {buf=>$buf,rowLen=>$rowLen,num=>0};
+}
+
+sub RowStoreData {
+    my ($store) = @_;
+
+	my ($rowLen,$num,$buf) = ($store->{rowLen},$store->{num},$store->{buf});
+	if (!$num){return ($rowLen) ? zeros($rowLen,0) : zeros(0)}
+	return ($rowLen) ? $buf(:,0:$num-1) : $buf(0:$num-1);
+}
+
+sub RowStoreAppend {
+    my ($store,$block) = @_;
+
+	## $block may be a number, a 1D pdl of times or of a single row, or a 2D pdl of rows.  Returns the new filled part.
+
+	$block = pdl($block);
+	my ($rowLen,$num) = ($store->{rowLen},$store->{num});
+	if ($rowLen and $block->dim(0) != $rowLen){croak "ERROR: RowStoreAppend: Row length ".$block->dim(0)." does not match store row length $rowLen.\nStopped"}
+
+	my $numNew = ($rowLen) ? $block->dim(1) : $block->nelem;
+	if (!$numNew or $block->isempty){return RowStoreData($store)}
+
+	my $buf		= $store->{buf};
+	my $needed	= $num+$numNew;
+	my $capacity = ($rowLen) ? $buf->dim(1) : $buf->dim(0);
+	if ($needed > $capacity){
+		while ($capacity < $needed){$capacity *= 2}
+		my $newBuf = ($rowLen) ? zeros($rowLen,$capacity) : zeros($capacity);
+		if ($num){
+			if ($rowLen){$newBuf(:,0:$num-1) .= $buf(:,0:$num-1)}
+			else {$newBuf(0:$num-1) .= $buf(0:$num-1)}
+		}
+		$buf = $store->{buf} = $newBuf;
+	}
+
+	if ($rowLen){$buf(:,$num:$needed-1) .= $block}
+	else {$buf($num:$needed-1) .= $block->flat}
+	$store->{num} = $needed;
+
+	return RowStoreData($store);
+}
+
+sub RowStoreTruncate {
+    my ($store,$numKeep) = @_;
+
+	## Drops rows from the end.  The buffer keeps its size.
+
+	if ($numKeep < 0){$numKeep = 0}
+	if ($numKeep < $store->{num}){$store->{num} = $numKeep}
+	return RowStoreData($store);
+}
+
+sub RowStoreKeepLast {
+    my ($store,$numKeep) = @_;
+
+	## Drops rows from the start, moving the last $numKeep down to the front of the buffer.  The buffer keeps its size.
+
+	my ($rowLen,$num,$buf) = ($store->{rowLen},$store->{num},$store->{buf});
+	if ($numKeep < 0){$numKeep = 0}
+	if ($numKeep >= $num){return RowStoreData($store)}
+	if ($numKeep){
+		if ($rowLen){$buf(:,0:$numKeep-1) .= $buf(:,$num-$numKeep:$num-1)->copy}
+		else {$buf(0:$numKeep-1) .= $buf($num-$numKeep:$num-1)->copy}
+	}
+	$store->{num} = $numKeep;
+	return RowStoreData($store);
+}
+
+
+sub RandomMultipliers {
+	my ($num,$variation,$seed) = @_;
+
+	## Returns $num independent lognormal draws with mean 1 and standard deviation $variation, or undef if $variation is zero.  The same seed always gives the same draws.  Uses (and reseeds) perl's rand(), which nothing in a run otherwise touches.
+
+	if (!$variation){return undef}
+
+	srand($seed);
+	my $sigma	= sqrt(log(1+$variation**2));
+	my @draws;
+	while (@draws < $num){
+		# Box-Muller, two normals per pair of uniforms:
+		my $rr = sqrt(-2*log(1-rand()));
+		my $th = 2*$pi*rand();
+		push @draws,$rr*cos($th),$rr*sin($th);
+	}
+	return exp($sigma*pdl(@draws[0..$num-1]) - $sigma**2/2);
+}
+
 =begin comment
 
 sub Round {
@@ -595,6 +814,22 @@ sub HashCopy2 {      # Require identical structure.  No checking.
 }
 
 
+sub HashCopyContent {
+
+	## No checking whether the structures match.  However, does test source fields for being defined and non-empty.  In that case, does not overwrite the destination field.  Used for loading settings files, both from the control panels and in batch runs.
+    my ($r_src,$r_target) = @_;
+    
+    foreach my $l0 (keys %$r_target) {
+        foreach my $l1 (keys %{$r_target->{$l0}}) {
+			my $val = $r_src->{$l0}{$l1};
+			if (defined($val) and $val ne ''){
+            	$r_target->{$l0}{$l1} = $r_src->{$l0}{$l1};
+			}
+        }
+    }
+}
+
+
 
 
 # PDL UTILITIES ==============================================================
@@ -1652,12 +1887,14 @@ sub RodTorqueKs { my $verbose = 0?$verbose:0;
 
 
 sub SmoothDriver {
-    my ($smoothingOrder,$smoothEnds,$plotOptsRef,$driverTs,$driverXs,$driverYs,$driverZs,$driverDXs,$driverDYs,$driverDZs) = @_;
+    my ($smoothing,$smoothEnds,$plotOptsRef,$driverTs,$driverXs,$driverYs,$driverZs,$driverDXs,$driverDYs,$driverDZs) = @_;
 	
-	## Smooth hand-drawn drivers by trigonometric fitting and start and stop smoothing.  If $smoothEnds, applies SmoothChar to that many points in from each end.
+	## Smooth hand-drawn drivers by trigonometric fitting and start and stop smoothing.  If $smoothEnds, applies SmoothChar to that many points in from each end.  $smoothing is either the fourier order, or a hash ref with fields method ("fourier" or "savgol"), order and, for savgol, halfWidth.  Savitzky-Golay smoothing, with order the polynomial order, costs time linear in the number of points, and suits very long video-derived tracks.
 	
 	my $nargin = @_;
 	
+	my ($method,$smoothingOrder,$halfWidth) = (ref($smoothing) eq 'HASH') ?
+			@{$smoothing}{qw(method order halfWidth)} : ("fourier",$smoothing,undef);
 	if (!$smoothingOrder){return};
 	
 	#pq($smoothingOrder);
@@ -1672,13 +1909,17 @@ sub SmoothDriver {
 	else { croak "Error: Bad number of arguments.\n"}
 	
 	my $nPts = $driverTs->nelem;
-	if ($smoothingOrder > ($nPts-1)/2){croak "Error: \$smoothingOrder must be less than (numPts-1)/2.\n"}
 	
 	#pq($driverTs,$ys);
 	
-	my ($fit,$fits,$coeffs)
-			= fourfit($driverTs,$ys,$smoothingOrder);
-	#pq($fit,$fits,$coeffs);
+	my ($fit,$fits);
+	if ($method eq "savgol"){
+		($fit,$fits) = sgsmooth($ys,$halfWidth,$smoothingOrder);
+	} else {
+		if ($smoothingOrder > ($nPts-1)/2){croak "Error: \$smoothingOrder must be less than (numPts-1)/2.\n"}
+		($fit,$fits) = fourfitqr($driverTs,$ys,$smoothingOrder);
+	}
+	#pq($fit,$fits);
 	
 	if ($smoothEnds){
 
@@ -1784,7 +2025,7 @@ use constant DEBUG => 1;    # 0, or non-zero for debugging behavior, including h
 
 =head1 EXPORT
 
-DEBUG $launchDir $verbose $debugVerbose $vs $rSwingOutFileTag $rCastOutFileTag $inf $neginf $nan $pi $massFactor $massDensityAir $airBlubsPerIn3 $kinematicViscosityAir $kinematicViscosityWater $waterBlubsPerIn3 $waterOzPerIn3 $massDensityWater $grPerOz $hexAreaFactor $hex2ndAreaMoment GradedFiberMoments $typeFactor StationDataToDiams DiamsToStationData DefaultDiams DefaultThetas IntegrateThetas ResampleThetas OffsetsToThetasAndSegs NodeCenteredSegs SegShares RodSegMasses MassesMasses FerruleLocs FerruleMasses RodTorqueKs GetValueFromDataString GetWordFromDataString GetArrayFromDataString GetQuotedStringFromDataString SetDataStringFromMat GetMatFromDataString Str2Vect BoxcarVect LowerTri ResampleVectLin ResampleVect SplineNew SplineEvaluate  SmoothChar SmoothZeroLinear SmoothLinear SecantOffsets SkewSequence RelocateOnArc ReplaceNonfiniteValues exp10 MinMerge MaxMerge PrintSeparator StripLeadingUnderscores HashCopy1 HashCopy2 ShortDateTime
+DEBUG $launchDir $verbose $debugVerbose $vs $rSwingOutFileTag $rCastOutFileTag $inf $neginf $nan $pi $massFactor $massDensityAir $airBlubsPerIn3 $kinematicViscosityAir $kinematicViscosityWater $waterBlubsPerIn3 $waterOzPerIn3 $massDensityWater $grPerOz $hexAreaFactor $hex2ndAreaMoment GradedFiberMoments $typeFactor StationDataToDiams DiamsToStationData DefaultDiams DefaultThetas IntegrateThetas ResampleThetas OffsetsToThetasAndSegs NodeCenteredSegs SegShares RodSegMasses MassesMasses FerruleLocs FerruleMasses RodTorqueKs DataStringIndexNew GetValueFromDataString GetWordFromDataString GetArrayFromDataString GetQuotedStringFromDataString SetDataStringFromMat GetMatFromDataString Str2Vect BoxcarVect LowerTri ResampleVectLin ResampleVect SplineNew SplineEvaluate  SmoothChar SmoothZeroLinear SmoothLinear SecantOffsets SkewSequence RelocateOnArc ReplaceNonfiniteValues exp10 MinMerge MaxMerge RowStoreNew RowStoreData RowStoreAppend RowStoreTruncate RowStoreKeepLast RandomMultipliers PrintSeparator StripLeadingUnderscores HashCopy1 HashCopy2 HashCopyContent ShortDateTime
 
 =head1 AUTHOR
 
@@ -0,0 +1,205 @@
+# RCommonCache.pm
+
+#################################################################################
+##
+## RHex - 3D dyanmic simulation of fly casting and swinging.
+## Copyright (C) 2019 Rich Miller <rich@ski.org>
+##
+## This file is part of RHex.
+##
+## RHex is free software: you can redistribute it and/or modify it under the
+## terms of the GNU General Public License as published by the Free Software
+## Foundation, either version 3 of the License, or (at your option) any later
+## version.
+##
+## RHex is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+## without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+## PURPOSE.  See the GNU General Public License for more details.
+##
+## You should have received a copy of the GNU General Public License along with RHex.
+## If not, see <https://www.gnu.org/licenses/>.
+##
+## RHex makes system calls to the Gnuplot executable, Copyright 1986 - 1993, 1998,
+## 2004 Thomas Williams, Colin Kelley.  It makes static links to the Gnu Scientific
+## Library, which is copyrighted and available under the GNU General Public License.
+## In addition, RHex incorporates code from the Perl core and numerous Perl libraries,
+## all of which are free software, redistributable and/or modifable under the same
+## terms as Perl itself (Perl License).  Finally, the modules Brent, DiffEq, and
+## Numjac in the directory RUtils are modifications and translations into Perl of
+## copyrighted material.  You can find the details in the individual files.
+##
+##################################################################################
+
+package RCommonCache;
+
+## Run cache for RCast3D and RSwing3D.  Completed runs are stored, in the binary data format, under a key made from everything that determines the result: the settings that affect the integration, the contents of the loaded spec files, and the RHex source itself.  The end time is not part of the key.  A cached run that went at least as far as the one requested replaces the integration entirely, and a shorter one is used as the start of the run, which then continues from its final state.
+
+use warnings;
+use strict;
+
+our $VERSION='0.01';
+
+use Exporter 'import';
+our @EXPORT = qw(RunCacheKey RunCacheFind RunCacheStore);
+
+use RCommon;
+use RCommonPlot3D qw (RCommonSaveBinary3D RCommonLoadBinary3D);
+
+use Carp;
+use Digest::SHA qw (sha1_hex);
+use File::Path qw (make_path);
+
+use PDL;
+
+
+# Settings that only affect output, reporting or plotting, and so don't change the stored solution.  Anything not listed here goes into the key, which at worst costs a miss:
+my %ignoredFields = (
+    integration => [qw(t1 savePlot saveData saveBinary streamFile streamSyncSecs streamMemoryRows streamResume livePlot livePlotFPS runCacheDir debugVerboseName reportVerboseName verbose switchOnSlowing plotZScale showLineVXs plotLineVYs plotLineVAs plotLineVNs plotLine_rDots)],
+    file        => [qw(settings save rCast rSwing rod line leader driver)],
+);
+
+my $codeDigest;
+
+sub CodeDigest {
+
+    ## Digest of the RHex modules actually loaded, so that any change in the code invalidates the cache.
+
+    if (!defined($codeDigest)){
+        my $sha = Digest::SHA->new(1);
+        foreach my $module (sort grep {/^(R[A-Z]\w*|RUtils\/\w+)\.pm$/} keys %INC){
+            if (-e $INC{$module}){$sha->addfile($INC{$module})}
+        }
+        $codeDigest = $sha->hexdigest;
+    }
+    return $codeDigest;
+}
+
+
+sub CanonicalString {
+    my ($val) = @_;
+
+    ## Sorted, unambiguous rendering of nested hashes and arrays.
+
+    if (ref($val) eq 'HASH'){
+        return '{'.join(',',map {"$_=>".CanonicalString($val->{$_})} sort keys %$val).'}';
+    } elsif (ref($val) eq 'ARRAY'){
+        return '['.join(',',map {CanonicalString($_)} @$val).']';
+    } elsif (ref($val) eq 'PDL'){
+        return '<'.join(',',$val->list).'>';
+    }
+    return (defined($val)) ? "'$val'" : 'undef';
+}
+
+
+sub RunCacheKey {
+    my ($rps,$runType) = @_;
+
+    ## Returns the hex key for the current settings and loaded files.  Call after the spec files have been loaded.
+
+    my %effective;
+    foreach my $section (keys %$rps){
+        if (ref($rps->{$section}) ne 'HASH'){next}
+        my %copy = %{$rps->{$section}};
+        if (exists($ignoredFields{$section})){delete @copy{@{$ignoredFields{$section}}}}
+        $effective{$section} = \%copy;
+    }
+
+    my $sha = Digest::SHA->new(1);
+    $sha->add($runType,"\n",CodeDigest(),"\n",CanonicalString(\%effective),"\n");
+    foreach my $key (qw(rod line leader driver)){
+        my $file = $rps->{file}{$key};
+        if (defined($file) and $file ne '' and -f $file){
+            $sha->add("$key\n");
+            $sha->addfile($file);
+        }
+    }
+    return $sha->hexdigest;
+}
+
+
+sub RunCacheFind {
+    my ($cacheDir,$key) = @_;
+
+    ## Returns the cached run as loaded by RCommonLoadBinary3D(), or undef.  The stored solution is in StoredTs, StoredDynams and, if energy accounting was on, StoredEnergies.
+
+    my $filename = "$cacheDir/$key.rhb";
+    if (!-e $filename){return undef}
+
+    my $run = RCommonLoadBinary3D($filename);
+    if (!defined($run) or !defined($run->{StoredTs}) or !defined($run->{StoredDynams}) or $run->{StoredTs}->isempty){
+        print "WARNING: Ignoring unreadable cache file $filename.\n";
+        return undef;
+    }
+    return $run;
+}
+
+
+sub RunCacheStore {
+    my ($cacheDir,$key,$T,$Dynams,$Energies,@saveArgs) = @_;
+
+    ## @saveArgs as for RCommonSaveBinary3D(), without the filename.  Replaces any cached run for this key that ended earlier.  Written under a temporary name and renamed, so that simultaneous sweep runs never see a partial file.
+
+    my $filename = "$cacheDir/$key.rhb";
+    if (-e $filename){
+        my $old = RCommonLoadBinary3D($filename);
+        if (defined($old) and defined($old->{StoredTs}) and !$old->{StoredTs}->isempty
+                and $old->{StoredTs}->at($old->{StoredTs}->nelem-1) >= $T->at($T->nelem-1)){return}
+    }
+
+    make_path($cacheDir);
+    my $tmpBase = "$cacheDir/$key.tmp$$";
+    my @extras = ([StoredTs=>$T],[StoredDynams=>$Dynams]);
+    if (defined($Energies)){push @extras,[StoredEnergies=>$Energies]}
+    RCommonSaveBinary3D($tmpBase,@saveArgs,\@extras);
+    if (!rename("$tmpBase.rhb",$filename)){
+        print "WARNING: Could not store run in cache ($!).\n";
+        unlink("$tmpBase.rhb");
+        return;
+    }
+    if ($verbose>=2){print "Stored run in cache as $filename\n"}
+}
+
+
+# Required package return value:
+1;
+
+__END__
+
+=head1 NAME
+
+RCommonCache - Stores completed runs and finds them again, keyed on everything that determines the result.
+
+=head1 SYNOPSIS
+
+use RCommonCache;
+
+=head1 EXPORT
+
+RunCacheKey RunCacheFind RunCacheStore
+
+=head1 AUTHOR
+
+Rich Miller, E<lt>rich@ski.orgE<gt>
+
+=head1 COPYRIGHT AND LICENSE
+
+RHex - 3D dyanmic simulation of fly casting and swinging.
+
+Copyright (C) 2019 Rich Miller
+
+This file is part of RHex.
+
+RHex is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RHex is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RHex.  If not, see <https://www.gnu.org/licenses/>.
+
+=cut
@@ -82,7 +82,7 @@ use File::Spec::Functions qw ( rel2abs abs2rel splitpath );
 
 use RUtils::Print;
 
-use RCommon qw (DEBUG $verbose $restoreVerbose $debugVerbose $reportVerbose $switchVerbose $rps %runControl $doSetup $doRun $doSave $loadRod $loadDriver @rodFieldsDisable  @driverFieldsDisable $vs);
+use RCommon qw (DEBUG $verbose $restoreVerbose $debugVerbose $reportVerbose $switchVerbose $rps %runControl $doSetup $doRun $doSave $loadRod $loadDriver @rodFieldsDisable  @driverFieldsDisable $vs HashCopyContent);
 use RCommonLoad qw (LoadLine LoadLeader @lineFieldsDisable @leaderFieldsDisable);
 use RCommonHelp;
 
@@ -128,21 +128,6 @@ sub HashCopy {
 }
 
 
-sub HashCopyContent {
-
-	## No checking whether the structures match.  However, does test source fields for being defined and non-empty.  In that case, does not overwrite the destination field.
-    my ($r_src,$r_target) = @_;
-    
-    foreach my $l0 (keys %$r_target) {
-        foreach my $l1 (keys %{$r_target->{$l0}}) {
-			my $val = $r_src->{$l0}{$l1};
-			if (defined($val) and $val ne ''){
-            	$r_target->{$l0}{$l1} = $r_src->{$l0}{$l1};
-			}
-        }
-    }
-}
-
 sub StrictRel2Abs {
 	my ($relFilePath,$baseDirPath) = @_;
 
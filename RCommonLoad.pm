@@ -385,6 +385,7 @@ sub LoadLeader {
         	$inData = <INFILE>;
 		}
         close INFILE;
+        my $inIndex = DataStringIndexNew($inData,$leaderFile);
         
 		if ($updatingPanel){
 			# Swap enabled fields to storage.  If we're coming from params, the menu field will be enabled.
@@ -405,16 +406,16 @@ sub LoadLeader {
         $rps->{leader}{identifier} = $leaderIdentifier;
  
 		# See what's available in the file:
-		$weights 		= GetMatFromDataString($inData,"Weights");
-		$diams			= GetMatFromDataString($inData,"Diameters");
-		$length			= GetValueFromDataString($inData,"Length");
-		#$nomWt			= GetValueFromDataString($inData,"NominalWeight");
-		$coreDiam		= GetValueFromDataString($inData,"CoreDiameter");
-		$elasticMod		= GetValueFromDataString($inData,"ElasticModulus");
-		$dampingMod		= GetValueFromDataString($inData,"DampingModulus");
-
-		$specGravity	= GetValueFromDataString($inData,"SpecificGravity");
-		$material		= GetWordFromDataString($inData,"Material");
+		$weights 		= GetMatFromDataString($inIndex,"Weights");
+		$diams			= GetMatFromDataString($inIndex,"Diameters");
+		$length			= GetValueFromDataString($inIndex,"Length");
+		#$nomWt			= GetValueFromDataString($inIndex,"NominalWeight");
+		$coreDiam		= GetValueFromDataString($inIndex,"CoreDiameter");
+		$elasticMod		= GetValueFromDataString($inIndex,"ElasticModulus");
+		$dampingMod		= GetValueFromDataString($inIndex,"DampingModulus");
+
+		$specGravity	= GetValueFromDataString($inIndex,"SpecificGravity");
+		$material		= GetWordFromDataString($inIndex,"Material");
 		#pq($weights,$diams,$specGravity,$material,$elasticMod,$dampingMod);
 		
 		if ($weights->isempty and $diams->isempty){$ok=0; print "ERROR: Leader file must have values for Weights or Diameters, or both.\n";}
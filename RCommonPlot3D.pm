@@ -44,8 +44,8 @@ use POSIX ();
     # Require rather than use avoids the redefine warning when loading PDL.  But then I must always explicitly name the POSIX functions. See http://search.cpan.org/~nwclark/perl-5.8.5/ext/POSIX/POSIX.pod.  Implements a huge number of unixy (open ...) and mathy (floor ...) things.
 
 use Exporter 'import';
-#our @EXPORT = qw( spectrum2 RCommonPlot3D RCommonSave3D);
-our @EXPORT = qw( $gnuplot RCommonPlot3D RCommonSave3D);
+#our @EXPORT = qw( RCommonPlot3D RCommonSave3D);
+our @EXPORT = qw( $gnuplot $headless RCommonPlot3D RCommonSave3D RCommonSaveBinary3D RCommonLoadBinary3D RCommonLoad3D RCommonLoadTraces3D TurnoverTime ResultStreamOpen ResultStreamRead ResultStreamAppend ResultStreamDropLast ResultStreamFlush ResultStreamClose LivePlotOpen LivePlotAppend LivePlotDropLast LivePlotClose);
 
 use Carp;
 
@@ -56,6 +56,8 @@ use PDL::AutoLoader;    # MATLAB-like autoloader.
 use PDL::NiceSlice;
 use PDL::Options;       # For iparse. http://pdl.perl.org/index.php?docs=Options&title=PDL::Options
 
+use File::Temp qw(tempdir);
+
 use RUtils::Print;
 use RUtils::Plot qw (TEST_RUN_PROCESS TEST_FORK_SYSTEM);	# Only for testing.
 use RUtils::Gnuplot;
@@ -63,19 +65,96 @@ use RUtils::Gnuplot;
 use RCommon;
 
 our $gnuplot = '';
+our $headless = 0;
+	# Set by batch runs, which have no display.  Window plots are then skipped.
 
 
-sub spectrum2 {
-    my ($rgb0,$rgb1,$fract)= @_;
-    # 3-component flat pdls, each in range 0:255;
+sub SelectTraces {
+    my ($Ts,$Xs,$Ys,$Zs,$maxTraces,$method) = @_;
+    
+    ## Returns the indices of at most $maxTraces traces, always including the first and the last.  Method "uniform" spaces them uniformly in time, "motion" uniformly in the accumulated node displacement between successive traces, so that the plot thins out where the rod and line hardly move and keeps the detail where they move a lot.
+    
+    my $numTraces = $Ts->nelem;
+    if ($maxTraces < 2 or $numTraces <= $maxTraces){return sequence(long,$numTraces)}
+    
+    my $coords = $Ts;
+    if ($method eq "motion"){
+        my $dsq = ($Xs(:,1:-1)-$Xs(:,0:-2))**2 + ($Ys(:,1:-1)-$Ys(:,0:-2))**2 + ($Zs(:,1:-1)-$Zs(:,0:-2))**2;
+        $dsq->where(!$dsq->isfinite) .= 0;
+        my $moves = sqrt(sumover($dsq));
+        if ($moves->sum > 0){$coords = zeros(1)->glue(0,$moves)->cumusumover}
+    }
+    
+    my @coords  = $coords->list;
+    my $c0      = $coords[0];
+    my $dc      = ($coords[-1]-$c0)/($maxTraces-1);
+    
+    # Walk the non-decreasing coordinates once, taking the first trace at or past each target:
+    my @indices = (0);
+    my $ii = 0;
+    for (my $kk=1;$kk<$maxTraces-1;$kk++){
+        my $target = $c0+$kk*$dc;
+        while ($ii<$numTraces-1 and $coords[$ii]<$target){$ii++}
+        if ($ii > $indices[-1]){push @indices,$ii}
+    }
+    if ($indices[-1] < $numTraces-1){push @indices,$numTraces-1}
+    
+    return long(\@indices);
+}
+
+
+sub SimplifyMask {
+    my ($Xs,$Ys,$Zs,$tolerance) = @_;
+    
+    ## Ramer-Douglas-Peucker on each trace's node polyline.  Returns a byte mask with the dims of $Xs, set on the nodes to draw.  No dropped node lies farther than $tolerance from the drawn polyline.  Traces with non-finite coordinates are kept whole.
+    
+    my $mask = zeros(byte,$Xs->dims);
+    my ($numPoints,$numTraces) = $Xs->dims;
+    if (!$numTraces){$numTraces = 1}
+    
+    if ($numPoints <= 2 or $tolerance <= 0){$mask .= 1; return $mask}
+    
+    my $tolSq = $tolerance**2;
+    
+    for (my $ii=0;$ii<$numTraces;$ii++){
+        
+        my @xs = $Xs(:,$ii)->list;
+        my @ys = $Ys(:,$ii)->list;
+        my @zs = $Zs(:,$ii)->list;
+        
+        my $mask1 = $mask(:,$ii);
+        if (!all(isfinite(pdl(\@xs,\@ys,\@zs)))){$mask1 .= 1; next}
+        
+        my @keep = (0) x $numPoints;
+        @keep[0,-1] = (1,1);
+        
+        my @stack = ([0,$numPoints-1]);
+        while (my $span = pop @stack){
+            my ($i0,$i1) = @$span;
+            next if ($i1-$i0 < 2);
+            
+            my @d = ($xs[$i1]-$xs[$i0],$ys[$i1]-$ys[$i0],$zs[$i1]-$zs[$i0]);
+            my $dd = $d[0]**2+$d[1]**2+$d[2]**2;
+            
+            my ($iMax,$distSqMax) = (-1,-1);
+            for (my $jj=$i0+1;$jj<$i1;$jj++){
+                my @p = ($xs[$jj]-$xs[$i0],$ys[$jj]-$ys[$i0],$zs[$jj]-$zs[$i0]);
+                # Squared distance from the segment, not the whole line, so kinks that double back are caught:
+                my $t = ($dd > 0) ? ($p[0]*$d[0]+$p[1]*$d[1]+$p[2]*$d[2])/$dd : 0;
+                if ($t<0){$t=0}elsif($t>1){$t=1}
+                my $distSq = ($p[0]-$t*$d[0])**2+($p[1]-$t*$d[1])**2+($p[2]-$t*$d[2])**2;
+                if ($distSq > $distSqMax){($iMax,$distSqMax) = ($jj,$distSq)}
+            }
+            
+            if ($distSqMax > $tolSq){
+                $keep[$iMax] = 1;
+                push @stack,[$i0,$iMax],[$iMax,$i1];
+            }
+        }
+        $mask1 .= byte(\@keep);
+    }
     
-    my $colors = $rgb0->glue(1,$rgb1);
-    my $fracts = zeros(2);
-    $fracts(0) .= 1-$fract;
-    $fracts(1) .= $fract;
-    my $rgb = ($fracts x $colors)->flat->floor;
-    my $val = sclr($rgb(0)*65536 + $rgb(1)*256 + $rgb(2));
-    return sprintf("#%x",$val);
+    return $mask;
 }
 
 use RUtils::Plot;
@@ -85,11 +164,17 @@ sub RCommonPlot3D {
     $Ts,$Xs,$Ys,$Zs,$XLineTips,$YLineTips,$ZLineTips,$XLeaderTips,$YLeaderTips,$ZLeaderTips,$numRodNodes,$plotBottom,$errMsg,$verbose,$opts) = @_;
 	
     $opts = {iparse( {gnuplot=>'',ZScale=>1,RodStroke=>1,RodTip=>6,RodHandle=>1,RodTicks=>0,
-        ShowLine=>1,LineStroke=>1,LineTicks=>0,LineTip=>13,LeaderTip=>9,Fly=>5},
+        ShowLine=>1,LineStroke=>1,LineTicks=>0,LineTip=>13,LeaderTip=>9,Fly=>5,
+        MaxTraces=>0,TraceSelect=>"uniform",NodeTolerance=>0},
         ifhref($opts))};
+        # Level of detail:  If MaxTraces is at least 2, no more than that many traces are drawn, chosen by TraceSelect ("uniform" in time, or "motion").  If NodeTolerance (inches) is positive, the rod and line polylines are simplified to within that distance.  Only what goes to gnuplot is reduced, never the data.
+    
+    if ($headless and $output eq 'window'){return}
+    
     my ($zScale,$rodStroke,$rodTip,$rodHandle,$rodTicks,
-    $showLine,$lineStroke,$lineTicks,$lineTip,$leaderTip,$fly) =
-    map {$opts->{$_}} qw/ ZScale RodStroke RodTip RodHandle RodTicks ShowLine LineStroke LineTicks LineTip LeaderTip Fly/;
+    $showLine,$lineStroke,$lineTicks,$lineTip,$leaderTip,$fly,
+    $maxTraces,$traceSelect,$nodeTolerance) =
+    map {$opts->{$_}} qw/ ZScale RodStroke RodTip RodHandle RodTicks ShowLine LineStroke LineTicks LineTip LeaderTip Fly MaxTraces TraceSelect NodeTolerance/;
     
     #print "opts=($rodStroke,$rodTip,$rodHandle,$rodTicks,$showLine,$lineStroke,$lineTip,$lineTicks)\n";
     
@@ -122,6 +207,23 @@ sub RCommonPlot3D {
     if (!$numTraces){$numTraces = 1}
     
     my $numLineNodes = $numNodes-$numRodNodes;
+    
+    # Thin the traces.  Their colors still place them in the full run:
+    my $traceIndices = sequence($numTraces);
+    if ($maxTraces >= 2 and $numTraces > $maxTraces){
+        $traceIndices = SelectTraces($Ts,$Xs,$Ys,$Zs,$maxTraces,$traceSelect);
+        if ($verbose>=2){print "Drawing ".$traceIndices->nelem." of $numTraces traces ($traceSelect).\n"}
+        
+        $Ts = $Ts->dice_axis(0,$traceIndices);
+        foreach my $array ($Xs,$Ys,$Zs,$XLineTips,$YLineTips,$ZLineTips,$XLeaderTips,$YLeaderTips,$ZLeaderTips){
+            $array = $array->dice_axis(1,$traceIndices);
+        }
+    }
+    my $numTracesAll = $numTraces;
+    $numTraces = $traceIndices->nelem;
+    
+    my $tolerance = $nodeTolerance*$inchesToCms/$feetToCms;
+    
     if (!$showLine){
         $Xs = $Xs(0:$numRodNodes-1);
         $Ys = $Ys(0:$numRodNodes-1);
@@ -129,123 +231,79 @@ sub RCommonPlot3D {
     }
     
     ## See Chart/Gnuplot/Util.pm for the conversion of named linetype, pointtype, etc to numerical equivalents.
-    my $rgb0 = pdl('0,255,0');  # Start on green,
-    my $rgb1 = pdl('255,0,0');  # end on red.
-    
+
+    # Trace colors go from green at the start to red at the end, as rgb integers for gnuplot's "linecolor rgb variable":
+    my $fracts  = $traceIndices/$numTracesAll;
+    my $rgbs    = floor(255*$fracts)*65536 + floor(255*(1-$fracts))*256;
+
+    # Each element (the rod, its tip, ...) becomes one binary array of (x,y,z,rgb) rows holding all the traces, each trace followed by a row of nans so gnuplot doesn't connect it to the next.  One dataset per element then plots every trace, and the arrays go to gnuplot as raw doubles:
+    my $dataDir = tempdir(CLEANUP => 1);
+
+    my $iEnd    = ($numRodNodes>=2) ? 1 : 0;
+    my @elements = (
+        # [xs, ys, zs, linetype, pointtype, simplify], with dims (numPoints,numTraces).  Ticked polylines keep all their nodes:
+        [$Xs(0:$numRodNodes-1,:),$Ys(0:$numRodNodes-1,:),$Zs(0:$numRodNodes-1,:),
+            $rodStroke,($rodTicks) ? 1 : 0,!$rodTicks],                                 # rod
+        [$Xs($numRodNodes-1,:),$Ys($numRodNodes-1,:),$Zs($numRodNodes-1,:),
+            0,$rodTip],                                                                 # Mark the rod tip.
+        [$Xs(0:$iEnd,:),$Ys(0:$iEnd,:),$Zs(0:$iEnd,:),
+            0,$rodHandle]);                                                             # Mark the rod handle.
+    if ($numLineNodes>0 and $showLine){
+        push @elements,
+        [$Xs($numRodNodes-1:-1,:),$Ys($numRodNodes-1:-1,:),$Zs($numRodNodes-1:-1,:),
+            $lineStroke,($rodTicks) ? 1 : 0,!$rodTicks],                                # line.  Sic, line starts at rod tip.
+        [$Xs(-1,:),$Ys(-1,:),$Zs(-1,:),
+            $lineStroke,$fly],                                                          # Mark the fly.
+        [$XLineTips(0,:),$YLineTips(0,:),$ZLineTips(0,:),
+            $lineStroke,$lineTip],                                                      # Mark the line-leader junction.
+        [$XLeaderTips(0,:),$YLeaderTips(0,:),$ZLeaderTips(0,:),
+            $lineStroke,$leaderTip];                                                    # Mark the leader-tippet junction.
+    }
+
     my ($xMin,$yMin,$zMin) = map {$inf} (0..2);
     my ($xMax,$yMax,$zMax) = map {$neginf} (0..2);
-    
+
     my @dataSets = ();
-    my $iDataSet = 0;
-    
-    for (my $ii=0;$ii<$numTraces;$ii++) {
-        
-        my $fract = $ii/$numTraces;
-        my $color = spectrum2($rgb0,$rgb1,$fract);
-        my $jjBnd = ($numLineNodes>0 and $showLine) ? 7 : 3;
+    for (my $jj=0;$jj<@elements;$jj++){
+
+        my ($xs,$ys,$zs,$linetype,$pointtype,$simplify) = @{$elements[$jj]};
+        my $numPoints = $xs->dim(0);
+
+        my $gaps = $nan*ones(1,$numTraces);
+        my $rows = cat($xs->glue(0,$gaps),$ys->glue(0,$gaps),$zs->glue(0,$gaps),
+                            $rgbs->dummy(0,$numPoints+1))->reorder(2,0,1)->double->copy;
+            # Dims (4,numPoints+1,numTraces), so the rows are contiguous in memory.
         
-        for (my $jj=0;$jj<$jjBnd;$jj++) {
-            
-            my $linetype;
-            my $pointtype;
-            my (@aPlotXs,@aPlotYs,@aPlotZs);
-            
-            if ($jj==0){    # rod
-                #pq($jj);
-                $linetype   = $rodStroke;
-                $pointtype  = ($rodTicks) ? 1 : 0;
-                @aPlotXs = $Xs(0:$numRodNodes-1,$ii)->list;
-                @aPlotYs = $Ys(0:$numRodNodes-1,$ii)->list;
-                @aPlotZs = $Zs(0:$numRodNodes-1,$ii)->list;
-            } elsif ($jj==1) {    # Mark the rod tip:
-                #pq($jj);
-                $linetype   = 0;
-                $pointtype  = $rodTip;
-                @aPlotXs = $Xs($numRodNodes-1,$ii)->list;
-                @aPlotYs = $Ys($numRodNodes-1,$ii)->list;
-                @aPlotZs = $Zs($numRodNodes-1,$ii)->list;
-            } elsif ($jj==2) {    # Mark the rod handle:
-                #pq($jj);
-                $linetype   = 0;
-                $pointtype  = $rodHandle;
-                my $iEnd = ($numRodNodes>=2) ? 1 : 0;
-                @aPlotXs = $Xs(0:$iEnd,$ii)->list;
-                @aPlotYs = $Ys(0:$iEnd,$ii)->list;
-                @aPlotZs = $Zs(0:$iEnd,$ii)->list;
-            } elsif ($jj==3) { # line
-                #pq($jj);
-                $linetype   = $lineStroke;
-                $pointtype  = ($rodTicks) ? 1 : 0;
-                @aPlotXs = $Xs($numRodNodes-1:-1,$ii)->list;
-                @aPlotYs = $Ys($numRodNodes-1:-1,$ii)->list;
-                @aPlotZs = $Zs($numRodNodes-1:-1,$ii)->list;
-                # Sic, line starts at rod tip.
-            } elsif ($jj==4) {    # Mark the fly:
-                #pq($jj);
-                $linetype   = $lineStroke;  # long dash
-                $pointtype  = $fly;
-                #$pointtype  = 7; # solid circle
-                @aPlotXs = $Xs(-1,$ii)->list;
-                @aPlotYs = $Ys(-1,$ii)->list;
-                @aPlotZs = $Zs(-1,$ii)->list;
-                #pq(\@aPlotXs,\@aPlotYs);
-            } elsif ($jj==5) {    # Mark the line-leader junction:
-                #pq($jj);
-                $linetype   = $lineStroke;  # long dash
-                $pointtype  = $lineTip; # dot-triangle
-                #$pointtype  = 9; # solid triangle
-                @aPlotXs = $XLineTips(0,$ii)->list;
-                @aPlotYs = $YLineTips(0,$ii)->list;
-                @aPlotZs = $ZLineTips(0,$ii)->list;
-                #pq(\@aPlotXs,\@aPlotYs);
-            } elsif ($jj==6) {    # Mark the leader-tippet junction:
-                #pq($jj);
-                $linetype   = $lineStroke;  # long dash
-                $pointtype  = $leaderTip;
-                #$pointtype  = 5; # solid square
-                @aPlotXs = $XLeaderTips(0,$ii)->list;
-                @aPlotYs = $YLeaderTips(0,$ii)->list;
-                @aPlotZs = $ZLeaderTips(0,$ii)->list;
-            }
-            
-            $dataSets[$iDataSet++] = RUtils::Gnuplot::DataSet->new(
-                linetype => "$linetype",
-                pointtype => "$pointtype",
-                style => "linespoints",
-                color => "$color",
-                xdata => \@aPlotXs,
-                ydata => \@aPlotYs,
-                zdata => \@aPlotZs,
-            );
-            #pq($jj,\@aPlotXs,\@aPlotYs,\@aPlotZs);
-            
-            # Gather plot bounds data:
-            my $xs = pdl(@aPlotXs);
-            my $ys = pdl(@aPlotYs);
-            my $zs = pdl(@aPlotZs);
-            
-            $xs = where($xs,$xs->isfinite);
-            $ys = where($ys,$ys->isfinite);
-            $zs = where($zs,$zs->isfinite);
-
-            #if (all($xs->isfinite)){
-            if (!$xs->isempty){
-                my $txMin = $xs->min;
-                my $txMax = $xs->max;
-                if ($txMin < $xMin){$xMin = $txMin}
-                if ($txMax > $xMax){$xMax = $txMax}
-            }
-            if (!$ys->isempty){
-                my $tyMin = $ys->min;
-                my $tyMax = $ys->max;
-                if ($tyMin < $yMin){$yMin = $tyMin}
-                if ($tyMax > $yMax){$yMax = $tyMax}
-            }
-            if (!$zs->isempty){
-                my $tzMin = $zs->min;
-                my $tzMax = $zs->max;
-                if ($tzMin < $zMin){$zMin = $tzMin}
-                if ($tzMax > $zMax){$zMax = $tzMax}
+        if ($simplify and $tolerance > 0 and $numPoints > 2){
+            my $keep = ones(byte,$numPoints+1,$numTraces);
+            $keep(0:$numPoints-1,:) .= SimplifyMask($xs,$ys,$zs,$tolerance);
+            $rows = $rows->reshape(4,($numPoints+1)*$numTraces)->dice_axis(1,which($keep->flat))->copy;
+        }
+
+        my $dataFile = "$dataDir/element$jj.bin";
+        open(my $fh,'>:raw',$dataFile) or die "Can't write plot data to $dataFile ($!).\n";
+        print $fh ${$rows->get_dataref};
+        close $fh;
+
+        push @dataSets, RUtils::Gnuplot::DataSet->new(
+            datafile    => $dataFile,
+            binary      => "format='%4double'",
+            using       => "1:2:3:4",
+            linetype    => "$linetype",
+            pointtype   => "$pointtype",
+            style       => "linespoints",
+            color       => "variable",
+        );
+
+        # Gather plot bounds data:
+        foreach my $bound ([$xs,\$xMin,\$xMax],[$ys,\$yMin,\$yMax],[$zs,\$zMin,\$zMax]){
+            my ($vals,$minRef,$maxRef) = @$bound;
+            $vals = $vals->where($vals->isfinite);
+            if (!$vals->isempty){
+                my $tMin = $vals->min;
+                my $tMax = $vals->max;
+                if ($tMin < $$minRef){$$minRef = $tMin}
+                if ($tMax > $$maxRef){$$maxRef = $tMax}
             }
         }
     }
@@ -352,9 +410,9 @@ sub RCommonPlot3D {
 sub RCommonSave3D {
     my($filename,$outFileTag,$titleStr,$paramsStr,
     $Ts,$Xs,$Ys,$Zs,$XLineTips,$YLineTips,$ZLineTips,$XLeaderTips,$YLeaderTips,$ZLeaderTips,$numRodNodes,$plotBottom,$errMsg,
-        $finalT,$finalState,$segLens) = @_;
+        $finalT,$finalState,$segLens,$energies,$energyColumnNames) = @_;
     
-    ## Save plot data to a file for future manipulation and plotting. plotTs is a pdl vector and plotXs, plotYs are pdl matrices.  Write the rows as tab separated lines.
+    ## Save plot data to a file for future manipulation and plotting. plotTs is a pdl vector and plotXs, plotYs are pdl matrices.  Write the rows as tab separated lines.  If the optional energies matrix is passed, its rows are time followed by the named energy and work values.
     
     
     my ($numNodes,$numTraces) = $Xs->dims;
@@ -396,6 +454,11 @@ sub RCommonSave3D {
     $outStr .= SetDataStringFromMat($finalState,"State")."\n";
     $outStr .= SetDataStringFromMat($segLens,"SegLengths")."\n";
     
+    if (defined($energies) and !$energies->isempty){
+        $outStr .= "EnergyColumns:\tT\t".join("\t",@$energyColumnNames)."\n\n";
+        $outStr .= SetDataStringFromMat($energies,"Energies")."\n";
+    }
+    
     #pq $outStr;
     
     open OUTFILE,"> $filename".'.txt' or die $!;   # WRITE FROM SCRATCH!
@@ -405,6 +468,705 @@ sub RCommonSave3D {
     
 }
 
+
+## Binary run data.  The same content as the .txt file RCommonSave3D() writes, but with the matrices stored as contiguous little-endian doubles after a text header, so that RHexReplot3D and analysis scripts can memory map even a very large run instead of parsing it.  The .txt file remains the format for export to other programs.
+
+# The file starts with a fixed length line "RHexBinary<tab>version<tab>headerBytes".  Then come tab separated key-value lines, the params string (preceded by its length in bytes), one "Array<tab>name<tab>dims" line per matrix in the order their data follows, "EndHeader", and space padding to a multiple of 8 bytes.  Arrays with no elements appear in the list but take no space.
+
+use PDL::IO::FlexRaw;
+use PDL::IO::Storable;
+use Storable qw(nstore retrieve);
+use Digest::SHA qw(sha1_hex);
+use File::Spec;
+
+use constant BINARY_FORMAT_VERSION => 1;
+my $binaryFirstLineLen = 40;
+
+sub RCommonSaveBinary3D {
+    my($filename,$outFileTag,$titleStr,$paramsStr,
+    $Ts,$Xs,$Ys,$Zs,$XLineTips,$YLineTips,$ZLineTips,$XLeaderTips,$YLeaderTips,$ZLeaderTips,$numRodNodes,$plotBottom,$errMsg,
+        $finalT,$finalState,$segLens,$energies,$energyColumnNames,$extraArrays) = @_;
+
+    ## Arguments as for RCommonSave3D().  Writes $filename.rhb.  The optional $extraArrays is a list of [name,pdl] pairs to store after the standard ones.
+
+    if ($errMsg){
+        $paramsStr .= "\n$errMsg";
+    }
+
+    my @arrays = (
+        [PlotTs=>$Ts->flat],[PlotXs=>$Xs],[PlotYs=>$Ys],[PlotZs=>$Zs],
+        [PlotXLineTips=>$XLineTips],[PlotYLineTips=>$YLineTips],[PlotZLineTips=>$ZLineTips],
+        [PlotXLeaderTips=>$XLeaderTips],[PlotYLeaderTips=>$YLeaderTips],[PlotZLeaderTips=>$ZLeaderTips],
+        [Time=>$finalT->flat],[State=>$finalState->flat],[SegLengths=>$segLens->flat]);
+
+    my $header = "Tag\t$outFileTag\nEndian\tlittle\nNumRodNodes\t$numRodNodes\nPlotBottom\t$plotBottom\nRunIdentifier\t$titleStr\n";
+    if (defined($energies) and !$energies->isempty){
+        push @arrays,[Energies=>$energies];
+        $header .= "EnergyColumns\tT\t".join("\t",@$energyColumnNames)."\n";
+    }
+    if (defined($extraArrays)){push @arrays,@$extraArrays}
+    $header .= "ParamsString\t".do {use bytes; length($paramsStr)}."\n".$paramsStr."\n";
+    foreach my $array (@arrays){
+        $header .= "Array\t$array->[0]\t".join(",",$array->[1]->dims)."\n";
+    }
+    $header .= "EndHeader\n";
+
+    my $headerBytes = $binaryFirstLineLen + do {use bytes; length($header)};
+    my $numPad      = (8 - $headerBytes % 8) % 8;
+    $header         .= ' ' x $numPad;
+    $headerBytes    += $numPad;
+
+    my $firstLine = sprintf("RHexBinary\t%d\t%d",BINARY_FORMAT_VERSION,$headerBytes);
+    $firstLine .= ' ' x ($binaryFirstLineLen-1-length($firstLine))."\n";
+
+    my $bigEndian = (pack("L",1) ne pack("V",1));
+
+    open my $fh,'>',"$filename.rhb" or die $!;   # WRITE FROM SCRATCH!
+    binmode $fh;
+    print $fh $firstLine,$header;
+    foreach my $array (@arrays){
+        my $data = $array->[1]->double->copy;
+        if ($data->isempty){next}
+        if ($bigEndian){$data->bswap8}
+        print $fh ${$data->get_dataref};
+    }
+    close $fh;
+}
+
+
+sub RCommonLoadBinary3D {
+    my ($filename) = @_;
+
+    ## Returns a hash ref holding the header values and the arrays by name, or undef after a warning.  The arrays are read-only memory maps of the file where the system allows, and plain reads otherwise.
+
+    my $fh;
+    if (!open($fh,'<',$filename)){warn "Error: Could not open $filename ($!).\n"; return undef}
+    binmode $fh;
+    my ($firstLine,$header);
+    read($fh,$firstLine,$binaryFirstLineLen);
+    if (!defined($firstLine) or $firstLine !~ /^RHexBinary\t(\d+)\t(\d+)/){
+        close $fh;
+        warn "Error: $filename is not an RHex binary data file.\n";
+        return undef;
+    }
+    my ($version,$headerBytes) = ($1,$2);
+    if ($version > BINARY_FORMAT_VERSION){
+        close $fh;
+        warn "Error: $filename was written by a newer version of RHex (binary format $version).\n";
+        return undef;
+    }
+    read($fh,$header,$headerBytes-$binaryFirstLineLen);
+    close $fh;
+
+    my %run;
+    my @arrays;
+    while ($header =~ /\G(\w+)\t?([^\n]*)\n/gc){
+        my ($key,$val) = ($1,$2);
+        if ($key eq 'EndHeader'){last}
+        elsif ($key eq 'ParamsString'){
+            my $start = pos($header);
+            $run{ParamsString} = do {use bytes; substr($header,$start,$val)};
+            pos($header) = $start+$val+1;
+        }
+        elsif ($key eq 'Array'){
+            my ($name,$dimsStr) = split(/\t/,$val);
+            push @arrays,[$name,[split(/,/,$dimsStr)]];
+        }
+        elsif ($key eq 'EnergyColumns'){$run{EnergyColumns} = [split(/\t/,$val)]}
+        else {$run{$key} = $val}
+    }
+
+    # Describe the whole file to FlexRaw, the header as bytes to be skipped:
+    my @flexHdr = ({Type=>'byte',NDims=>1,Dims=>[$headerBytes]});
+    my @stored = grep {my $n = 1; $n *= $_ foreach @{$_->[1]}; $n > 0} @arrays;
+    foreach my $array (@stored){
+        push @flexHdr,{Type=>'double',NDims=>scalar(@{$array->[1]}),Dims=>$array->[1]};
+    }
+
+    my $bigEndian = (pack("L",1) ne pack("V",1));
+    my @pdls;
+    if (!$bigEndian){@pdls = eval {mapflex($filename,\@flexHdr,{ReadOnly=>1})}}
+    if (!@pdls){
+        @pdls = readflex($filename,\@flexHdr);
+        if ($bigEndian){$_->bswap8 foreach @pdls[1..$#pdls]}
+    }
+    if (@pdls != @stored+1){warn "Error: $filename is truncated or corrupted.\n"; return undef}
+    shift @pdls;
+
+    foreach my $array (@arrays){$run{$array->[0]} = zeros(@{$array->[1]})}
+    for (my $ii=0;$ii<@stored;$ii++){$run{$stored[$ii][0]} = $pdls[$ii]}
+
+    return \%run;
+}
+
+
+## Lazy text loading.  The node coords are almost all of a saved .txt file, so a lazy load reads everything else, but for the rows of the PlotXs, PlotYs, PlotZs and Energies matrices keeps only their byte offsets in the file.  RCommonLoadTraces3D() then reads and parses just the rows of the traces asked for.  The offsets and the rest of the file are kept in a sidecar in RCommon::DataIndexCacheDir(), the same per-user directory that DataStringIndexNew() uses, reused while the file's modification time and size are unchanged, so reopening a large run doesn't read it at all.
+
+my %lazyTextLabels = map {$_=>1} qw(PlotXs PlotYs PlotZs Energies);
+my $textIndexVersion = 1;
+    # Bump when the index layout changes.
+
+sub RCommonIndexText3D {
+    my ($filename) = @_;
+
+    ## Returns {text=>everything but the lazy rows, rows=>{label=>row start offsets, then the end offset}, numCols=>{label=>count}}, or undef after a warning.
+
+    my @stat = stat($filename);
+    if (!@stat){warn "Could not find $filename\n"; return undef}
+
+    my ($sidecar,$stamp);
+    my $cacheDir = RCommon::DataIndexCacheDir();
+        # '' unless it is this user's alone, since a Storable file is only as trustworthy as whoever wrote it.
+    if ($cacheDir){
+        $stamp      = join("\t","text3d",$textIndexVersion,$stat[9],$stat[7]);
+        $sidecar    = File::Spec->catfile($cacheDir,sha1_hex("text3d\t".File::Spec->rel2abs($filename)).".rhi");
+        if (RCommon::DataIndexSidecarOk($sidecar)){
+            my $stored = eval {retrieve($sidecar)};
+            if (defined($stored) and $stored->{stamp} eq $stamp){
+                if ($verbose>=3){print "Using the trace index in $sidecar.\n"}
+                return $stored;
+            }
+        }
+    }
+
+    my $fh;
+    if (!open($fh,'<',$filename)){warn "Error: Could not open $filename ($!).\n"; return undef}
+    binmode $fh;
+
+    # One pass, a line at a time.  A lazy block runs from its label line to the next blank line:
+    my ($text,$pos,$label,$offsets) = ('',0,undef,undef);
+    my (%rows,%numCols);
+    while (my $line = <$fh>){
+        if (defined($label)){
+            if ($line =~ /^\s*$/){
+                push @$offsets,$pos;
+                $rows{$label} = longlong($offsets);
+                $label = undef;
+                $text .= $line;
+            } else {
+                if (!@$offsets){$numCols{$label} = scalar(my @vals = split(' ',$line))}
+                push @$offsets,$pos;
+            }
+        } elsif ($line =~ /^(\w+):\s*$/ and $lazyTextLabels{$1} and !exists($rows{$1})){
+            ($label,$offsets) = ($1,[]);
+        } else {
+            $text .= $line;
+        }
+        $pos += length($line);
+    }
+    if (defined($label)){push @$offsets,$pos; $rows{$label} = longlong($offsets)}
+    close $fh;
+
+    my $textIndex = {stamp=>$stamp,text=>$text,rows=>\%rows,numCols=>\%numCols};
+
+    if (defined($sidecar)){
+        # Write and rename, so a reader never sees a partial file.  Failure just means no sidecar:
+        my $tmpFile = "$sidecar.$$";
+        eval {
+            nstore($textIndex,$tmpFile);
+            rename($tmpFile,$sidecar) or die;
+            1;
+        } or unlink($tmpFile);
+    }
+
+    return $textIndex;
+}
+
+sub ReadTextRows {
+    my ($lazy,$label,$i0,$i1,$iDelta) = @_;
+
+    ## Rows $i0 to $i1 by $iDelta of a lazy matrix, or undef after a warning.
+
+    my $offsets = $lazy->{rows}{$label};
+    my ($start,$end) = ($offsets($i0)->sclr,$offsets($i1+1)->sclr);
+
+    my ($fh,$chunk);
+    if (!open($fh,'<',$lazy->{filename})){warn "Error: Could not open $lazy->{filename} ($!).\n"; return undef}
+    binmode $fh;
+    seek($fh,$start,0);
+    my $numRead = read($fh,$chunk,$end-$start);
+    close $fh;
+
+    my @lines = split(/\n/,$chunk);
+    my @vals;
+    for (my $ii=0;$ii<@lines;$ii+=$iDelta){push @vals,split(' ',$lines[$ii])}
+
+    my $numCols = $lazy->{numCols}{$label};
+    my $numRows = POSIX::floor(($i1-$i0)/$iDelta)+1;
+    if (!defined($numRead) or $numRead != $end-$start or @vals != $numCols*$numRows){
+        warn "Error: $lazy->{filename} has changed since it was loaded, or is corrupted.  Load it again.\n";
+        return undef;
+    }
+    return pdl(\@vals)->reshape($numCols,$numRows);
+}
+
+sub RCommonLoadTraces3D {
+    my ($run,$it0,$it1,$iDelta,$nodes) = @_;
+
+    ## Returns the node coords ($Xs,$Ys,$Zs) of traces $it0 to $it1 by $iDelta from a run RCommonLoad3D() gave, just of the $nodes (an index pdl) if given.  From a lazily loaded text file only those traces are read.  Returns an empty list after a warning.
+
+    if (!defined($iDelta)){$iDelta = 1}
+
+    my @mats;
+    foreach my $key (qw(PlotXs PlotYs PlotZs)){
+        my $mat = (defined($run->{$key})) ? $run->{$key}(:,$it0:$it1:$iDelta) :
+                                            ReadTextRows($run->{Lazy},$key,$it0,$it1,$iDelta);
+        if (!defined($mat)){return ()}
+        if (defined($nodes)){$mat = $mat->dice_axis(0,$nodes)}
+        push @mats,$mat;
+    }
+    return @mats;
+}
+
+
+sub RCommonLoad3D {
+    my ($filename,$lazy) = @_;
+
+    ## Loads a saved run, text (.txt) or binary (.rhb), from either RHexSwing3D or RHexCast3D.  Returns a hash ref with the same keys RCommonLoadBinary3D() gives, checked for consistency, or undef after a warning.  The final Time, State and SegLengths come along, but are not checked, since they are not needed for plotting.  If $lazy, a text file's PlotXs, PlotYs and PlotZs are left undef, and read as needed by RCommonLoadTraces3D().  Binary files are always memory maps, and so lazy anyway.
+
+    if (!-e $filename){warn "Could not find $filename\n"; return undef}
+
+    my %run;
+    my $eh = "Error:  Could not load plot data from $filename - ";
+    my $et = "data not found or corrupted.\n";
+    my @matKeys = qw(PlotTs PlotXs PlotYs PlotZs PlotXLineTips PlotYLineTips PlotZLineTips PlotXLeaderTips PlotYLeaderTips PlotZLeaderTips);
+
+    if ($filename =~ /\.rhb$/){
+        my $run = RCommonLoadBinary3D($filename);
+        if (!defined($run)){return undef}
+        %run = %$run;
+    } else {
+        my $inData;
+        if ($lazy){
+            my $textIndex = RCommonIndexText3D($filename);
+            if (!defined($textIndex)){return undef}
+            $inData     = $textIndex->{text};
+            $run{Lazy}  = {filename=>$filename,rows=>$textIndex->{rows},numCols=>$textIndex->{numCols}};
+        } else {
+            my $fh;
+            if (!open($fh,'<',$filename)){warn "Error: Could not open $filename ($!).\n"; return undef}
+            $inData = do {local $/; <$fh>};
+            close $fh;
+        }
+
+        if ($inData =~ /^(\Q$rSwingOutFileTag\E|\Q$rCastOutFileTag\E)/){$run{Tag} = $1}
+
+        # What's left of a lazy file is small, and its sidecar already spares the reading:
+        my $inIndex = DataStringIndexNew($inData,($lazy) ? undef : $filename);
+        $run{ParamsString}  = GetQuotedStringFromDataString($inIndex,"ParamsString");
+        $run{NumRodNodes}   = GetValueFromDataString($inIndex,"NumRodNodes");
+        $run{PlotBottom}    = GetValueFromDataString($inIndex,"PlotBottom");
+        $run{RunIdentifier} = GetWordFromDataString($inIndex,"RunIdentifier");
+        foreach my $key (@matKeys){
+            if (!$lazy or !$lazyTextLabels{$key}){$run{$key} = GetMatFromDataString($inIndex,$key)}
+        }
+        foreach my $key (qw(Time State SegLengths)){$run{$key} = GetMatFromDataString($inIndex,$key)}
+    }
+
+    if (!defined($run{Tag})){warn "Error: $filename is not a recognized output file.\n"; return undef}
+
+    foreach my $key (qw(ParamsString NumRodNodes PlotBottom RunIdentifier),@matKeys){
+        if (defined($run{Lazy}) and $lazyTextLabels{$key}){
+            if (!defined($run{Lazy}{rows}{$key})){warn "$eh $key $et"; return undef}
+            next;
+        }
+        my $val = $run{$key};
+        if (!defined($val) or ((ref($val) eq 'PDL') ? $val->isempty : $val eq '')){warn "$eh $key $et"; return undef}
+    }
+
+    # A single time or a single node loads as a 1D pdl:
+    my $nTimes = $run{PlotTs}->nelem;
+    if (!$nTimes or $run{PlotTs}->ndims > 1){warn "$eh PlotTs $et"; return undef}
+
+    my $nNodes;
+    if (defined($run{Lazy})){
+        $nNodes = $run{Lazy}{numCols}{PlotXs};
+        foreach my $key (qw(PlotXs PlotYs PlotZs)){
+            if (!$nNodes or !defined($run{Lazy}{numCols}{$key}) or $run{Lazy}{numCols}{$key} != $nNodes or $run{Lazy}{rows}{$key}->nelem-1 != $nTimes){warn "$eh $key $et"; return undef}
+        }
+    } else {
+        $nNodes = $run{PlotXs}->dim(0);
+        foreach my $key (qw(PlotXs PlotYs PlotZs)){
+            if (!$nNodes or $run{$key}->dim(0) != $nNodes or $run{$key}->nelem != $nNodes*$nTimes){warn "$eh $key $et"; return undef}
+            $run{$key} = $run{$key}->reshape($nNodes,$nTimes);
+        }
+    }
+    $run{NumNodes} = $nNodes;
+    if ($run{NumRodNodes} > $nNodes){warn "$eh detected bad inNumRodNodes.\n"; return undef}
+    foreach my $key (qw(PlotXLineTips PlotYLineTips PlotZLineTips PlotXLeaderTips PlotYLeaderTips PlotZLeaderTips)){
+        if ($run{$key}->nelem != $nTimes){warn "$eh $key $et"; return undef}
+        $run{$key} = $run{$key}->reshape(1,$nTimes);
+    }
+
+    return \%run;
+}
+
+
+sub TurnoverTime {
+    my ($ts,$lineTipXs,$flyXs) = @_;
+
+    ## The first time the fly is ahead of the line tip in x after having been behind it, or 'NaN' if it never is.
+    my $ahead	= $flyXs > $lineTipXs;
+    my $iBehind	= which(!$ahead);
+    if ($iBehind->isempty){return 'NaN'}
+    my $iTurned	= which($ahead & (sequence($ahead->nelem) > $iBehind(0)));
+    return ($iTurned->isempty) ? 'NaN' : $ts($iTurned(0))->sclr;
+}
+
+
+## Streamed results.  While a run is in progress, each stored row (time, dynams, node coords, tip coords, energies) is appended to a tab separated text file, so that a crash loses at most the last few rows, and the file can be looked at while the run continues.  The final line of a complete or interrupted stream holds a time and full dynams from which the run can be restarted.  See ResultStreamRead().  The header names the run key (see RunCacheKey()), so that a stream is only ever resumed by a run with the same settings, spec files and code.
+
+# Lines are collected in memory and written when there are maxBufferRows of them or when syncSecs have passed since the last write, which is then fsync'd.  The most recently appended row is always held back, since DoRun() may retract it if it was a non-uniform event stop.
+
+use IO::Handle;
+use Time::HiRes qw (time);
+
+sub ResultStreamOpen {
+    my ($filename,$outFileTag,$titleStr,$columnNames,$syncSecs,$opts) = @_;
+
+	## Returns a stream hash, or undef if the file can't be opened.  The options are maxBufferRows, runKey, and resumeBytes.  If resumeBytes is defined, the existing file is cut back to that length, which should come from ResultStreamRead(), and appended to, rather than begun again.
+
+	my $maxBufferRows	= $opts->{maxBufferRows};
+	my $runKey			= (defined($opts->{runKey})) ? $opts->{runKey} : '';
+	my $resumeBytes		= $opts->{resumeBytes};
+
+	my $fh;
+	if (defined($resumeBytes)){
+		if (!open($fh,'+<',$filename) or !truncate($fh,$resumeBytes) or !seek($fh,0,2)){print "WARNING: Cannot reopen stream file $filename ($!).  Not streaming.\n"; return undef}
+	} else {
+		if (!open($fh,'>',$filename)){print "WARNING: Cannot open stream file $filename ($!).  Not streaming.\n"; return undef}
+
+		print $fh "$outFileTag\tstream\n";
+		print $fh "RunIdentifier:\t$titleStr\n";
+		print $fh "RunKey:\t$runKey\n";
+		print $fh "Columns:\t".join("\t",@$columnNames)."\n";
+	}
+	$fh->flush;
+
+	return {fh=>$fh,filename=>$filename,numColumns=>scalar(@$columnNames),
+		syncSecs=>(defined($syncSecs))?$syncSecs:5,maxBufferRows=>($maxBufferRows)?$maxBufferRows:100,
+		lines=>[],held=>undef,lastSync=>time(),numWritten=>0};
+}
+
+sub ResultStreamRead {
+    my ($filename,$outFileTag,$runKey,$columnNames,$maxRows) = @_;
+
+	## Reads back a stream file, if its header matches the tag, run key and column names given.  Returns undef if it doesn't, or the file can't be read.  Otherwise a hash of rows, a 2D pdl like those passed to ResultStreamAppend() (only the last $maxRows of them if $maxRows is positive), numRows, the number of complete rows in the file, firstT, the time of the first of them, columns, the column indices by name, goodBytes, the length of the header and the complete rows, and lastRowBytes, the length up to the start of the last complete row.  Reading stops at the first incomplete line, which is where a crash can leave one.
+
+	my $fh;
+	if (!open($fh,'<',$filename)){return undef}
+
+	my @header		= map {scalar(<$fh>)} (0..3);
+	my $numColumns	= scalar(@$columnNames);
+	if (grep({!defined($_)} @header) or $header[0] ne "$outFileTag\tstream\n" or $header[2] ne "RunKey:\t$runKey\n"
+			or $header[3] ne "Columns:\t".join("\t",@$columnNames)."\n"){
+		close $fh;
+		return undef;
+	}
+
+	my $goodBytes		= tell($fh);
+	my $lastRowBytes	= $goodBytes;
+	my $store			= ($maxRows) ? undef : RowStoreNew($numColumns,1024);
+	my @tail;
+	my ($numRows,$firstT) = (0,undef);
+	while (my $line = <$fh>){
+		if ($line !~ /\n$/){last}
+		chomp $line;
+		my @vals = split(/\t/,$line);
+		if (@vals != $numColumns){last}
+
+		if (!$numRows){$firstT = $vals[0]}
+		if ($maxRows){
+			push @tail,\@vals;
+			if (@tail > $maxRows){shift @tail}
+		} else {
+			RowStoreAppend($store,pdl(\@vals));
+		}
+		$numRows++;
+		$lastRowBytes	= $goodBytes;
+		$goodBytes		= tell($fh);
+	}
+	close $fh;
+
+	my $rows = ($maxRows) ? ((@tail) ? pdl(\@tail) : zeros($numColumns,0)) : RowStoreData($store)->copy;
+
+	return {rows=>$rows,numRows=>$numRows,firstT=>$firstT,goodBytes=>$goodBytes,lastRowBytes=>$lastRowBytes,
+		columns=>{map {($columnNames->[$_],$_)} (0..$numColumns-1)}};
+}
+
+sub ResultStreamAppend {
+    my ($stream,$rows) = @_;
+
+	## $rows is a 2D pdl, one column of values per row of the stream.
+
+	if (!defined($stream)){return}
+	my ($numColumns,$numRows) = $rows->dims;
+	if ($rows->isempty){return}
+	if ($numColumns != $stream->{numColumns}){croak "ERROR: ResultStreamAppend: Got $numColumns values per row, header has $stream->{numColumns}.\nStopped"}
+
+	for (my $ii=0;$ii<$numRows;$ii++){
+		if (defined($stream->{held})){push @{$stream->{lines}},$stream->{held}}
+		$stream->{held} = join("\t",map {sprintf("%.17g",$_)} $rows(:,$ii)->list)."\n";
+			# Enough digits to give back exactly the same doubles, so a resumed run starts from the very state that was streamed.
+	}
+
+	if (@{$stream->{lines}} >= $stream->{maxBufferRows} or time()-$stream->{lastSync} >= $stream->{syncSecs}){
+		ResultStreamFlush($stream);
+	}
+}
+
+sub ResultStreamDropLast {
+    my ($stream) = @_;
+
+	if (defined($stream)){$stream->{held} = undef}
+}
+
+sub ResultStreamFlush {
+    my ($stream,$includeHeld) = @_;
+
+	## Writes and fsyncs the buffered lines.  If $includeHeld, the held row too, which may then no longer be retracted.
+
+	if (!defined($stream)){return}
+	my $fh = $stream->{fh};
+	if ($includeHeld and defined($stream->{held})){
+		push @{$stream->{lines}},$stream->{held};
+		$stream->{held} = undef;
+	}
+	if (@{$stream->{lines}}){
+		print $fh @{$stream->{lines}};
+		$stream->{numWritten} += scalar(@{$stream->{lines}});
+		$stream->{lines} = [];
+	}
+	$fh->flush;
+	$fh->sync;
+	$stream->{lastSync} = time();
+}
+
+sub ResultStreamClose {
+    my ($stream) = @_;
+
+	if (!defined($stream)){return}
+	ResultStreamFlush($stream,1);
+	close $stream->{fh};
+	if ($verbose>=2){print "Streamed $stream->{numWritten} rows to $stream->{filename}\n"}
+}
+
+## Live view.  While a run is in progress, a gnuplot process of its own shows the traces as they are stored.  Each trace is appended, as raw (x,y,z,rgb) doubles, to the rod and line data files the live plot reads, and at most framesPerSec times a second the process is told over its command pipe to replot.  After each replot gnuplot prints an acknowledgement to its output pipe, which is polled without blocking.  Until the acknowledgement arrives, gnuplot is taken to be still drawing, and frames are skipped and their traces kept in memory, so neither the commands nor the rereading of the data files can pile up, and the data files are never appended to while gnuplot reads them.  The data files are only ever appended to, and the most recently appended trace is held back, as in the result stream, since DoRun() may retract it.
+
+use Errno qw(EAGAIN EWOULDBLOCK);
+use IPC::Open2;
+
+my $livePlotAck = "RHexLiveFrameDone";
+my @livePlotPids;
+    # Of closed live plots' gnuplots, reaped once they have exited.
+
+sub LivePlotOpen {
+    my ($titleStr,$numRodNodes,$t0,$t1,$framesPerSec) = @_;
+
+	## Returns a live plot hash, or undef if there is no display or gnuplot can't be started.
+
+	if ($headless){return undef}
+	if ($numRodNodes < 1){$numRodNodes = 1}
+
+	LivePlotReap();
+
+	my $exe = ($gnuplot) ? $gnuplot : 'gnuplot';
+	my ($gp,$ack);
+	my $pid = eval {open2($ack,$gp,"\"$exe\"")};
+	if (!$pid){print "WARNING: Cannot start $exe for the live plot ($@).  Not showing it.\n"; return undef}
+	binmode $gp;
+	if (!defined($ack->blocking(0))){
+		print "WARNING: gnuplot's output can't be polled here, so frames can't be paced.  Not showing the live plot.\n";
+		close $gp; close $ack;
+		push @livePlotPids,$pid;
+		return undef;
+	}
+
+	my $dataDir = tempdir(CLEANUP => 1);
+	my %live = (gp=>$gp,ack=>$ack,pid=>$pid,ackText=>'',busy=>0,numRodNodes=>$numRodNodes,t0=>$t0,tSpan=>($t1>$t0)?$t1-$t0:1,
+		frameSecs=>($framesPerSec>0)?1/$framesPerSec:0,lastFrame=>0,
+		rodFile=>"$dataDir/rod.bin",lineFile=>"$dataDir/line.bin",
+		rodBytes=>'',lineBytes=>'',held=>undef,haveLine=>0,tLast=>undef,plotted=>0,numSkipped=>0);
+
+	my $terminal = ($main::OS eq "MSWin32") ? "windows size 700,700 position 40,40" : "x11 size 700,700 position 40,40";
+	$titleStr =~ s/["\t\n]/ /g;
+	$live{title} = "LIVE - $titleStr";
+
+	LivePlotCommand(\%live,
+		"set terminal $terminal\n".
+		"set xlabel 'X (ft)'; set ylabel 'Y (ft)'; set zlabel 'Z (ft)'\n".
+		"set view equal xyz\n".
+		"set key off\n".
+		"set print '-'\n");
+			# So the acknowledgements come back on gnuplot's output pipe.
+
+	return \%live;
+}
+
+sub LivePlotAppend {
+    my ($live,$t,$Xs,$Ys,$Zs) = @_;
+
+	## One trace, coords in cm, with the nodes in plotting order.
+
+	if (!defined($live)){return}
+
+	if (defined($live->{held})){LivePlotTake($live,@{$live->{held}})}
+	$live->{held} = [$t,map {$_->flat->copy} ($Xs,$Ys,$Zs)];
+
+	if (time()-$live->{lastFrame} >= $live->{frameSecs}){LivePlotFrame($live)}
+}
+
+sub LivePlotDropLast {
+    my ($live) = @_;
+
+	if (defined($live)){$live->{held} = undef}
+}
+
+sub LivePlotTake {
+    my ($live,$t,$Xs,$Ys,$Zs) = @_;
+
+	## Packs a trace for the data files, each polyline followed by a row of nans so gnuplot doesn't join it to the next.
+
+	my $fract = ($t-$live->{t0})/$live->{tSpan};
+	if ($fract<0){$fract=0}elsif($fract>1){$fract=1}
+	my $rgb = POSIX::floor(255*$fract)*65536 + POSIX::floor(255*(1-$fract))*256;
+
+	my $numNodes	= $Xs->nelem;
+	my $iRodTip		= ($live->{numRodNodes}<$numNodes) ? $live->{numRodNodes}-1 : $numNodes-1;
+
+	my $pack = sub {
+		my ($i0,$i1) = @_;
+		my $rows = cat($Xs($i0:$i1)/$feetToCms,$Ys($i0:$i1)/$feetToCms,$Zs($i0:$i1)/$feetToCms,$rgb*ones($i1-$i0+1))->transpose;
+		return ${$rows->double->copy->get_dataref}.pack('d4',$nan,$nan,$nan,$rgb);
+	};
+
+	$live->{rodBytes} .= &$pack(0,$iRodTip);
+	if ($iRodTip < $numNodes-1){
+		$live->{lineBytes} .= &$pack($iRodTip,$numNodes-1);   # Sic, line starts at rod tip.
+		$live->{haveLine} = 1;
+	}
+	$live->{tLast} = $t;
+}
+
+sub LivePlotFrame {
+    my ($live) = @_;
+
+	## Writes the packed traces to the data files and asks gnuplot to redraw, unless it hasn't finished the last frame, in which case the traces wait for the next try.
+
+	$live->{lastFrame} = time();
+	if (!defined($live->{gp}) or !length($live->{rodBytes})){return}
+	if (!LivePlotIdle($live)){$live->{numSkipped}++; return}
+
+	foreach my $part (qw(rod line)){
+		if (!length($live->{$part.'Bytes'})){next}
+		my $fh;
+		if (!open($fh,'>>:raw',$live->{$part.'File'})){print "WARNING: Cannot write the live plot data ($!).\n"; return}
+		print $fh $live->{$part.'Bytes'};
+		close $fh;
+		$live->{$part.'Bytes'} = '';
+	}
+
+	my $cmd = sprintf("set title \"%s -- t=%.3f\"\n",$live->{title},$live->{tLast});
+	if (!$live->{plotted}){
+		my $spec = "binary format='%4double' using 1:2:3:4 with lines linecolor rgb variable";
+		$cmd .= "splot '$live->{rodFile}' $spec";
+		if ($live->{haveLine}){$cmd .= ", '$live->{lineFile}' $spec dashtype 2"}
+		$cmd .= "\n";
+	} else {
+		$cmd .= "replot\n";
+	}
+	$cmd .= "print '$livePlotAck'\n";
+
+	if (LivePlotCommand($live,$cmd)){
+		$live->{plotted}	= 1;
+		$live->{busy}		= 1;
+	}
+}
+
+sub LivePlotIdle {
+    my ($live) = @_;
+
+	## True once gnuplot has acknowledged the last frame sent.  Reads whatever it has printed since the last look, without waiting.
+
+	if (!defined($live->{gp})){return 0}
+	if (!$live->{busy}){return 1}
+
+	my $buf;
+	while (1){
+		my $numRead = sysread($live->{ack},$buf,4096);
+		if (!defined($numRead)){
+			if ($! == EAGAIN or $! == EWOULDBLOCK){last}
+			LivePlotStopped($live,$!);
+			return 0;
+		}
+		if (!$numRead){LivePlotStopped($live,"gnuplot exited"); return 0}
+		$live->{ackText} .= $buf;
+	}
+
+	if (CORE::index($live->{ackText},$livePlotAck) >= 0){
+		$live->{busy}		= 0;
+		$live->{ackText}	= '';
+	} else {
+		$live->{ackText} = substr($live->{ackText},-length($livePlotAck));
+			# Only enough to catch an acknowledgement split between reads.
+	}
+	return !$live->{busy};
+}
+
+sub LivePlotCommand {
+    my ($live,$cmd) = @_;
+
+	## Returns true if gnuplot took the whole command.  It is only ever sent commands when idle, so its input pipe never fills.
+
+	if (!defined($live->{gp})){return 0}
+
+	local $SIG{PIPE} = 'IGNORE';
+	my $numWritten = syswrite($live->{gp},$cmd);
+	if (defined($numWritten) and $numWritten == length($cmd)){return 1}
+
+	# Most likely gnuplot was quit.  Stop feeding it:
+	LivePlotStopped($live,$!);
+	return 0;
+}
+
+sub LivePlotStopped {
+    my ($live,$reason) = @_;
+
+	if ($verbose>=1){print "WARNING: The live plot stopped ($reason).\n"}
+	LivePlotRelease($live);
+}
+
+sub LivePlotRelease {
+    my ($live) = @_;
+
+	## Closes both pipes without waiting.  gnuplot exits on the end of its input, or on writing its next acknowledgement to the closed output, and is reaped later.
+
+	if (!defined($live->{gp})){return}
+	close $live->{gp};
+	close $live->{ack};
+	push @livePlotPids,$live->{pid};
+	$live->{gp} = undef;
+	LivePlotReap();
+}
+
+sub LivePlotReap {
+
+	## Collects any live plot gnuplots that have exited, without waiting for the rest.
+
+	@livePlotPids = grep {waitpid($_,POSIX::WNOHANG()) == 0} @livePlotPids;
+}
+
+sub LivePlotClose {
+    my ($live) = @_;
+
+	## Ends the gnuplot process, which takes its window with it, without waiting for it to finish any frame it is drawing.  The full plot follows from DoRun().
+
+	if (!defined($live)){return}
+	LivePlotRelease($live);
+	if ($verbose>=3){print "Live plot skipped $live->{numSkipped} frames while gnuplot was busy.\n"}
+}
+
+
 # Required package return value:
 1;
 
@@ -427,7 +1189,7 @@ Can plot using a system gnuplot if it is available, or the local version bundled
 
 =head1 EXPORT
 
-$gnuplot RCommonPlot3D RCommonSave3D
+$gnuplot $headless RCommonPlot3D RCommonSave3D RCommonSaveBinary3D RCommonLoadBinary3D RCommonLoad3D RCommonLoadTraces3D TurnoverTime ResultStreamOpen ResultStreamRead ResultStreamAppend ResultStreamDropLast ResultStreamFlush ResultStreamClose LivePlotOpen LivePlotAppend LivePlotDropLast LivePlotClose
 
 =head1 GNUPLOT VERSION
 
@@ -0,0 +1,237 @@
+# RCommonSweep.pm
+
+#################################################################################
+##
+## RHex - 3D dyanmic simulation of fly casting and swinging.
+## Copyright (C) 2019 Rich Miller <rich@ski.org>
+##
+## This file is part of RHex.
+##
+## RHex is free software: you can redistribute it and/or modify it under the
+## terms of the GNU General Public License as published by the Free Software
+## Foundation, either version 3 of the License, or (at your option) any later
+## version.
+##
+## RHex is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+## without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+## PURPOSE.  See the GNU General Public License for more details.
+##
+## You should have received a copy of the GNU General Public License along with RHex.
+## If not, see <https://www.gnu.org/licenses/>.
+##
+## RHex makes system calls to the Gnuplot executable, Copyright 1986 - 1993, 1998,
+## 2004 Thomas Williams, Colin Kelley.  It makes static links to the Gnu Scientific
+## Library, which is copyrighted and available under the GNU General Public License.
+## In addition, RHex incorporates code from the Perl core and numerous Perl libraries,
+## all of which are free software, redistributable and/or modifable under the same
+## terms as Perl itself (Perl License).  Finally, the modules Brent, DiffEq, and
+## Numjac in the directory RUtils are modifications and translations into Perl of
+## copyrighted material.  You can find the details in the individual files.
+##
+##################################################################################
+
+package RCommonSweep;
+
+## Shared by the sweep coordinator RHexSweep3D and the remote worker RHexWorker3D.  A work item is a run's settings file bundled with the spec files it names; the result is its binary data, stats and log files bundled the same way.  Both travel over a TCP connection as messages, each a header line "WORD arg ... numBytes" followed by exactly numBytes of payload, so binary data goes through untouched.
+#
+# Messages, worker to coordinator:
+#   HELLO name 0                            On connecting.
+#   HEARTBEAT index 0                       Every few seconds while running run index.
+#   RESULT index killed signal exitCode n   The run finished.  Payload is the result bundle.
+# Coordinator to worker:
+#   JOB index runType timeout n             Payload is the work bundle.
+#   DONE 0                                  No more work.  The worker exits.
+
+use warnings;
+use strict;
+
+our $VERSION='0.01';
+
+use Exporter 'import';
+our @EXPORT = qw(%batchStatusNames NumCores NetConnNew NetSend NetReceive BundlePack BundleUnpack BundleFromFiles BundleToDir);
+
+use Carp;
+use File::Basename;
+
+
+our %batchStatusNames = (0=>'ok',1=>'badSettings',2=>'setupFailed',3=>'solverStopped',4=>'died');
+	# RHexBatch3D exit codes.
+
+
+sub NumCores {
+
+	## Falls back to 1 if the count can't be found.
+	my $num;
+	if ($^O eq "MSWin32"){$num = $ENV{NUMBER_OF_PROCESSORS}}
+	elsif ($^O eq "darwin"){$num = `sysctl -n hw.ncpu 2>/dev/null`}
+	else {$num = `nproc 2>/dev/null`}
+
+	if (defined($num)){chomp($num)}
+	return (defined($num) and $num =~ /^\d+$/ and $num > 0) ? $num : 1;
+}
+
+
+sub NetConnNew {
+	my ($sock) = @_;
+
+	## Wraps a connected socket with the read buffer NetReceive() needs.
+	binmode($sock);
+	$sock->autoflush(1);
+	return {sock=>$sock,buf=>'',lastHeard=>time()};
+}
+
+
+sub NetSend {
+	my ($conn,$word,$args,$payload) = @_;
+
+	## Returns false if the other end has gone away.  Args must not contain white space.
+	if (!defined($payload)){$payload = ''}
+	my $msg = join(' ',$word,@$args,length($payload))."\n".$payload;
+
+	local $SIG{PIPE} = 'IGNORE';
+	my $sent = 0;
+	while ($sent < length($msg)){
+		my $num = syswrite($conn->{sock},$msg,length($msg)-$sent,$sent);
+		if (!$num){return 0}
+		$sent += $num;
+	}
+	return 1;
+}
+
+
+sub NetReceive {
+	my ($conn) = @_;
+
+	## Call when the socket is readable.  Does one read, and returns a ref to the list of messages now complete, each [word,[args],payload], or undef if the other end has closed.
+
+	my $num = sysread($conn->{sock},$conn->{buf},65536,length($conn->{buf}));
+	if (!$num){return undef}
+	$conn->{lastHeard} = time();
+
+	my @msgs;
+	while ((my $eol = index($conn->{buf},"\n")) >= 0){
+		my @fields = split(' ',substr($conn->{buf},0,$eol));
+		if (!@fields or $fields[-1] !~ /^\d+$/){
+			carp "Bad message header \"".substr($conn->{buf},0,$eol)."\"";
+			return undef;
+		}
+		my $numBytes = pop(@fields);
+		if (length($conn->{buf}) < $eol+1+$numBytes){last}
+
+		my $word = shift(@fields);
+		push @msgs,[$word,\@fields,substr($conn->{buf},$eol+1,$numBytes)];
+		substr($conn->{buf},0,$eol+1+$numBytes) = '';
+	}
+	return \@msgs;
+}
+
+
+sub BundlePack {
+	my ($files) = @_;
+
+	## $files is a hash ref of file name => contents.  Names only, no directories.
+	my $bundle = '';
+	foreach my $name (sort keys %$files){
+		$bundle .= "$name\t".length($files->{$name})."\n".$files->{$name};
+	}
+	return $bundle;
+}
+
+
+sub BundleUnpack {
+	my ($bundle) = @_;
+
+	## Inverse of BundlePack().  Dies on a malformed bundle or one naming a file outside its own directory.
+	my %files;
+	my $pos = 0;
+	while ($pos < length($bundle)){
+		my $eol = index($bundle,"\n",$pos);
+		if ($eol < 0){die "ERROR: Truncated bundle.\nStopped"}
+		my ($name,$numBytes) = split(/\t/,substr($bundle,$pos,$eol-$pos));
+		if (!defined($numBytes) or $numBytes !~ /^\d+$/ or $name ne basename($name) or $name =~ /^\.\.?$/){
+			die "ERROR: Bad bundle entry.\nStopped";
+		}
+		$files{$name} = substr($bundle,$eol+1,$numBytes);
+		$pos = $eol+1+$numBytes;
+	}
+	return \%files;
+}
+
+
+sub BundleFromFiles {
+	my (%paths) = @_;
+
+	## Arguments are bundle name => path pairs.  Paths that don't exist are left out.
+	my %files;
+	while (my ($name,$path) = each %paths){
+		if (!-e $path){next}
+		open(my $fh,'<:raw',$path) or die "ERROR: Could not read $path: $!\nStopped";
+		local $/;
+		$files{$name} = <$fh>;
+		close $fh;
+	}
+	return BundlePack(\%files);
+}
+
+
+sub BundleToDir {
+	my ($bundle,$dir,$append) = @_;
+
+	## Writes each file of the bundle into $dir, returning the hash of name => path.  Names matched by the optional regexp $append are appended to rather than replaced.
+	my $files = BundleUnpack($bundle);
+	my %paths;
+	foreach my $name (keys %$files){
+		my $path = "$dir/$name";
+		my $openMode = (defined($append) and $name =~ $append) ? '>>:raw' : '>:raw';
+		open(my $fh,$openMode,$path) or die "ERROR: Could not write $path: $!\nStopped";
+		print $fh $files->{$name};
+		close $fh;
+		$paths{$name} = $path;
+	}
+	return \%paths;
+}
+
+
+# Required package return value:
+1;
+
+__END__
+
+=head1 NAME
+
+RCommonSweep - Core counting, socket messages and file bundles for the parameter sweep coordinator and its remote workers.
+
+=head1 SYNOPSIS
+
+use RCommonSweep;
+
+=head1 EXPORT
+
+%batchStatusNames NumCores NetConnNew NetSend NetReceive BundlePack BundleUnpack BundleFromFiles BundleToDir
+
+=head1 AUTHOR
+
+Rich Miller, E<lt>rich@ski.orgE<gt>
+
+=head1 COPYRIGHT AND LICENSE
+
+RHex - 3D dyanmic simulation of fly casting and swinging.
+
+Copyright (C) 2019 Rich Miller
+
+This file is part of RHex.
+
+RHex is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RHex is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RHex.  If not, see <https://www.gnu.org/licenses/>.
+
+=cut
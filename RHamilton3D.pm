@@ -39,7 +39,7 @@ use strict;
 our $VERSION='0.01';
 
 use Exporter 'import';
-our @EXPORT = qw(DEBUG $verbose $debugVerbose $restoreVerbose $reportVerbose Calc_FreeSinkSpeed Init_Hamilton Get_T0 Get_dT Get_movingAvDt Get_TDynam Get_DynamsCopy Calc_Driver Calc_VerticalProfile Calc_HorizontalProfile Get_Tip0 DEfunc_GSL DEjac_GSL DEset_Dynams0Block DE_GetStatus DE_GetErrMsg DE_GetCounts JACget AdjustHeldSeg_HOLD Get_ExtraOutputs);
+our @EXPORT = qw(DEBUG $verbose $debugVerbose $restoreVerbose $reportVerbose Calc_FreeSinkSpeed Init_Hamilton Get_T0 Get_dT Get_movingAvDt Get_stepHintDt Get_TDynam Get_DynamsCopy Calc_Driver Calc_VerticalProfile Calc_HorizontalProfile Get_Tip0 DEfunc_GSL DEjac_GSL DEset_Dynams0Block DE_GetStatus DE_GetErrMsg DE_GetCounts JACget AdjustHeldSeg_HOLD Get_ExtraOutputs Get_StripRemainingFract Remesh_LINE Calc_StaticEquilibrium DE_SetEnergyAccounting DE_SetDragMultipliers DE_EnergyColumns Get_EnergyColumnNames);
 
 use Carp;
 
@@ -109,12 +109,24 @@ my $dampOnlyOnExpansion;
 my $holding;	# Holding state currently unused.
 my ($stripping,$stripStartTime);
 	# 0 disabled, -1 enabled but not active, 1 active.
+my $continuousStripping;
+	# If true, strip by resampling all the line segments rather than by using up and dropping the first one.
+my $energyAccounting = 0;
+	# If true, DE keeps running totals of the work done by damping, drag, the other applied forces, and the driver.  See DE_SetEnergyAccounting().
+my ($init_segDragMults,$segDragMults);
+	# Undef, or per-segment multipliers applied to the fluid drag.  See DE_SetDragMultipliers().
+my @remeshSegBornTs;
+	# For each line seg, the time Remesh_LINE() last made it, so a new seg is left alone for a while.  Emptied on initialize.
 my ($thisSegStartT,$lineSeg0LenFixed,
     $lineSeg0MassFixed,$lineSeg0VolFixed,
     $lineSeg0KFixed,$lineSeg0CFixed);
 my ($HeldSegLen,$HeldSegK,$HeldSegC);
 #my $init_verbose;
 my ($DE_lastSteppingCall,$DE_lastSteppingT,$DE_maxAttainedT,$DE_movingAvDt);
+my @DE_recentCallDts;
+	# The most recent forward spacings between successive function call times.  See Get_stepHintDt().
+my $DE_numRecentCallDts = 6;
+	# Enough to span all the stages of one step of any of the GSL steppers.
 
 
 my ($tDynam,$dynams);    # My global copy of the args the stepper passes to DE.
@@ -123,6 +135,9 @@ my ($tDynam,$dynams);    # My global copy of the args the stepper passes to DE.
 sub Init_Hamilton {
     $mode = shift;
     
+    my $prevNumLineSegs = $numLineSegs;
+        # For carrying the jacobian increments across a restart.
+    
     if ($mode eq "initialize"){
         
         my ($Arg_nominalG,$Arg_rodLength,$Arg_actionLength,
@@ -143,7 +158,8 @@ sub Init_Hamilton {
             $Arg_profileStr,$Arg_bottomDepth,$Arg_surfaceVel,
             $Arg_halfVelThickness,$Arg_surfaceLayerThickness,
             $Arg_horizHalfWidth,$Arg_horizExponent,
-            $Arg_sinkInterval,$Arg_stripRate) = @_;
+            $Arg_sinkInterval,$Arg_stripRate,
+            $Arg_continuousStripping) = @_;
         
         PrintSeparator ("Initializing stepper code",2);
         
@@ -194,6 +210,7 @@ sub Init_Hamilton {
         $horizExponent              = $Arg_horizExponent;
         $sinkInterval               = $Arg_sinkInterval;
         $stripRate                  = $Arg_stripRate;
+        $continuousStripping        = ($Arg_continuousStripping) ? 1 : 0;
         
         
         ### NOTE: When mode="initialize", and $loadedStateIsEmpty=true, the second half of $Dynams0 must contain initial velocities ($qDots), rather than the usual conjugate momenta ($ps).
@@ -238,6 +255,7 @@ sub Init_Hamilton {
 		}
         
         $calculateFluidDrag = any($dragSpecsNormal->glue(0,$dragSpecsAxial));
+		if ($calculateFluidDrag){Init_DragKernel()}
 
 		if (any($init_segCs<0)){
 			$dampOnlyOnExpansion = 1;
@@ -246,7 +264,9 @@ sub Init_Hamilton {
 		else {$dampOnlyOnExpansion = 0}
         
         DE_InitCounts();
+        DE_InitEnergyAccounting();
         DE_InitExtraOutputs();
+        $init_segDragMults = undef;     # Until DE_SetDragMultipliers().
 		
         #JAC_FacInit();
     }
@@ -276,6 +296,25 @@ sub Init_Hamilton {
 		
         if ($verbose>=3){pq($stripStartTime,$restartT,$thisSegStartT,$Arg_beginningNewSeg,$stripping)}
     }
+    elsif ($mode eq "remesh") {
+        my ($Arg_restartT,$Arg_Dynams,
+			$Arg_segLens,$Arg_segDiams,$Arg_segMasses,$Arg_segVols,$Arg_segKs,$Arg_segCs) = @_;
+		
+		## Called only by Remesh_LINE().  The seg arrays already include the fly mass and displacement in the last seg, and the second half of $Arg_Dynams holds the relative velocities ($qDots), not the momenta, exactly as on an initialize with an empty loaded state.
+		
+        PrintSeparator("Remeshing, re-initializing stepper,",3);
+		
+        $T0					= $Arg_restartT;
+        $Dynams0			= $Arg_Dynams->copy;
+        $init_segLens		= $Arg_segLens->copy;
+        $init_segDiams		= $Arg_segDiams->copy;
+        $init_segMasses		= $Arg_segMasses->copy;
+        $init_segVols		= $Arg_segVols->copy;
+        $init_segKs			= $Arg_segKs->copy;
+        $init_segCs			= $Arg_segCs->copy;
+		$init_numLineSegs	= $Arg_segLens->nelem - $numRodSegs;
+		$numLineSegs		= $init_numLineSegs;
+    }
     elsif ($mode eq "restart_cast") {
         my ($Arg_restartT,$Arg_Dynams) = @_;
 
@@ -313,13 +352,14 @@ sub Init_Hamilton {
     else {die "Unknown mode.\nStopped"}
 	
 	
-	if ($mode eq "initialize" or $mode eq "restart_swing"){
+	if ($mode eq "initialize" or $mode eq "restart_swing" or $mode eq "remesh"){
 
 		# Setup the shared storage:
 		Init_WorkingCopies();
 		Init_DynamSlices();
 		Init_HelperPDLs();
 		Init_HelperSlices();
+		Init_DragMultipliers();
 		
 		# Need do this just this once:
 		Calc_CartesianPartials();    # Needs the helper PDLs and slices to be defined
@@ -343,11 +383,15 @@ sub Init_Hamilton {
         $DE_lastSteppingCall = 0;
         $DE_lastSteppingT    = $T0;
         $DE_maxAttainedT    = $T0;
+        @DE_recentCallDts = ();
+        @remeshSegBornTs = ();
 
         # Figuring maybe 1*$nqs calls per step trial.
     }
+	elsif ($mode eq "remesh"){Set_ps_From_qDots($T0)}
 	
-    JACInit();
+    # Restarts keep what numjac has learned.  Remeshing changes every segment, so starts over:
+    JACInit(($mode eq "restart_swing" or $mode eq "restart_cast") ? $prevNumLineSegs : undef);
 
     $DE_status          = 0;
     $DE_errMsg          = "";
@@ -466,6 +510,10 @@ sub Init_WorkingCopies {
         $flyDispVol        = ($holding == 1) ? $init_segVols(-1) : $init_flyDispVol;
         # For parallelism.  Actually there never will be tip holding when swinging.
     }
+	
+	if ($stripping and $continuousStripping){
+		Init_CONTINUOUS_STRIPPING($lineSegMasses,$lineSegVols);
+	}
     
     $Masses		= $segMasses;
 	
@@ -801,6 +849,108 @@ sub AdjustFirstSeg_STRIPPING { use constant V_AdjustFirstSeg_STRIPPING => 0;
 }
 
 
+## Continuous stripping.  An alternative to AdjustFirstSeg_STRIPPING() plus the caller's scheduled restarts.  Instead of shortening only the first line segment and dropping it when it is used up, the stripped length is spread over all the line segments, which keep their original proportions and are refilled from the material profile recorded at the start.  Everything is a smooth function of t alone, so the solver sees the same model on every trial step, the number of dynamical variables never changes, and a long stripped swing runs as a single integration.
+my $contStripMinRemainFract	= 0.05;
+	# Stop stripping when this fraction of the original line remains outside the rod tip.
+my ($contStripLineLen,$contStripFracts,$contStripCumLens,
+	$contStripCumMasses,$contStripCumVols,$contStripCumEAs,$contStripCumCLs,
+	$contStripCenters,$contStripDiams,
+	$contStripCurrentFract,$contStripCapped);
+
+sub Init_CONTINUOUS_STRIPPING { use constant V_Init_CONTINUOUS_STRIPPING => 0;
+	my ($lineSegMasses,$lineSegVols) = @_;
+	
+	## Record the line's material as cumulative sums over arc length measured from the rod tip, so AdjustLine_CONTINUOUS_STRIPPING() can resample it for any stripped length.  The fly mass and displacement ride on the last segment and are kept out of the profile.
+	
+	my $lens	= $lineSegLens->copy;
+	my $masses	= $lineSegMasses->copy;
+	$masses(-1)	-= $flyMass;
+	my $vols	= ($airOnly) ? zeros($numLineSegs) : $lineSegVols->copy;
+	if (!$airOnly){$vols(-1) -= $flyDispVol}
+	
+	$contStripLineLen	= $lens->sumover->sclr;
+	$contStripCumLens	= pdl(0)->glue(0,cumusumover($lens));
+	$contStripFracts	= $contStripCumLens/$contStripLineLen;
+	$contStripCumMasses	= pdl(0)->glue(0,cumusumover($masses));
+	$contStripCumVols	= pdl(0)->glue(0,cumusumover($vols));
+	
+	# The Ks and Cs have the seg len in the denominator, so K*len*len is the modulus-area product integrated over the segment:
+	$contStripCumEAs	= pdl(0)->glue(0,cumusumover($lineSegKs*$lens*$lens));
+	$contStripCumCLs	= pdl(0)->glue(0,cumusumover($lineSegCs*$lens*$lens));
+	
+	$contStripCenters	= ($contStripCumLens(0:-2)+$contStripCumLens(1:-1))/2;
+	$contStripDiams		= $segDiams($numRodSegs:-1)->copy;
+	
+	$contStripCurrentFract	= 1;
+	$contStripCapped		= 0;
+	
+	if (DEBUG and V_Init_CONTINUOUS_STRIPPING and $verbose>=4){pq($contStripLineLen,$contStripFracts,$contStripCumMasses)}
+}
+
+
+sub Get_StripRemainingFract {
+	my ($t) = @_;
+	
+	## Fraction of the original line length still outside the rod tip at time $t.  Always 1 unless stripping continuously.
+	
+	if (!$continuousStripping or !$stripRate or $t <= $stripStartTime){return 1}
+	
+	my $fract = 1 - ($t-$stripStartTime)*$stripRate/$contStripLineLen;
+	return ($fract > $contStripMinRemainFract) ? $fract : $contStripMinRemainFract;
+}
+
+
+sub AdjustLine_CONTINUOUS_STRIPPING { use constant V_AdjustLine_CONTINUOUS_STRIPPING => 0;
+	my ($t) = @_;
+	
+	my $remainFract = Get_StripRemainingFract($t);
+	if ($remainFract == $contStripCurrentFract){return}
+	$contStripCurrentFract = $remainFract;
+	
+	if ($remainFract == $contStripMinRemainFract and !$contStripCapped){
+		if ($verbose>=2){printf("\n!! STRIPPING STOPPED at t=%.3f with %.0f%% of the line remaining !!\n\n",$t,100*$remainFract)}
+		$contStripCapped = 1;
+	}
+	
+	# Material coordinates of the segment boundaries:
+	my $stripLen	= (1-$remainFract)*$contStripLineLen;
+	my $bounds		= $stripLen + $contStripFracts*($remainFract*$contStripLineLen);
+	my $lens		= $bounds(1:-1)-$bounds(0:-2);
+	
+	my ($cumMasses)	= interpolate($bounds,$contStripCumLens,$contStripCumMasses);
+	my ($cumEAs)	= interpolate($bounds,$contStripCumLens,$contStripCumEAs);
+	my ($cumCLs)	= interpolate($bounds,$contStripCumLens,$contStripCumCLs);
+	
+	my $masses		= $cumMasses(1:-1)-$cumMasses(0:-2);
+	$masses(-1)		+= $flyMass;
+	
+	$lineSegLens				.= $lens;
+	$segMasses($numRodSegs:-1)	.= $masses;
+		# $Masses is $segMasses, and $MassesDummy1 follows both.
+	my $revSums			= cumusumover($Masses(-1:0));
+	$outboardMassSums	.= $revSums(-1:0);
+	
+	$lineSegKs	.= ($cumEAs(1:-1)-$cumEAs(0:-2))/($lens*$lens);
+	$lineSegCs	.= ($cumCLs(1:-1)-$cumCLs(0:-2))/($lens*$lens);
+	
+	if (!$airOnly){
+		my ($cumVols)	= interpolate($bounds,$contStripCumLens,$contStripCumVols);
+		my $vols		= $cumVols(1:-1)-$cumVols(0:-2);
+		$vols(-1)		+= $flyDispVol;
+		$segVols($numRodSegs:-1) .= $vols;
+	}
+	
+	my $centers		= (($bounds(0:-2)+$bounds(1:-1))/2)->clip($contStripCenters(0)->sclr,$contStripCenters(-1)->sclr);
+	my ($diams)		= interpolate($centers,$contStripCenters,$contStripDiams);
+	$segDiams($numRodSegs:-1) .= $diams;
+	
+	# Every time, so that $invKE goes with the masses just set.  The stepper calls DE at trial and retreating times, so anything kept from an earlier call would make the right-hand side depend on the call history rather than on (t,y) alone:
+	Calc_KE_Inverse();
+	
+	if (DEBUG and V_AdjustLine_CONTINUOUS_STRIPPING and $verbose>=5){pq($remainFract,$lineSegLens,$segMasses,$lineSegKs,$lineSegCs)}
+}
+
+
 
 sub AdjustTrack_STRIPPING { use constant V_AdjustTrack_STRIPPING => 0;
     my ($t) = @_;
@@ -898,8 +1048,8 @@ sub Calc_Driver { use constant V_Calc_Driver => 1;
         $driverZDot = $driverZSpline->evaluate($t+$dt);
         $driverZDot = ($driverZDot-$driverZ)/$dt;
 		
-		if ($numRodSegs and $verbose>=3){
-			# Handle dots are only used for reporting.
+		if ($numRodSegs and ($verbose>=3 or $energyAccounting)){
+			# Handle dots are only used for reporting and energy accounting.
 			
 			# And again abusing:
 			$driverDXDot = $driverDXSpline->evaluate($t+$dt);
@@ -1139,6 +1289,10 @@ my $smallAngle = 0.001;		# Radians.
 my ($rodStretchDampingPowers,$rodBendDampingPowers);
 my ($handleBendingForceX,$handleBendingForceY,$handleBendingForceZ); 	# For reporting.
 
+# Scalar totals for energy accounting.  Set only if $energyAccounting:
+my ($rodStretchDampPower,$rodBendDampPower,$lineDampPower,$dragPower,$appliedPower,$driverPower);
+my ($rodElasticEnergy,$lineElasticEnergy);
+
 
 sub Calc_pDotsRodMaterial { use constant V_Calc_pDotsRodMaterial => 1;
     
@@ -1179,6 +1333,11 @@ sub Calc_pDotsRodMaterial { use constant V_Calc_pDotsRodMaterial => 1;
 	}
     #pq($uRodXs,$uRodYs,$uRodZs);
 	
+	if ($energyAccounting){
+		$rodStretchDampPower	= ($stretchDamps*$stretchDots)->sumover->sclr;
+		$rodElasticEnergy		= 0.5*($rodSegKs*$stretches**2)->sumover->sclr;
+	}
+	
 	my $stretchNetForces = $stretchForces + $stretchDamps;
 	
 	$pDotsRodXs = $stretchNetForces*$uRodXs;
@@ -1219,6 +1378,9 @@ sub Calc_pDotsRodMaterial { use constant V_Calc_pDotsRodMaterial => 1;
 
 	my $kTorques		= ($rodBendTorqueKs->glue(0,pdl(0)))*$angles;
 		# Includes a zero torque at the rod tip.
+	if ($energyAccounting){
+		$rodElasticEnergy += 0.5*($rodBendTorqueKs*$angles(0:-2)**2)->sumover->sclr;
+	}
 	
 	# Make the normals unit length:
 	$upperXs /= $upperLens;
@@ -1262,7 +1424,7 @@ sub Calc_pDotsRodMaterial { use constant V_Calc_pDotsRodMaterial => 1;
 	my $bendGenForceZs =
 		($upperZs(0:-2)*$kTorques(0:-2) - $lowerZs(1:-1)*$kTorques(1:-1))/$rodDrs;
 	
-	if ($verbose>=3){
+	if ($verbose>=3 or $energyAccounting){
 		# For reporting, need the bending torque at the junction between the handle and the first active segment.  I believe this is:
 		$handleBendingForceX = $lowerXs(0)*$kTorques(0);
 		$handleBendingForceY = $lowerYs(0)*$kTorques(0);
@@ -1337,6 +1499,18 @@ sub Calc_pDotsRodMaterial { use constant V_Calc_pDotsRodMaterial => 1;
 	$pDotsRodYs += $bendGenDampYs;
 	$pDotsRodZs += $bendGenDampZs;
 
+	if ($energyAccounting){
+		$rodBendDampPower	= ($bendGenDampXs*$rodDxDots + $bendGenDampYs*$rodDyDots + $bendGenDampZs*$rodDzDots)->sumover->sclr;
+		
+		# The driver holds the inboard end of the first rod segment, so the constraint force there is just that segment's net material generalized force.  Add the handle rotation working against the bending torque at the handle top, as in the verbose report in Calc_pDots().  The bend damping at that joint is not included:
+		$driverPower	= $pDotsRodXs(0)->sclr*$driverXDot +
+						  $pDotsRodYs(0)->sclr*$driverYDot +
+						  $pDotsRodZs(0)->sclr*$driverZDot;
+		$driverPower	+= sclr($driverDXDot*$handleBendingForceX +
+								$driverDYDot*$handleBendingForceY +
+								$driverDZDot*$handleBendingForceZ);
+	}
+
     if (DEBUG and V_Calc_pDotsRodMaterial and $verbose>=4){pq($pDotsRodXs,$pDotsRodYs,$pDotsRodZs)}
 
     # return ($pDotsRodXs,$pDotsRodYs,$pDotsRodZs)
@@ -1412,6 +1586,17 @@ sub Calc_pDotsLineMaterial { use constant V_Calc_pDotsLineMaterial => 1;
 	}
 
 	my $lineNetForces	= $lineTensions + $lineDampings;
+	
+	if ($energyAccounting){
+		$lineDampPower		= ($lineDampings*$lineStretchDots)->sumover->sclr;
+		$lineElasticEnergy	= 0.5*($smoothTauts*$lineSegKs*$lineStretches**2)->sumover->sclr;
+			# Exact away from the smoothed taut-slack transition.
+		if (!$numRodSegs){
+			# With no rod, the driver holds the inboard end of the first line segment:
+			$driverPower	= $lineNetForces(0)->sclr*($uLineXs(0)->sclr*$driverXDot +
+							  $uLineYs(0)->sclr*$driverYDot + $uLineZs(0)->sclr*$driverZDot);
+		}
+	}
 	#if ($verbose>=3){ppf("\$lineNetForces =\t","%7.1f\t",$lineNetForces,"\n\n")}
 	
 	$pDotsLineXs = $lineNetForces*$uLineXs;
@@ -1667,6 +1852,111 @@ sub Calc_SegDragForces { use constant V_Calc_SegDragForces => 0;
 }
 
 
+## Fused drag kernel.  Calc_Drags() used to call Calc_SegDragForces() three times per RHS evaluation (normal, axial, fly), each redoing the fluid blends, the RE clamp, and a general pow.  Here the three are concatenated and done in a single pass, and the fixed power of each drag spec is evaluated either exactly by a cheap special form, or by lookup in a table that is linear in log10(RE).  Calc_SegDragForces() remains the reference implementation, and is still used by Calc_FreeSinkSpeed().
+
+# Table lookup error:  Linear interpolation of RE**p = exp(p*ln(10)*x) on a grid in x = log10(RE) with spacing h = 1/$dragTablePerDecade has relative error at most (p*ln(10)*h)**2/8.  With 128 points per decade that is about 4.0e-5*p**2, so 1.6e-4 for |p|<=2, and the additive $min term only reduces it.  REs above $dragTableMaxRE (far beyond anything we see: ~100 for sinking in water to ~10,000 for casting in air) are evaluated at the table end.
+my $dragTablePerDecade	= 128;
+my $dragTableMinRE		= 0.01;		# Same as the RE clamp in Calc_SegDragForces().
+my $dragTableMaxRE		= 1e8;
+my ($dragKernelNormal,$dragKernelAxial);
+
+sub Init_DragKernel { use constant V_Init_DragKernel => 0;
+	
+	## Called once at initialization, since the drag specs do not change during a run.
+	
+	$dragKernelNormal	= DragKernelSpec($dragSpecsNormal);
+	$dragKernelAxial	= DragKernelSpec($dragSpecsAxial);
+	
+	if (DEBUG and V_Init_DragKernel and $verbose>=4){pq($dragKernelNormal,$dragKernelAxial)}
+}
+
+sub DragKernelSpec {
+	my ($dragSpecs) = @_;
+	
+	## Choose how mult*RE**power+min will be evaluated for this spec.  Common powers get exact closed forms, anything else gets the table.
+	
+	my %spec;
+	$spec{mult}		= $dragSpecs(0)->sclr;
+	$spec{power}	= $dragSpecs(1)->sclr;
+	$spec{min}		= $dragSpecs(2)->sclr;
+	
+	my $power = $spec{power};
+	
+	if    ($power == 0)		{$spec{form} = "const"}
+	elsif ($power == 1)		{$spec{form} = "lin"}
+	elsif ($power == -1)	{$spec{form} = "recip"}
+	elsif ($power == 0.5)	{$spec{form} = "sqrt"}
+	elsif ($power == -0.5)	{$spec{form} = "rsqrt"}
+	elsif ($power == 2)		{$spec{form} = "sq"}
+	else {
+		$spec{form}			= "table";
+		$spec{logMinRE}		= log($dragTableMinRE)/log(10);
+		my $numPts			= 1+int($dragTablePerDecade*(log($dragTableMaxRE/$dragTableMinRE)/log(10)));
+		my $logREs			= $spec{logMinRE} + sequence($numPts)/$dragTablePerDecade;
+		$spec{CDrags}		= $spec{mult}*(10**($power*$logREs)) + $spec{min};
+		$spec{maxIndex}		= $numPts-2;
+	}
+	
+	return \%spec;
+}
+
+sub Eval_DragCoeffs {
+	my ($spec,$REs) = @_;
+	
+	## Expects $REs already clamped to be at least $dragTableMinRE.
+	
+	my ($mult,$min)	= ($spec->{mult},$spec->{min});
+	my $form		= $spec->{form};
+	
+	if    ($form eq "recip")	{return $mult/$REs + $min}
+	elsif ($form eq "const")	{return zeros($REs->nelem) + ($mult+$min)}
+	elsif ($form eq "lin")		{return $mult*$REs + $min}
+	elsif ($form eq "sqrt")		{return $mult*sqrt($REs) + $min}
+	elsif ($form eq "rsqrt")	{return $mult/sqrt($REs) + $min}
+	elsif ($form eq "sq")		{return $mult*$REs*$REs + $min}
+	
+	my $xs	= ((log10($REs) - $spec->{logMinRE})*$dragTablePerDecade)->hclip($spec->{maxIndex}+1);
+	my $is	= floor($xs)->hclip($spec->{maxIndex})->long;
+	my $fs	= $xs - $is;
+	my $tab	= $spec->{CDrags};
+	
+	return (1-$fs)*$tab->index($is) + $fs*$tab->index($is+1);
+}
+
+
+sub Calc_FusedDragForces { use constant V_Calc_FusedDragForces => 0;
+	my ($speedNs,$speedAs,$flySpeed,$nodeLens) = @_;
+	
+	## Returns ($FNs,$FAs,$flyDrag), the same as the corresponding three Calc_SegDragForces() calls in Calc_Drags() would, up to the table error documented above.  The work vector is laid out as [normal nodes, fly, axial nodes], and the fly uses the normal spec with its nominal diam and len.
+	
+	my $n = $speedNs->nelem;
+	
+	my $speeds		= $speedNs->glue(0,$flySpeed->flat,$speedAs);
+	my $subMults	= $submergedMult->glue(0,$submergedMult(-1),$submergedMult);
+	my $diams		= $segDiams->glue(0,$flyNomDiam,$segDiams);
+	my $lens		= $nodeLens->glue(0,$flyNomLen,$nodeLens);
+	my $charLens	= $segDiams->glue(0,$flyNomDiam,$nodeLens);
+	
+	# Blend once for all three:
+	my $fluidKinematicViscosities
+		= $subMults*$waterKinematicViscosity + (1-$subMults)*$airKinematicViscosity;
+	my $fluidDensities
+		= $subMults*$waterDensity + (1-$subMults)*$airDensity;
+	
+	my $REs		= (($speeds*$charLens)/$fluidKinematicViscosities)->lclip($dragTableMinRE);
+	
+	my $CDrags	= zeros($speeds->nelem);
+	$CDrags(0:$n)	.= Eval_DragCoeffs($dragKernelNormal,$REs(0:$n));
+	$CDrags($n+1:-1).= Eval_DragCoeffs($dragKernelAxial,$REs($n+1:-1));
+	
+	my $FDrags	= $CDrags*(0.5*$fluidDensities*$speeds*$speeds*$diams*$lens);
+	
+	if (DEBUG and V_Calc_FusedDragForces and $verbose>=5){pq($REs,$CDrags,$FDrags)}
+	
+	return ($FDrags(0:$n-1)->sever,$FDrags($n+1:-1)->sever,$FDrags($n)->sever);
+}
+
+
 my ($flySpeed,$flyDrag);	# For reporting.
 
 sub Calc_Drags { use constant V_Calc_Drags => 1;
@@ -1799,11 +2089,16 @@ sub Calc_Drags { use constant V_Calc_Drags => 1;
         $nDzs($ii) .= 0;
     }
 	
+    # The fly speed is needed now since the fly drag is computed in the same pass as the segment drags:
+    $flySpeed = sqrt($relVXs(-1)**2 + $relVYs(-1)**2 + $relVZs(-1)**2);
+
    #pq($speedNs,$submergedMult,$dragSpecsNormal,$segDiams,$nodeLens);
-    my $FNs = Calc_SegDragForces($speedNs,$submergedMult,
-                                    $dragSpecsNormal,$segDiams,$nodeLens,1);
-    my $FAs = Calc_SegDragForces($speedAs,$submergedMult,
-                                    $dragSpecsAxial,$segDiams,$nodeLens,0);
+    my ($FNs,$FAs);
+    ($FNs,$FAs,$flyDrag) = Calc_FusedDragForces($speedNs,$speedAs,$flySpeed,$nodeLens);
+	if (defined($segDragMults)){
+		$FNs *= $segDragMults;
+		$FAs *= $segDragMults;
+	}
 
 	
 	my ($lineSpeedsNormal,$lineSpeedsAxial,$lineDragsNormal,$lineDragsAxial);	# For reporting.
@@ -1851,24 +2146,16 @@ ENABLE ME!
 =cut
 	
     # Add the fly drag to the line (or if none, to the rod) tip node. No notion of axial or normal here:
-	$flyDrag = 0;
-	
-    $flySpeed = sqrt($relVXs(-1)**2 + $relVYs(-1)**2 + $relVZs(-1)**2);
-
     if ($flySpeed){
         
-        my $flyIsSubmerged  = $submergedMult(-1);
-        $flyDrag   =
-            Calc_SegDragForces($flySpeed,$flyIsSubmerged,
-                                $dragSpecsNormal,$flyNomDiam,$flyNomLen,1);
-
         my $flyDragX  = $flyDrag*$relVXs(-1)/$flySpeed;
         my $flyDragY  = $flyDrag*$relVYs(-1)/$flySpeed;
         my $flyDragZ  = $flyDrag*$relVZs(-1)/$flySpeed;
 		
-		$dragXs += $flyDragX;
-		$dragYs += $flyDragY;
-		$dragZs += $flyDragZ;
+		$dragXs(-1) += $flyDragX;
+		$dragYs(-1) += $flyDragY;
+		$dragZs(-1) += $flyDragZ;
+			# Just the tip node, as the comment above has always said.  Adding the one element pdls to the whole vectors spread the fly's drag over every node.
     }
 
 	# Always report forces if writing to terminal:
@@ -1954,6 +2241,10 @@ sub Calc_pDots { use constant V_Calc_pDots => 1;
 
     $pDots  .= 0;
 	
+	if ($energyAccounting){
+		($rodStretchDampPower,$rodBendDampPower,$lineDampPower,$dragPower,$appliedPower,$driverPower) = map {0} (0..5);
+		($rodElasticEnergy,$lineElasticEnergy) = (0,0);
+	}
 
     if ($numRodSegs){
         Calc_pDotsRodMaterial();
@@ -2029,6 +2320,15 @@ sub Calc_pDots { use constant V_Calc_pDots => 1;
     if (DEBUG and V_Calc_pDots and $verbose>=4){
         pq($netAppliedXs,$netAppliedYs,$netAppliedZs);
     }
+
+	if ($energyAccounting){
+		# Split the power of the applied forces into the drag part and all the rest (gravity, buoyancy and tip holding):
+		my $totalPower = ($netAppliedXs*$VXs+$netAppliedYs*$VYs+$netAppliedZs*$VZs)->sumover->sclr;
+		if ($calculateFluidDrag){
+			$dragPower = ($dragXs*$VXs+$dragYs*$VYs+$dragZs*$VZs)->sumover->sclr;
+		}
+		$appliedPower = $totalPower-$dragPower;
+	}
 	
 	$dxpDots += ($netAppliedXs x $dWs_dws)->flat;
 	$dypDots += ($netAppliedYs x $dWs_dws)->flat;
@@ -2153,6 +2453,280 @@ sub Calc_pDots { use constant V_Calc_pDots => 1;
 
 
 
+## Adaptive remeshing of the line.  Called by the swing caller between solver runs.  Segments are split where the local bend angle or the strain rate is large, and adjacent pairs are merged where the line is nearly straight and slack, and the merged seg would be well clear of the split criteria.  A seg made by a split or merge is not changed again until it is $opts->{minDwell} secs old, so the mesh can't flip back and forth on successive calls.  Node masses sit at the outboard segment ends, and the node velocities are reassigned so that total mass and linear momentum are exactly conserved.  The restarted stepper then recomputes the conjugate momenta from those velocities, just as on an initialize with an empty loaded state.
+
+sub InSeries {
+	my ($k1,$k2) = @_;
+	
+	## The combined constant of two springs or dashpots in series.  Zero if either is, as when the settings give a zero modulus, rather than dividing by it.
+	
+	return ($k1 and $k2) ? $k1*$k2/($k1+$k2) : 0;
+}
+
+sub Remesh_LINE { use constant V_Remesh_LINE => 1;
+	my ($t,$Dynams,$opts) = @_;
+	
+	## Returns ($newDynams,$newSegLens) if the mesh changed, in which case the stepper has already been restarted on the new mesh, otherwise returns an empty list.  For now, line only (no rod), and not while stripping, since both of those keep their own per-segment bookkeeping.
+	
+	if ($numRodSegs or $stripping or $numSegs < 2){return ()}
+	
+	$dynams .= $Dynams->flat;
+	Calc_dQs();
+	Calc_Driver($t);
+	Calc_qDots();
+	
+	my $n = $nSegs;
+	
+	# Bend angles at the interior nodes, and for each seg the larger of the angles at its ends:
+	my $cosines	= ($uXs(0:-2)*$uXs(1:-1)+$uYs(0:-2)*$uYs(1:-1)+$uZs(0:-2)*$uZs(1:-1))->clip(-1,1);
+	my $bends	= acos($cosines);
+	my $inBends	= pdl(0)->glue(0,$bends);
+	my $outBends= $bends->glue(0,pdl(0));
+	my $segBends= ($inBends>$outBends)*$inBends + ($inBends<=$outBends)*$outBends;
+	
+	my $strains		= $drs/$segLens - 1;
+	my $strainRates	= $drDots/$segLens;
+	
+	# Absolute node velocities:
+	my $VXs_ = $driverXDot + cumusumover($dxDots);
+	my $VYs_ = $driverYDot + cumusumover($dyDots);
+	my $VZs_ = $driverZDot + cumusumover($dzDots);
+	
+	my @lens	= $segLens->list;
+	my @diams	= $segDiams->list;
+	my @masses	= $segMasses->list;
+	my @vols	= ($airOnly) ? map {0} (1..$n) : $segVols->list;
+	my @Ks		= $segKs->list;
+	my @Cs		= $segCs->list;
+	my @dxs		= $dxs->list;
+	my @dys		= $dys->list;
+	my @dzs		= $dzs->list;
+	my @Vs		= map {[$VXs_($_)->sclr,$VYs_($_)->sclr,$VZs_($_)->sclr]} (0..$n-1);
+	my @bends	= $bends->list;
+	my @inBends	= $inBends->list;
+	my @outBends= $outBends->list;
+	my @segBends= $segBends->list;
+	my @strains	= $strains->list;
+	my @rates	= $strainRates->list;
+	
+	my $flyM	= sclr($flyMass);
+	my $flyV	= ($airOnly) ? 0 : sclr($flyDispVol);
+	
+	my @mults	= (defined($segDragMults)) ? $segDragMults->list : (1) x $n;
+	
+	my @bornTs	= (@remeshSegBornTs == $n) ? @remeshSegBornTs : ($t-$opts->{minDwell}) x $n;
+	my @settled	= map {$t-$_ >= $opts->{minDwell}} @bornTs;
+	
+	my (@nLens,@nDiams,@nMasses,@nVols,@nKs,@nCs,@nDxs,@nDys,@nDzs,@nVs,@nBornTs,@nMults);
+	my ($numSplits,$numMerges) = (0,0);
+	my $count = $n;
+	
+	for (my $i=0;$i<$n;$i++){
+		
+		my $isLast = ($i == $n-1);
+		
+		if ($settled[$i] and $count < $opts->{maxSegs} and $lens[$i]/2 >= $opts->{minSegLen} and
+				($segBends[$i] > $opts->{splitAngle} or abs($rates[$i]) > $opts->{splitStrainRate})){
+			
+			# Split in half.  The fly mass and displacement stay with the outboard half:
+			my $mIn		= ($masses[$i] - ($isLast ? $flyM : 0))/2;
+			my $mOut	= $masses[$i] - $mIn;
+			my $vIn		= ($vols[$i] - ($isLast ? $flyV : 0))/2;
+			
+			my @VIn		= ($i) ? @{$Vs[$i-1]} : ($driverXDot,$driverYDot,$driverZDot);
+			my @VMid	= map {($VIn[$_]+$Vs[$i][$_])/2} (0..2);
+			my @VOut	= map {($masses[$i]*$Vs[$i][$_] - $mIn*$VMid[$_])/$mOut} (0..2);
+			
+			push @nLens,	($lens[$i]/2) x 2;
+			push @nDiams,	($diams[$i]) x 2;
+			push @nMasses,	$mIn,$mOut;
+			push @nVols,	$vIn,$vols[$i]-$vIn;
+			push @nKs,		(2*$Ks[$i]) x 2;
+			push @nCs,		(2*$Cs[$i]) x 2;
+			push @nDxs,		($dxs[$i]/2) x 2;
+			push @nDys,		($dys[$i]/2) x 2;
+			push @nDzs,		($dzs[$i]/2) x 2;
+			push @nVs,		\@VMid,\@VOut;
+			push @nBornTs,	$t,$t;
+			push @nMults,	($mults[$i]) x 2;
+			
+			$count++;
+			$numSplits++;
+		}
+		elsif ($i < $n-2 and $settled[$i] and $settled[$i+1] and $bends[$i] < $opts->{mergeAngle} and
+				$strains[$i] < 0 and $strains[$i+1] < 0 and
+				$inBends[$i] < $opts->{mergeAngle} and $outBends[$i+1] < $opts->{mergeAngle} and
+				abs($rates[$i]) < $opts->{splitStrainRate}/2 and abs($rates[$i+1]) < $opts->{splitStrainRate}/2 and
+				$lens[$i]+$lens[$i+1] <= $opts->{maxSegLen}){
+			
+			# Merge with the next seg, never the last one, which carries the fly.  The two node masses combine at the outboard node:
+			my $j	= $i+1;
+			my $m	= $masses[$i]+$masses[$j];
+			my @V	= map {($masses[$i]*$Vs[$i][$_] + $masses[$j]*$Vs[$j][$_])/$m} (0..2);
+			my $len	= $lens[$i]+$lens[$j];
+			
+			push @nLens,	$len;
+			push @nDiams,	($lens[$i]*$diams[$i]+$lens[$j]*$diams[$j])/$len;
+			push @nMasses,	$m;
+			push @nVols,	$vols[$i]+$vols[$j];
+			push @nKs,		InSeries($Ks[$i],$Ks[$j]);
+			push @nCs,		InSeries($Cs[$i],$Cs[$j]);
+			push @nDxs,		$dxs[$i]+$dxs[$j];
+			push @nDys,		$dys[$i]+$dys[$j];
+			push @nDzs,		$dzs[$i]+$dzs[$j];
+			push @nVs,		\@V;
+			push @nBornTs,	$t;
+			push @nMults,	($lens[$i]*$mults[$i]+$lens[$j]*$mults[$j])/$len;
+			
+			$count--;
+			$numMerges++;
+			$i++;
+		}
+		else {
+			push @nLens,	$lens[$i];
+			push @nDiams,	$diams[$i];
+			push @nMasses,	$masses[$i];
+			push @nVols,	$vols[$i];
+			push @nKs,		$Ks[$i];
+			push @nCs,		$Cs[$i];
+			push @nDxs,		$dxs[$i];
+			push @nDys,		$dys[$i];
+			push @nDzs,		$dzs[$i];
+			push @nVs,		$Vs[$i];
+			push @nBornTs,	$bornTs[$i];
+			push @nMults,	$mults[$i];
+		}
+	}
+	
+	@remeshSegBornTs = @nBornTs;
+	if (!$numSplits and !$numMerges){return ()}
+	
+	if ($verbose>=2){printf("\n!! REMESHED at t=%.3f: %d splits, %d merges, %d -> %d segs !!\n",$t,$numSplits,$numMerges,$n,$count)}
+	
+	# Back to relative velocities, which is what the restart expects in the second half:
+	my @dVs;
+	my @VPrev = ($driverXDot,$driverYDot,$driverZDot);
+	foreach my $V (@nVs){
+		push @dVs,[map {$V->[$_]-$VPrev[$_]} (0..2)];
+		@VPrev = @$V;
+	}
+	my $newDynams0 = pdl(@nDxs,@nDys,@nDzs,(map {$_->[0]} @dVs),(map {$_->[1]} @dVs),(map {$_->[2]} @dVs));
+	
+	# Picked up by Init_DragMultipliers() in the restart:
+	if (defined($segDragMults)){$init_segDragMults = pdl(\@nMults)}
+	
+	Init_Hamilton("remesh",$t,$newDynams0,
+				pdl(\@nLens),pdl(\@nDiams),pdl(\@nMasses),pdl(\@nVols),pdl(\@nKs),pdl(\@nCs));
+	
+	return (Get_DynamsCopy(),$segLens->copy);
+}
+
+
+
+## Static equilibrium.  Called right after Init_Hamilton("initialize") to replace the starting configuration with the one in which the rod and line would rest under gravity, buoyancy, the holding spring and any steady flow, with the driver frozen in its pose at the given time.  With all the relative velocities zero the kinetic terms drop out of Calc_pDots(), and what is left is the sum of the elastic forces from Calc_pDotsRodMaterial() and Calc_pDotsLineMaterial() and the applied forces.  The rest configuration is thus a zero of $pDots as a function of $qs alone, which is found here by Newton's method, with the jacobian from numjac(), damped Levenberg-Marquardt fashion whenever a full step fails to reduce the residual.  A few tens of jacobians replace the many thousands of steps needed to let a damped integration settle.
+
+my $staticMaxIters		= 50;
+my $staticRelTol		= 1e-9;
+	# Converged when no generalized force is bigger than this fraction of the total weight.
+my $staticMaxStepFract	= 0.25;
+	# No segment vector may change by more than this fraction of its nominal length in one step.
+
+sub Calc_StaticResidual {
+	my ($t,$trialQs) = @_;
+
+	## The $pDots at rest in the configuration $trialQs, which is left loaded in $qs.
+
+	$qs		.= $trialQs;
+	$qDots	.= 0;
+	Set_ps_From_qDots($t);		# Calls Calc_Driver().
+	Calc_dQs();
+	Calc_qDots();
+	Calc_Qs();
+	Calc_QDots();
+	Calc_pDots($t);
+
+	return $pDots->copy;
+}
+
+sub Calc_StaticEquilibrium { use constant V_Calc_StaticEquilibrium => 1;
+	my ($t,$maxIters,$relTol) = @_;
+
+	## Returns ($converged,$numIters,$maxResidual), the last in dynes.  On return $dynams holds the best configuration found, at rest, whether or not the iteration converged.
+
+	if (!defined($maxIters)){$maxIters = $staticMaxIters}
+	if (!defined($relTol)){$relTol = $staticRelTol}
+
+	PrintSeparator("Solving for static equilibrium",2);
+
+	my $weight	= sum(abs($nominalG*$surfaceGravityCmPerSec2*$Masses));
+	my $fTol	= $relTol*(($weight > 0) ? $weight : 1);
+
+	my $ythresh	= 1e-6*ones($nqs);
+	my $ytyp	= $segLens->glue(0,$segLens)->glue(0,$segLens);
+	my $fac		= zeros(0);
+
+	my $F		= sub {return Calc_StaticResidual($t,$_[0])};
+	my $q		= $qs->copy;
+	my $res		= &$F($q);
+	my $resMax	= max(abs($res));
+	my $lambda	= 0;
+	my $numIters;
+	my $converged = 0;
+
+	for ($numIters=0;$numIters<$maxIters;$numIters++){
+
+		if (!isfinite($resMax)){last}
+		if ($resMax <= $fTol){$converged = 1; last}
+
+		my ($dFdq)	= numjac($F,$q,$res,$ythresh,$ytyp,\$fac);
+		my $Ks		= -$dFdq;
+			# The stiffness, close to symmetric positive definite where the line is taut.
+		my $KDiag	= abs($Ks->diagonal(0,1))->copy;
+		$KDiag->where($KDiag == 0) .= 1;
+
+		my $accepted = 0;
+		for (my $try=0;$try<12;$try++){
+			my $Ainv = inv($Ks + $lambda*stretcher($KDiag),{s=>1});
+			if (defined($Ainv)){
+				my $dq = ($Ainv x $res->transpose)->flat;
+
+				# Limit the largest change of any segment vector:
+				my $fracts		= sqrt(sumover($dq->splitdim(0,$nSegs)->transpose**2))/$segLens;
+				my $maxFract	= max($fracts);
+				if ($maxFract > $staticMaxStepFract){$dq *= $staticMaxStepFract/$maxFract}
+
+				if (all(isfinite($dq))){
+					my $qTry		= $q + $dq;
+					my $resTry		= &$F($qTry);
+					my $resTryMax	= max(abs($resTry));
+					if (isfinite($resTryMax) and $resTryMax < $resMax){
+						($q,$res,$resMax) = ($qTry,$resTry,$resTryMax);
+						$lambda = ($lambda > 1e-6) ? $lambda/10 : 0;
+						$accepted = 1;
+						last;
+					}
+				}
+			}
+			$lambda = ($lambda) ? 10*$lambda : 1e-3;
+		}
+		if (V_Calc_StaticEquilibrium and $verbose>=3){printf("Static iteration %d: max residual %.3e dynes, lambda %.1e\n",$numIters+1,$resMax,$lambda)}
+		if (!$accepted){last}
+	}
+
+	# Leave the best configuration found, at rest:
+	Calc_StaticResidual($t,$q);
+
+	if ($verbose>=2){
+		if ($converged){printf("Static equilibrium found in %d iterations (max residual %.2e dynes).\n",$numIters,$resMax)}
+		else {printf("WARNING: Static equilibrium not found after %d iterations (max residual %.2e dynes).  Starting from the best configuration found.\n",$numIters,$resMax)}
+	}
+
+	return ($converged,$numIters,$resMax);
+}
+
+
+
+
 sub Set_HeldTip { use constant V_Set_HeldTip => 1;
     my ($t) = @_;   # $t is a PERL scalar.
     
@@ -2238,21 +2812,22 @@ sub Get_ExtraOutputs {
 
 my $averageDt;
 my $averageDtIndex;
-my $averageDtFIFO;
+my @averageDtFIFO;
+	# A perl array rather than a pdl, since this is called on every stepping DE call and single element pdl slice writes are comparatively expensive.
 
 sub DEAverageDt {
     my ($dt,$initSize)= @_;
     
     if (defined($initSize)){
-        $averageDtFIFO  = $dt*ones($initSize);
+        @averageDtFIFO  = ($dt) x $initSize;
         $averageDtIndex = 0;
         $averageDt      = $dt;
     } else {
-        my $oldDt   = $averageDtFIFO($averageDtIndex)->sclr;
+        my $oldDt   = $averageDtFIFO[$averageDtIndex];
         #pq($dt,$oldDt);
-        $averageDtFIFO($averageDtIndex++) .= $dt;
-        if ($averageDtIndex >= $averageDtFIFO->nelem){$averageDtIndex = 0}
-        $averageDt  += ($dt-$oldDt)/($averageDtFIFO->nelem);
+        $averageDtFIFO[$averageDtIndex++] = $dt;
+        if ($averageDtIndex >= @averageDtFIFO){$averageDtIndex = 0}
+        $averageDt  += ($dt-$oldDt)/@averageDtFIFO;
         #pq($averageDt,$averageDtFIFO);
     }
     #pq($dt,$averageDt);
@@ -2266,6 +2841,103 @@ sub Get_movingAvDt {
 }
 
 
+sub DETrackCallDt {
+    my ($dt) = @_;
+    
+    ## Only forward spacings are kept.  A backward one may be a rejected step, but with the Runge-Kutta steppers it is usually just a stage time that lies inside the step, so it tells us nothing.
+    
+    if ($dt > 0){
+        push @DE_recentCallDts,$dt;
+        if (@DE_recentCallDts > $DE_numRecentCallDts){shift @DE_recentCallDts}
+    }
+}
+
+
+sub DETrackSteppingCall {
+    my ($t) = @_;
+    
+    ## For function calls from the stepper, not the jacobian's.  Records the spacing from the previous one, which feeds the moving average dt and the step hint, and returns it.
+    
+    my $dt = $t-$DE_lastSteppingT;
+    DETrackCallDt($dt);
+    if ($dt>0){$DE_movingAvDt = DEAverageDt($dt)}
+    $DE_lastSteppingCall = $DE_numCalls;
+    $DE_lastSteppingT    = $t;
+    return $dt;
+}
+
+
+sub Get_stepHintDt {
+    
+    ## The initial step for the solver call that continues from here.  This is the largest of the recent forward spacings between function call times, NOT the step size the solver last accepted, which it doesn't report.  For the multistep steppers (msbdf, msadams) the calls of a step are all at its end, so the spacing is the step itself.  For the Runge-Kutta family the stages lie inside the step, and the spacing is some fraction of it, typically a half or more.  Either way it errs small, which costs the solver a few cheap steps to grow, rather than large, which would cost rejections.  Taking the largest also skips over the short last step the solver makes to land on the stop time.  Falls back on the moving average if there are no calls yet.
+    
+    if (!@DE_recentCallDts){return $DE_movingAvDt}
+    my $hint = 0;
+    foreach my $dt (@DE_recentCallDts){if ($dt > $hint){$hint = $dt}}
+    return $hint;
+}
+
+
+sub Calc_qpDots {
+    my ($t,$allQs) = @_;
+    
+    ## The right hand side of the hamiltonian system at time $t, from the current package $qs and $ps, left in the globals $qDots and $pDots.  Everything here is physics, shared by DE(), DE_Lean() and DE_EnergyColumns(), which add only their own bookkeeping around it.  If $allQs, the cartesian coords are brought up to date even when the forces don't need them.
+    
+	if ($stripping < 0 and $t > $stripStartTime){
+		$stripping = 1;
+		#print("DE: ");pq($t,$stripping);
+	}
+
+	if ($stripping == 1){
+		if ($continuousStripping){AdjustLine_CONTINUOUS_STRIPPING($t)}
+		else {AdjustFirstSeg_STRIPPING($t)}
+	}
+
+=begin comment
+	
+	if ($stripping < 0 and $t > $stripStartTime){
+		$stripping = 1; print("DE: ");pq($t,$stripping)}
+    if ($stripping == 1 and $DEfunc_dotCount == 1){
+	    # Must be done before Calc_dQs(), but must not be done while any single step is being taken.  Unfortunately, the solver doesn't tell us when it starts a new step.
+		$DE_adjustCounter++;
+		if ($DE_adjustCounter >= 1){
+			$DE_adjustCounter = 0;
+        	AdjustFirstSeg_STRIPPING($t);
+		}
+        AdjustFirstSeg_STRIPPING($t);
+		#$DE_adjustCounter
+    }
+=end comment
+
+=cut
+    
+    Calc_dQs();
+    #if (V_DE and $verbose>=4){pq($lineStrains)}
+        # Could compute $Qs now, but don't need them for what we do here.
+	
+    # Set global coords and external velocities.  See Set_ps_From_qDots():
+    Calc_Driver($t);
+    # This constraint drives the whole cast. Updates the driver globals.
+    
+    #Calc_ExtQDots();
+    #if (DEBUG and V_DE and $verbose>=4){pq($extQDots);print "D\n";}
+       # The contribution to QDots from the driving motion only.  This needs only $dQs_dqs.  It is critical that we DO NOT need the internal contributions to QDots here.
+    
+    Calc_qDots();
+    #if (DEBUG and V_DE and $verbose>=4){pq($dxDots,$dyDots,$dzDots);print "E\n";}
+        # At this point we can find the NEW qDots.  From them we can calculate the new INTERNAL contributions to the cartesian velocities, $intVs.  These, always in combination with $extQDots, making $Qdots are then used for then finding the contributions to the NEW pDots due to both KE and friction, done in Calc_pDots() called below.
+	
+	if ($allQs or $t<$tipReleaseEndTime or $calculateFluidDrag){Calc_Qs()}
+    
+    Calc_QDots();
+    #if (DEBUG and V_DE and $verbose>=4){pq($QDots);print "F\n";}
+    # Finds the new internal cartesian velocities and adds them to $extQDots computed above.
+
+    Calc_pDots($t);
+    #if (DEBUG and V_DE and $verbose>=4){pq($pDots);}
+}
+
+
 sub DE { use constant V_DE => 1;
     
     ### WARNING:  This function takes the radical step of altering the GLOBAL $verbose to allow inspection separately of the jacobian and stepper behavior.
@@ -2287,21 +2959,16 @@ sub DE { use constant V_DE => 1;
     my $progStr = '';
     my $dt      = undef;
     $DE_numCalls++;
-    if (V_DE and $caller eq "DEfunc_GSL"){
+    if ($caller eq "DEfunc_GSL"){
         if ($DE_numCalls != $DE_lastSteppingCall+1){
             $progStr    = ",SEQUENCE BREAK";
         }
-        $dt      = $t-$DE_lastSteppingT;
+        $dt      = DETrackSteppingCall($t);
         if($dt<0){$progStr = ",RETREATING"}
-        elsif($dt>0){
-            $DE_movingAvDt = DEAverageDt($dt);
-            if ($t>$DE_maxAttainedT){
-                $DE_maxAttainedT = $t;
-                $progStr = ",PROGRESSING";
-            }
+        elsif($dt>0 and $t>$DE_maxAttainedT){
+            $DE_maxAttainedT = $t;
+            $progStr = ",PROGRESSING";
         }
-        $DE_lastSteppingCall = $DE_numCalls;
-        $DE_lastSteppingT    = $t;
     }
 
     $tDynam = $t;
@@ -2346,55 +3013,7 @@ sub DE { use constant V_DE => 1;
         return ($dynamDots);
     }
 
-	if ($stripping < 0 and $t > $stripStartTime){
-		$stripping = 1;
-		#print("DE: ");pq($t,$stripping);
-	}
-
-	if ($stripping == 1){AdjustFirstSeg_STRIPPING($t)}
-
-=begin comment
-	
-	if ($stripping < 0 and $t > $stripStartTime){
-		$stripping = 1; print("DE: ");pq($t,$stripping)}
-    if ($stripping == 1 and $DEfunc_dotCount == 1){
-	    # Must be done before Calc_dQs(), but must not be done while any single step is being taken.  Unfortunately, the solver doesn't tell us when it starts a new step.
-		$DE_adjustCounter++;
-		if ($DE_adjustCounter >= 1){
-			$DE_adjustCounter = 0;
-        	AdjustFirstSeg_STRIPPING($t);
-		}
-        AdjustFirstSeg_STRIPPING($t);
-		#$DE_adjustCounter
-    }
-=end comment
-
-=cut
-    
-    Calc_dQs();
-    #if (V_DE and $verbose>=4){pq($lineStrains)}
-        # Could compute $Qs now, but don't need them for what we do here.
-	
-    # Set global coords and external velocities.  See Set_ps_From_qDots():
-    Calc_Driver($t);
-    # This constraint drives the whole cast. Updates the driver globals.
-    
-    #Calc_ExtQDots();
-    #if (DEBUG and V_DE and $verbose>=4){pq($extQDots);print "D\n";}
-       # The contribution to QDots from the driving motion only.  This needs only $dQs_dqs.  It is critical that we DO NOT need the internal contributions to QDots here.
-    
-    Calc_qDots();
-    #if (DEBUG and V_DE and $verbose>=4){pq($dxDots,$dyDots,$dzDots);print "E\n";}
-        # At this point we can find the NEW qDots.  From them we can calculate the new INTERNAL contributions to the cartesian velocities, $intVs.  These, always in combination with $extQDots, making $Qdots are then used for then finding the contributions to the NEW pDots due to both KE and friction, done in Calc_pDots() called below.
-	
-	if ($t<$tipReleaseEndTime or $calculateFluidDrag){Calc_Qs()}
-    
-    Calc_QDots();
-    #if (DEBUG and V_DE and $verbose>=4){pq($QDots);print "F\n";}
-    # Finds the new internal cartesian velocities and adds them to $extQDots computed above.
-
-    Calc_pDots($t);
-    #if (DEBUG and V_DE and $verbose>=4){pq($pDots);}
+    Calc_qpDots($t);
     
     $dynamDots(0:$nqs-1)        .= $qDots;
     $dynamDots($nqs:2*$nqs-1)   .= $pDots;
@@ -2444,6 +3063,172 @@ sub DE { use constant V_DE => 1;
 }                                                                            
 
 
+## The lean DE.  Everything DE() does that only matters for what gets printed (sequence-break and progress labels, verbose switching on slowing and periodic reports, driver start and stop notices, the "t=" reports) is left out, as are the temporary $verbose changes.  Chosen by the GSL wrappers whenever $verbose is below $DE_diagnosticsVerbose and switching on slowing is off.  The physics, in Calc_qpDots(), and the call time tracking, in DETrackSteppingCall(), which sets the next solver call's initial step, are shared with DE().  Set DE_LEAN to 0 to force the full path everywhere.
+use constant DE_LEAN => 1;
+my $DE_diagnosticsVerbose = 2;
+
+sub DE_UseLean {
+	return (DE_LEAN and $verbose < $DE_diagnosticsVerbose and !$switchVerbose);
+}
+
+sub DE_Lean {
+	my ($t,$caller) = @_;
+	
+	$DE_numCalls++;
+	if ($caller eq "DEfunc_GSL"){DETrackSteppingCall($t)}
+	
+	$tDynam = $t;
+	
+	# numjac keeps the returned pdls, so only the function caller may reuse the package storage:
+	my $dots = ($caller eq "DEfunc_GSL") ? $dynamDots : zeros($dynams);
+	
+	&{$runControlPtr->{callerUpdate}}();
+	if ($runControlPtr->{callerRunState} != 1) {
+		$DE_errMsg  = "User interrupt";
+		$DE_status  = 1;
+		$dots .= 0;
+		return ($dots);
+	}
+	
+	Calc_qpDots($t);
+	
+	$dots(0:$nqs-1)        .= $qDots;
+	$dots($nqs:2*$nqs-1)   .= $pDots;
+	
+	return ($dots);
+}
+
+
+
+## Energy accounting.  Calc_pDots() leaves the scalar powers of rod and line damping, fluid drag, the other applied forces (gravity, buoyancy, tip holding) and the driver in package globals.  On each function call from the stepper these are integrated by the trapezoid rule into running totals.  The stepper also evaluates trial points that it later abandons, so on a retreat the samples beyond the new time are dropped and integration resumes from the latest earlier one.  The caller reads the totals, together with the kinetic and elastic energies, at its reporting times using DE_EnergyColumns().  With all the columns in hand, KE + rodElastic + lineElastic changes by the sum of the four work totals, up to the smoothing of the line taut-slack transition and the omitted bend damping at the handle joint.
+
+my @energySamples;
+	# Each entry is [t,[cumulative works],[powers at t]].
+my @energyColumnNames = qw(KE rodElastic lineElastic rodDampingWork lineDampingWork dragWork appliedWork driverWork);
+
+sub DE_SetEnergyAccounting {
+	my ($on) = @_;
+	$energyAccounting = ($on) ? 1 : 0;
+}
+
+sub DE_SetDragMultipliers {
+	my ($mults) = @_;
+	
+	## Per-segment multipliers (rod then line, as at initialize) for the fluid drag on each segment, modelling unresolved variation in the flow, or undef for none.  Call after Init_Hamilton("initialize").  Stripping keeps the multipliers of the outboard segments.  Remesh_LINE() remaps them by arc length, so they stay with the same stretches of line.
+	
+	$init_segDragMults = (defined($mults)) ? $mults->copy : undef;
+	Init_DragMultipliers();
+}
+
+sub Init_DragMultipliers {
+	
+	if (!defined($init_segDragMults)){$segDragMults = undef; return}
+	if ($init_segDragMults->nelem < $nSegs){
+		print "WARNING: There are now more segments than drag multipliers.  Dropping the multipliers.\n";
+		$init_segDragMults = undef;
+		$segDragMults = undef;
+		return;
+	}
+	$segDragMults = $init_segDragMults(-$nSegs:-1)->copy;
+}
+
+sub DE_InitEnergyAccounting {
+	@energySamples = ();
+}
+
+sub Get_EnergyColumnNames {
+	return @energyColumnNames;
+}
+
+sub DE_AccumulateEnergy {
+	my ($t) = @_;
+	
+	my @powers = ($rodStretchDampPower+$rodBendDampPower,$lineDampPower,$dragPower,$appliedPower,$driverPower);
+	
+	if (!@energySamples){
+		@energySamples = ([$t,[map {0} @powers],\@powers]);
+		return;
+	}
+	
+	while (@energySamples > 1 and $energySamples[-1][0] > $t){pop @energySamples}
+	
+	my $last = $energySamples[-1];
+	my $dt = $t-$last->[0];
+	if ($dt <= 0){
+		# Repeated (or restarted) time.  Just refresh the powers:
+		if ($dt == 0){$last->[2] = \@powers}
+		return;
+	}
+	
+	my @cums = map {$last->[1][$_] + 0.5*($last->[2][$_]+$powers[$_])*$dt} (0..$#powers);
+	push @energySamples, [$t,\@cums,\@powers];
+}
+
+sub Get_EnergyTotalsAt {
+	my ($t) = @_;
+	
+	## Cumulative works at time $t, interpolated linearly between the bracketing samples.  Samples older than the bracketing one are discarded, so the caller must ask in increasing time order.
+	
+	if (!@energySamples){return map {0} (0..4)}
+	
+	while (@energySamples > 1 and $energySamples[1][0] <= $t){shift @energySamples}
+	
+	my $lo = $energySamples[0];
+	if (@energySamples == 1 or $t <= $lo->[0]){return @{$lo->[1]}}
+	
+	my $hi = $energySamples[1];
+	my $fract = ($t-$lo->[0])/($hi->[0]-$lo->[0]);
+	return map {$lo->[1][$_] + $fract*($hi->[1][$_]-$lo->[1][$_])} (0..$#{$lo->[1]});
+}
+
+sub Save_StrippingState {
+	
+	## Copies of everything AdjustFirstSeg_STRIPPING() and AdjustLine_CONTINUOUS_STRIPPING() change, for Restore_StrippingState().  The seg pdls are changed in place, but Calc_KE_Inverse() makes new matrices, so for those the originals are kept.
+	
+	return {
+		pdls	=> [map {(defined($_)) ? $_->copy : undef} ($segLens,$segDiams,$segMasses,$segVols,$segKs,$segCs,$outboardMassSums)],
+		kes		=> [$dMWs_dws_Tr,$fwdKE,$invKE],
+		scalars	=> [$stripping,$contStripCurrentFract,$contStripCapped]};
+}
+
+sub Restore_StrippingState {
+	my ($saved) = @_;
+	
+	my @pdls = ($segLens,$segDiams,$segMasses,$segVols,$segKs,$segCs,$outboardMassSums);
+	for (my $ii=0;$ii<@pdls;$ii++){
+		if (defined($pdls[$ii])){$pdls[$ii] .= $saved->{pdls}[$ii]}
+	}
+	($dMWs_dws_Tr,$fwdKE,$invKE) = @{$saved->{kes}};
+	($stripping,$contStripCurrentFract,$contStripCapped) = @{$saved->{scalars}};
+}
+
+
+sub DE_EnergyColumns { use constant V_DE_EnergyColumns => 0;
+	my ($t,$Dynams) = @_;
+	
+	## Returns a flat pdl of the values named by Get_EnergyColumnNames() for the state $Dynams at time $t.  The state must be on the current mesh, so call this before any restart.  It does not count as a DE call, it does not add to the running totals, and it leaves the stripping state as it found it, so reporting never changes the integration.
+	
+	my $saveVerbose = $verbose;
+	$verbose = 0;
+	
+	my $saveDynams = $dynams->copy;
+	$dynams .= $Dynams->flat;
+	
+	my $saveStripping = ($stripping) ? Save_StrippingState() : undef;
+	Calc_qpDots($t,1);
+	
+	my $KE = 0.5*($Masses*($VXs**2+$VYs**2+$VZs**2))->sumover->sclr;
+	
+	my $energies = pdl($KE,$rodElasticEnergy,$lineElasticEnergy,Get_EnergyTotalsAt($t));
+	
+	$dynams .= $saveDynams;
+	if (defined($saveStripping)){Restore_StrippingState($saveStripping)}
+	$verbose = $saveVerbose;
+	
+	if (DEBUG and V_DE_EnergyColumns and $verbose>=3){pq($t,$energies)}
+	return $energies;
+}
+
 
 sub DEfunc_GSL { use constant V_DEfunc_GSL => 1;
     my ($t,@aDynams) = @_;
@@ -2462,8 +3247,10 @@ sub DEfunc_GSL { use constant V_DEfunc_GSL => 1;
         # This pdl call isolates @aDynams from $dynams, so nothing I do will mess up the solver's data.  $dynams is a flat pdl.
     if (DEBUG and V_DEfunc_GSL and $verbose>=5){pq($t,$dynams)}
     
-    my ($dynamDots) = DE($t,"DEfunc_GSL");
+    my ($dynamDots) = (DE_UseLean()) ? DE_Lean($t,"DEfunc_GSL") : DE($t,"DEfunc_GSL");
     if (DEBUG and V_DEfunc_GSL and $verbose>=5){pq($DE_status,$dynamDots)}
+	
+	if ($energyAccounting and !$DE_status){DE_AccumulateEnergy($t)}
     
     my @aDynamDots = $dynamDots->list;
 
@@ -2487,7 +3274,7 @@ sub DEjacHelper_GSL { use constant V_DEjacHelper_GSL => 0;
     $dynams .= $timeGlueDynams(1:-1);
     
     if (V_DEjacHelper_GSL and $verbose>=3){pq($t,$dynams)}
-    my ($dynamDots) = DE($t,"DEjac_GSL");
+    my ($dynamDots) = (DE_UseLean()) ? DE_Lean($t,"DEjac_GSL") : DE($t,"DEjac_GSL");
     if (V_DEjacHelper_GSL and $verbose>=3){pq($dynamDots)}
     
     return $dynamDots;  # No first time element after init?
@@ -2498,15 +3285,31 @@ sub DEjacHelper_GSL { use constant V_DEjacHelper_GSL => 0;
 my ($JACfac,$JACythresh,$JACytyp);
 
 sub JACInit { use constant V_JACInit => 0;
+    my ($prevNumLineSegs) = @_;
+    
+    ## If $prevNumLineSegs is defined (restarting), keep the per-column difference increments numjac has adapted so far, instead of letting it start over from its default, mapping them onto the new layout if swing stripping just dropped the first line segment.  Otherwise numjac starts fresh.
     
     PrintSeparator("Initialize JAC",4);
     
+    my $prevFac         = $JACfac;
     $JACfac             = zeros(0);
     #my $ynum0           = DEjacHelper_GSL();
     my $ynum0           = 1 + 2*$nqs;
     $JACythresh         = 1e-8 * ones($ynum0);
     $JACytyp            = zeros($JACythresh);
     if (V_JACInit and $verbose>=4){pq($JACythresh,$JACytyp,$ynum0)}
+    
+    if (!defined($prevNumLineSegs) or !defined($prevFac) or $prevFac->isempty){return}
+    
+    if ($prevFac->nelem == $ynum0){
+        $JACfac = $prevFac;
+    } elsif ($mode eq "restart_swing" and $prevNumLineSegs == $numLineSegs+1
+                and $prevFac->nelem == 1+6*$prevNumLineSegs){
+        # Columns are t, then dxs, dys, dzs, dxps, dyps, dzps, each over the line segments.  Drop the first segment from each block:
+        my $keep = (sequence($numLineSegs)+1)->dummy(1,6) + $prevNumLineSegs*sequence(6)->dummy(0,$numLineSegs);
+        $JACfac = $prevFac(pdl(0)->glue(0,1+$keep->flat))->copy;
+    }
+    if (V_JACInit and $verbose>=4){pq($JACfac)}
 }
 
 
@@ -2791,7 +3594,7 @@ I believe I understand that I can use the dqs = (dxs,dys,dzs) line cartesian dyn
 
 All the exports are used only by RSwing3D.pm and RCast3D.pm.
 
-DEBUG $verbose $debugVerbose Calc_FreeSinkSpeed Init_Hamilton Get_T0 Get_dT Get_movingAvDt Get_TDynam Get_DynamsCopy Calc_Driver Calc_VerticalProfile Calc_HorizontalProfile Get_Tip0 DEfunc_GSL DEjac_GSL DEset_Dynams0Block DE_GetStatus DE_GetErrMsg DE_GetCounts JACget AdjustHeldSeg_HOLD Get_ExtraOutputs
+DEBUG $verbose $debugVerbose Calc_FreeSinkSpeed Init_Hamilton Get_T0 Get_dT Get_movingAvDt Get_stepHintDt Get_TDynam Get_DynamsCopy Calc_Driver Calc_VerticalProfile Calc_HorizontalProfile Get_Tip0 DEfunc_GSL DEjac_GSL DEset_Dynams0Block DE_GetStatus DE_GetErrMsg DE_GetCounts JACget AdjustHeldSeg_HOLD Get_ExtraOutputs Get_StripRemainingFract Remesh_LINE Calc_StaticEquilibrium DE_SetEnergyAccounting DE_SetDragMultipliers DE_EnergyColumns Get_EnergyColumnNames
 
 =head1 AUTHOR
 
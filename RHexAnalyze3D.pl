@@ -0,0 +1,488 @@
+#!/usr/bin/env perl
+
+# This shebang causes the first perl on the path to be used, which will be the perlbrew choice if using perlbrew.
+
+# RHexAnalyze3D.pl
+
+#################################################################################
+##
+## RHex - 3D dyanmic simulation of fly casting and swinging.
+## Copyright (C) 2019 Rich Miller <rich@ski.org>
+##
+## This file is part of RHex.
+##
+## RHex is free software: you can redistribute it and/or modify it under the
+## terms of the GNU General Public License as published by the Free Software
+## Foundation, either version 3 of the License, or (at your option) any later
+## version.
+##
+## RHex is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+## without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+## PURPOSE.  See the GNU General Public License for more details.
+##
+## You should have received a copy of the GNU General Public License along with RHex.
+## If not, see <https://www.gnu.org/licenses/>.
+##
+## RHex makes system calls to the Gnuplot executable, Copyright 1986 - 1993, 1998,
+## 2004 Thomas Williams, Colin Kelley.  It makes static links to the Gnu Scientific
+## Library, which is copyrighted and available under the GNU General Public License.
+## In addition, RHex incorporates code from the Perl core and numerous Perl libraries,
+## all of which are free software, redistributable and/or modifable under the same
+## terms as Perl itself (Perl License).  Finally, the modules Brent, DiffEq, and
+## Numjac in the directory RUtils are modifications and translations into Perl of
+## copyrighted material.  You can find the details in the individual files.
+##
+##################################################################################
+
+## Batch analysis of saved runs.  Walks a directory tree for the data files (.txt or .rhb) written by RHexCast3D, RHexSwing3D, RHexBatch3D or a sweep, computes a chosen set of metrics for each from its saved traces and final State and SegLengths sections, and writes them all to one tab separated summary table, one row per run.  The runs are shared out over several worker processes.  Optionally also draws a small PNG thumbnail of each run.  No Tk, and gnuplot only for the thumbnails.
+#
+# Usage: RHexAnalyze3D[.pl] runsDir summaryFile [options]
+#
+#   -metrics list
+#           Comma separated metric groups, in the order their columns should appear.  Default all of them:
+#             lineTip   lineTipMaxZ, the greatest line tip height (ft), and lineTipMaxZT, when it was reached.
+#             turnover  turnoverT, the first time the fly gets ahead of the line tip in x after having been behind it.  Casts only, NaN for swings or if it never happens.
+#             fly       flyX, flyY, flyZ, the fly position at the last reporting time (ft).
+#             tension   maxLineStrain, the greatest stretch of any line segment over its nominal length, maxLineTension (lbs), the greatest tension in the fly line proper, and maxLineTensionT, when it was reached.  See LineTension() below.
+#             run       endT, the time of the saved final State, numTimes, the number of reporting times, and stateFinite, 1 if all of the final State is finite, 0 if the integration blew up.
+#   -jobs n
+#           Worker processes.  Defaults to the number of cores.
+#   -thumbs dir
+#           Also write a PNG thumbnail of each run into dir, named after the data file's path under runsDir.
+#   -thumbTraces n
+#           Traces drawn in each thumbnail, evenly spaced in time and always including the last.  Default 12.
+#   -thumbSize WxH
+#           Thumbnail size in pixels.  Default 320x320.
+#   -terminal name
+#           gnuplot terminal for the thumbnails.  Default pngcairo.  Use png if your gnuplot was built without cairo.
+#   -gnuplot path
+#           The gnuplot to run.  Default gnuplot on the path.
+#   -verbose n
+#
+# Relative file names are taken relative to the directory the command was issued from.  Stream files (_stream.txt) and anything else that is not a saved run are passed over.  Runs that can't be loaded get a row with status unreadable and empty metrics.
+#
+# Exit codes:  0 all runs analyzed, 1 bad usage or no runs found, 2 some runs could not be analyzed or thumbnailed.
+
+use warnings;
+use strict;
+
+our $VERSION='0.01';
+
+our $OS;
+our ($exeName,$exeDir,$basename,$suffix);
+our $launchDir;
+use File::Basename;
+use Cwd;
+
+BEGIN {
+	$exeName = $0;
+
+	($basename,$exeDir,$suffix) = fileparse($exeName,'.pl');
+
+	$launchDir = getcwd();
+	chdir "$exeDir";  # See perldoc -f chdir.
+
+	chomp($OS = `echo $^O`);
+}
+
+use lib ($exeDir);
+
+use Carp;
+use Getopt::Long;
+use POSIX ();
+use Time::HiRes qw (time);
+use File::Find;
+use File::Path qw (make_path);
+use File::Spec::Functions qw ( rel2abs abs2rel );
+use File::Temp qw (tempdir);
+use Scalar::Util qw (looks_like_number);
+
+use PDL;
+use PDL::NiceSlice;
+
+use RCommon qw ($verbose $nan $pi $feetToCms $rSwingOutFileTag $rCastOutFileTag);
+use RCommonPlot3D qw ($headless RCommonLoad3D TurnoverTime);
+use RCommonSweep qw (NumCores);
+
+
+my $usage = "\n$0: Usage:RHexAnalyze3D[.pl] runsDir summaryFile [-metrics list] [-jobs n] [-thumbs dir] [-thumbTraces n] [-thumbSize WxH] [-terminal name] [-gnuplot path] [-verbose n]\n";
+
+my %opts;
+if (!GetOptions(\%opts,'metrics=s','jobs=i','thumbs=s','thumbTraces=i','thumbSize=s','terminal=s','gnuplot=s','verbose=i')
+		or @ARGV != 2){
+	print STDERR $usage;
+	exit 1;
+}
+
+my ($runsDir,$summaryFile) = map {rel2abs($_,$launchDir)} @ARGV;
+my $numJobs		= $opts{jobs} || NumCores();
+my $thumbDir	= (defined($opts{thumbs})) ? rel2abs($opts{thumbs},$launchDir) : '';
+my $thumbTraces	= $opts{thumbTraces} || 12;
+my $terminal	= $opts{terminal} || 'pngcairo';
+my $gnuplotExe	= $opts{gnuplot} || 'gnuplot';
+$verbose		= (defined($opts{verbose})) ? $opts{verbose} : 1;
+
+my ($thumbWidth,$thumbHeight) = (320,320);
+if (defined($opts{thumbSize})){
+	if ($opts{thumbSize} !~ /^(\d+)x(\d+)$/){print STDERR "ERROR: -thumbSize must be WxH, as 320x320.\n"; exit 1}
+	($thumbWidth,$thumbHeight) = ($1,$2);
+}
+if ($numJobs < 1 or $thumbTraces < 1){print STDERR "ERROR: -jobs and -thumbTraces must be positive.\n"; exit 1}
+if (!-d $runsDir){print STDERR "ERROR: $runsDir is not a directory.\n"; exit 1}
+
+$headless = 1;
+
+
+## The metrics.  Each group names its columns and has a sub that takes the loaded run, with its traces already in feet, and returns the column values in order.
+
+my %metrics = (
+	lineTip		=> {columns=>[qw(lineTipMaxZ lineTipMaxZT)],							calc=>\&LineTipMetrics},
+	turnover	=> {columns=>[qw(turnoverT)],											calc=>\&TurnoverMetrics},
+	fly			=> {columns=>[qw(flyX flyY flyZ)],										calc=>\&FlyMetrics},
+	tension		=> {columns=>[qw(maxLineStrain maxLineTension maxLineTensionT)],		calc=>\&TensionMetrics},
+	run			=> {columns=>[qw(endT numTimes stateFinite)],							calc=>\&RunMetrics},
+);
+my @allMetrics = qw(lineTip turnover fly tension run);
+
+my @metricNames = (defined($opts{metrics})) ? split(/\s*,\s*/,$opts{metrics}) : @allMetrics;
+foreach my $name (@metricNames){
+	if (!exists($metrics{$name})){print STDERR "ERROR: Unknown metric $name.  Choose from ".join(',',@allMetrics).".\n"; exit 1}
+}
+my @columns = map {@{$metrics{$_}{columns}}} @metricNames;
+
+
+sub LineTipMetrics {
+	my ($run) = @_;
+
+	my $zs		= $run->{LineTipZs};
+	my $iMax	= $zs->maximum_ind->sclr;
+	return ($zs->at($iMax),$run->{PlotTs}->at($iMax));
+}
+
+sub IsCast {
+	my ($run) = @_;
+
+	## Casts saved before they had their own tag were written with the swing one, but their run identifier still says which they are.
+	return ($run->{Tag} eq $rCastOutFileTag or $run->{RunIdentifier} =~ /^RCast\b/) ? 1 : 0;
+}
+
+sub TurnoverMetrics {
+	my ($run) = @_;
+
+	if (!IsCast($run)){return ('NaN')}
+	my $Xs = $run->{Xs};
+	return (TurnoverTime($run->{PlotTs},$run->{LineTipXs},$Xs(-1,:)->flat));
+}
+
+sub FlyMetrics {
+	my ($run) = @_;
+
+	return map {$_(-1,-1)->sclr} @{$run}{qw(Xs Ys Zs)};
+}
+
+sub LineStiffness {
+	my ($paramsStr) = @_;
+
+	## From the LINE part of the params string, the core's stretch stiffness (lbs per unit strain) and the fly line's length (ft), or an empty list if they can't be found.
+	my ($lineStr) = ($paramsStr =~ /LINE:([^\n]*)/);
+	if (!defined($lineStr)){return ()}
+	my ($coreDiamIn)	= ($lineStr =~ /CoreDiam=\(\s*[^,]*,\s*[^,]*,\s*([^)\s]*)\s*\)/);
+	my ($lenFt)			= ($lineStr =~ /Len==\s*([^;\s]*)/);
+	my ($modulusPSI)	= ($lineStr =~ /Mods\(elastic,damping\)=\(\s*([^,\s]*)/);
+	foreach my $val ($coreDiamIn,$lenFt,$modulusPSI){
+		if (!defined($val) or !looks_like_number($val)){return ()}
+	}
+	return ($modulusPSI*($pi/4)*$coreDiamIn**2,$lenFt);
+}
+
+sub TensionMetrics {
+	my ($run) = @_;
+
+	## Tension is not saved, so it is found again from the stretch of the line segments between the saved node positions, against the nominal SegLengths, by Hooke's law on the level core, as the integrators do.  Only the fly line proper is priced.  The leader and tippet stretch counts in maxLineStrain, but their moduli are not in the params string.  Swings that stripped or remeshed the line no longer match their final SegLengths, and get NaN.
+	my @nans = ('NaN','NaN','NaN');
+
+	my ($Xs,$Ys,$Zs) = @{$run}{qw(Xs Ys Zs)};
+	my $numNodes	= $Xs->dim(0);
+	my $iTip		= ($run->{NumRodNodes} < 1) ? 0 : $run->{NumRodNodes}-1;
+	my $numSegs		= $numNodes-1-$iTip;
+	my $segLens		= $run->{SegLengths};
+	if ($numSegs < 1 or !defined($segLens) or $segLens->nelem < $numSegs){return @nans}
+	$segLens		= $segLens->flat;
+	my $nomLens		= $segLens(-$numSegs:-1)/$feetToCms;
+
+	my $lens = sqrt(
+		($Xs($iTip+1:-1,:)-$Xs($iTip:-2,:))**2 +
+		($Ys($iTip+1:-1,:)-$Ys($iTip:-2,:))**2 +
+		($Zs($iTip+1:-1,:)-$Zs($iTip:-2,:))**2);
+		# Dims (numSegs,numTimes).
+	my $strains = $lens/$nomLens->dummy(1) - 1;
+	my $maxStrain = $strains->flat->maximum->sclr;
+
+	my ($stiffness,$lineLenFt) = LineStiffness($run->{ParamsString});
+	if (!defined($stiffness)){return ($maxStrain,'NaN','NaN')}
+
+	# Segments that start within the fly line.  The line can't push, so compression is no tension:
+	my $inboardLocs	= cumusumover($nomLens) - $nomLens;
+	my $iLine		= which($inboardLocs < $lineLenFt);
+	if ($iLine->isempty){return ($maxStrain,'NaN','NaN')}
+	my $maxStrains	= $strains($iLine,:)->maximum;
+		# The greatest fly line strain at each time.
+	my $iMax		= $maxStrains->maximum_ind->sclr;
+	my $tension		= ($maxStrains->at($iMax) > 0) ? $stiffness*$maxStrains->at($iMax) : 0;
+	return ($maxStrain,$tension,$run->{PlotTs}->at($iMax));
+}
+
+sub RunMetrics {
+	my ($run) = @_;
+
+	my $state		= $run->{State};
+	my $endT		= (defined($run->{Time}) and !$run->{Time}->isempty) ? $run->{Time}->flat->at(0) : 'NaN';
+	my $finite		= (defined($state) and !$state->isempty) ? (($state->isfinite->all) ? 1 : 0) : 'NaN';
+	return ($endT,$run->{PlotTs}->nelem,$finite);
+}
+
+
+## The runs.
+
+sub IsSavedRun {
+	my ($filename) = @_;
+
+	## By the first line, so stream files and unrelated .txt files are passed over without loading.
+	my $fh;
+	if (!open($fh,'<',$filename)){return 0}
+	my $firstLine = <$fh>;
+	close $fh;
+	if (!defined($firstLine)){return 0}
+	if ($filename =~ /\.rhb$/){return ($firstLine =~ /^RHexBinary\t/) ? 1 : 0}
+	return ($firstLine =~ /^(\Q$rSwingOutFileTag\E|\Q$rCastOutFileTag\E)/ and $firstLine !~ /\tstream/) ? 1 : 0;
+}
+
+my @runFiles;
+find({wanted=>sub {if (-f $_ and /\.(txt|rhb)$/ and IsSavedRun($_)){push @runFiles,$File::Find::name}},no_chdir=>1},$runsDir);
+@runFiles = sort @runFiles;
+if (!@runFiles){print STDERR "ERROR: No saved runs found under $runsDir.\n"; exit 1}
+if ($numJobs > @runFiles){$numJobs = scalar(@runFiles)}
+
+sub RelName {
+	my ($filename) = @_;
+	my $rel = abs2rel($filename,$runsDir);
+	$rel =~ s/\t/ /g;
+	return $rel;
+}
+
+sub Fmt {
+	my ($val) = @_;
+	return (looks_like_number($val) and $val !~ /^[+-]?(nan|inf)/i) ? sprintf("%.6g",$val) : 'NaN';
+}
+
+
+## Thumbnails.  All the thumbnails of one worker are drawn by a single gnuplot run at the end.
+
+sub ThumbRows {
+	my ($run,$traceIndices,$i0,$i1,$rgbs) = @_;
+
+	## (x,y,z,rgb) double rows for nodes $i0 to $i1 of each chosen trace, each followed by a nan row.
+	my $num		= $traceIndices->nelem;
+	my $gaps	= $nan*ones(1,$num);
+	my $rows	= cat(map {$_($i0:$i1,$traceIndices)->glue(0,$gaps)} @{$run}{qw(Xs Ys Zs)})
+					->glue(2,$rgbs->dummy(0,$i1-$i0+2)->dummy(2))->reorder(2,0,1)->double->copy;
+	return ${$rows->get_dataref};
+}
+
+sub WriteRaw {
+	my ($filename,$bytes) = @_;
+	open(my $fh,'>:raw',$filename) or die "ERROR: Cannot write $filename ($!).\nStopped";
+	print $fh $bytes;
+	close $fh;
+}
+
+sub ThumbScript {
+	my ($run,$relName,$base) = @_;
+
+	## Writes the thumbnail's data, and returns the gnuplot commands that draw it.
+	my ($numNodes,$numTimes) = $run->{Xs}->dims;
+	my $numRodNodes	= ($run->{NumRodNodes} < 1) ? 1 : $run->{NumRodNodes};
+	my $num			= ($thumbTraces > $numTimes) ? $numTimes : $thumbTraces;
+	my $traceIndices = ($num > 1) ? long(floor(sequence($num)*($numTimes-1)/($num-1)+0.5)) : long([$numTimes-1]);
+
+	# Green at the start of the run to red at its end, as in the plot windows:
+	my $fracts	= ($numTimes > 1) ? $traceIndices->double/($numTimes-1) : zeros(1);
+	my $rgbs	= floor(255*$fracts)*65536 + floor(255*(1-$fracts))*256;
+
+	my $spec	= "binary format='%4double' using 1:2:3:4";
+	WriteRaw("${base}_rod.bin",ThumbRows($run,$traceIndices,0,$numRodNodes-1,$rgbs));
+	my @plots = ("'${base}_rod.bin' $spec with lines linecolor rgb variable linewidth 2");
+	if ($numRodNodes < $numNodes){
+		WriteRaw("${base}_line.bin",ThumbRows($run,$traceIndices,$numRodNodes-1,$numNodes-1,$rgbs));	# Sic, line starts at rod tip.
+		push @plots,"'${base}_line.bin' $spec with lines linecolor rgb variable dashtype 2";
+	}
+
+	my $pngName = $relName;
+	$pngName =~ s/\.(txt|rhb)$//;
+	$pngName =~ s/[\/\\]/__/g;
+	$pngName =~ s/'/_/g;
+	my $title = $relName;
+	$title =~ s/["\n]/ /g;
+
+	return "set output '$thumbDir/$pngName.png'\n".
+		"set title \"$title\" noenhanced\n".
+		"splot ".join(", ",@plots)."\n".
+		"unset output\n";
+}
+
+
+## The work.
+
+sub AnalyzeRuns {
+	my ($iJob,$workDir) = @_;
+
+	## Analyzes this job's share of the runs, every numJobs-th starting at $iJob, and writes index, status and values lines to a part file.  Returns 1 if all went well.
+	my $ok = 1;
+	my $script = '';
+	my $numThumbs = 0;
+
+	open(my $partFh,'>',"$workDir/part.tsv") or die "ERROR: Cannot write $workDir/part.tsv ($!).\nStopped";
+	for (my $ii=$iJob;$ii<@runFiles;$ii+=$numJobs){
+		my $relName	= RelName($runFiles[$ii]);
+		my $run		= RCommonLoad3D($runFiles[$ii]);
+		my @vals;
+		if (defined($run)){
+			@vals = eval {
+				# Work in feet, as the plot windows do:
+				@{$run}{qw(Xs Ys Zs)} = map {$run->{$_}/$feetToCms} qw(PlotXs PlotYs PlotZs);
+				$run->{LineTipXs} = $run->{PlotXLineTips}->flat/$feetToCms;
+				$run->{LineTipZs} = $run->{PlotZLineTips}->flat/$feetToCms;
+				map {&{$metrics{$_}{calc}}($run)} @metricNames;
+			};
+			if ($@){print STDERR "ERROR: Analysis of $relName failed:\n$@"; $run = undef}
+		}
+		if (!defined($run)){
+			$ok = 0;
+			print $partFh join("\t",$ii,$relName,'unreadable','',map {''} @columns)."\n";
+			next;
+		}
+
+		my $runType = (IsCast($run)) ? 'cast' : 'swing';
+		print $partFh join("\t",$ii,$relName,'ok',$runType,map {Fmt($_)} @vals)."\n";
+
+		if ($thumbDir){
+			$script .= ThumbScript($run,$relName,sprintf("$workDir/t%05d",$ii));
+			$numThumbs++;
+		}
+		if ($verbose>=2){print "Analyzed $relName\n"}
+	}
+	close $partFh;
+
+	if ($numThumbs){
+		WriteRaw("$workDir/thumbs.gp",
+			"set terminal $terminal size $thumbWidth,$thumbHeight\n".
+			"set view equal xyz\n".
+			"set key off\n".
+			"unset xtics; unset ytics; unset ztics\n".
+			$script);
+		if (system($gnuplotExe,"$workDir/thumbs.gp")){print STDERR "ERROR: gnuplot failed drawing thumbnails.\n"; $ok = 0}
+	}
+
+	return $ok;
+}
+
+
+if ($thumbDir and !-d $thumbDir and !make_path($thumbDir)){die "ERROR: Cannot make $thumbDir.\nStopped"}
+my $dataDir = tempdir(CLEANUP => 1);
+
+if ($verbose>=1){printf("Analyzing %d runs under $runsDir in %d processes.\n",scalar(@runFiles),$numJobs)}
+my $timeStart = time();
+
+my %workers;
+for (my $iJob=0;$iJob<$numJobs;$iJob++){
+	my $workDir = "$dataDir/job$iJob";
+	make_path($workDir);
+
+	my $pid = fork();
+	if (!defined($pid)){die "ERROR: Cannot fork ($!).\nStopped"}
+	if (!$pid){
+		my $ok = eval {AnalyzeRuns($iJob,$workDir)};
+		if (!defined($ok)){print STDERR $@; $ok = 0}
+		POSIX::_exit(($ok) ? 0 : 1);	# Skip the parent's temp directory cleanup.
+	}
+	$workers{$pid} = $iJob;
+}
+
+my $numFailed = 0;
+while (%workers){
+	my $pid = wait();
+	if ($pid < 0){last}
+	delete $workers{$pid};
+	if ($?){$numFailed++}
+}
+
+# Merge the parts back into the order of the file list:
+my @lines;
+for (my $iJob=0;$iJob<$numJobs;$iJob++){
+	my $partFh;
+	if (!open($partFh,'<',"$dataDir/job$iJob/part.tsv")){$numFailed++; next}
+	while (my $line = <$partFh>){
+		my ($ii,$rest) = split(/\t/,$line,2);
+		$lines[$ii] = $rest;
+	}
+	close $partFh;
+}
+
+my $numAnalyzed = 0;
+open(my $summaryFh,'>',$summaryFile) or die "ERROR: Cannot write $summaryFile ($!).\nStopped";
+print $summaryFh join("\t",'file','status','runType',@columns)."\n";
+for (my $ii=0;$ii<@runFiles;$ii++){
+	if (defined($lines[$ii])){
+		print $summaryFh $lines[$ii];
+		if ($lines[$ii] =~ /^[^\t]*\tok\t/){$numAnalyzed++}
+	} else {
+		print $summaryFh join("\t",RelName($runFiles[$ii]),'lost','',map {''} @columns)."\n";
+	}
+}
+close $summaryFh;
+
+if ($verbose>=1){printf("Wrote %d of %d runs to $summaryFile in %.1f secs.\n",$numAnalyzed,scalar(@runFiles),time()-$timeStart)}
+
+exit (($numFailed or $numAnalyzed < @runFiles) ? 2 : 0);
+
+
+__END__
+
+=head1 NAME
+
+RHexAnalyze3D - Compute metrics, and optionally thumbnails, for every saved RHex run under a directory, in parallel, into one summary table.
+
+=head1 SYNOPSIS
+
+  perl RHexAnalyze3D.pl sweeps/cast1 sweeps/cast1/metrics.tsv -metrics lineTip,turnover,tension -thumbs sweeps/cast1/thumbs
+
+=head1 DESCRIPTION
+
+See the comments at the top of this file for the metrics, the options and the exit codes.
+
+=head1 AUTHOR
+
+Rich Miller, E<lt>rich@ski.orgE<gt>
+
+=head1 COPYRIGHT AND LICENSE
+
+RHex - 3D dyanmic simulation of fly casting and swinging.
+
+Copyright (C) 2019 Rich Miller
+
+This file is part of RHex.
+
+RHex is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RHex is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RHex.  If not, see <https://www.gnu.org/licenses/>.
+
+=cut
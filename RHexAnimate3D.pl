@@ -0,0 +1,362 @@
+#!/usr/bin/env perl
+
+# This shebang causes the first perl on the path to be used, which will be the perlbrew choice if using perlbrew.
+
+# RHexAnimate3D.pl
+
+#################################################################################
+##
+## RHex - 3D dyanmic simulation of fly casting and swinging.
+## Copyright (C) 2019 Rich Miller <rich@ski.org>
+##
+## This file is part of RHex.
+##
+## RHex is free software: you can redistribute it and/or modify it under the
+## terms of the GNU General Public License as published by the Free Software
+## Foundation, either version 3 of the License, or (at your option) any later
+## version.
+##
+## RHex is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+## without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+## PURPOSE.  See the GNU General Public License for more details.
+##
+## You should have received a copy of the GNU General Public License along with RHex.
+## If not, see <https://www.gnu.org/licenses/>.
+##
+## RHex makes system calls to the Gnuplot executable, Copyright 1986 - 1993, 1998,
+## 2004 Thomas Williams, Colin Kelley.  It makes static links to the Gnu Scientific
+## Library, which is copyrighted and available under the GNU General Public License.
+## In addition, RHex incorporates code from the Perl core and numerous Perl libraries,
+## all of which are free software, redistributable and/or modifable under the same
+## terms as Perl itself (Perl License).  Finally, the modules Brent, DiffEq, and
+## Numjac in the directory RUtils are modifications and translations into Perl of
+## copyrighted material.  You can find the details in the individual files.
+##
+##################################################################################
+
+
+## Animation export.  Renders the traces of a saved run (.txt or .rhb, from RHexCast3D, RHexSwing3D or RHexBatch3D) to numbered PNG frames, one per reporting time or every k-th, all seen from the same fixed camera.  The frames are split into contiguous blocks, and each block is drawn by its own worker process running one gnuplot with the pngcairo terminal, so the work spreads over the cores.  Needs gnuplot, but no display.  If ffmpeg is on the path, the frames can also be assembled into a video.
+#
+# Usage: RHexAnimate3D[.pl] dataFile outDir [options]
+#
+#   -every k
+#           Render every k-th reporting time.  Default 1.
+#   -trail n
+#           Also draw the n traces before the current one, each in its own color, so the motion leaves a wake.  Default 0.
+#   -jobs n
+#           Worker processes.  Defaults to the number of cores.
+#   -size WxH
+#           Frame size in pixels.  Default 900x900, square like the plot windows, since non-square distorts the range box.
+#   -view rotX,rotZ
+#           gnuplot view angles in degrees.  Default 60,30, gnuplot's own.
+#   -zScale z
+#           Vertical magnification, as in the plot windows.  Default 1.
+#   -terminal name
+#           gnuplot terminal.  Default pngcairo.  Use png if your gnuplot was built without cairo.
+#   -gnuplot path
+#           The gnuplot to run.  Default gnuplot on the path.
+#   -video file
+#           Assemble the frames into this video file with ffmpeg.  Skipped, with the command to use printed, if ffmpeg can't be found.
+#   -fps n
+#           Video frame rate.  Default 30.
+#   -verbose n
+#
+# Relative file names are taken relative to the directory the command was issued from.  outDir gets frame_00000.png, frame_00001.png, ... numbered consecutively.
+#
+# Exit codes:  0 all frames written, 1 bad usage or data file, 2 some frames failed.
+
+use warnings;
+use strict;
+
+our $VERSION='0.01';
+
+our $OS;
+our ($exeName,$exeDir,$basename,$suffix);
+our $launchDir;
+use File::Basename;
+use Cwd;
+
+BEGIN {
+	$exeName = $0;
+
+	($basename,$exeDir,$suffix) = fileparse($exeName,'.pl');
+
+	$launchDir = getcwd();
+	chdir "$exeDir";  # See perldoc -f chdir.
+
+	chomp($OS = `echo $^O`);
+}
+
+use lib ($exeDir);
+
+use Carp;
+use Getopt::Long;
+use POSIX ();
+use Time::HiRes qw (time);
+use File::Path qw (make_path);
+use File::Spec;
+use File::Spec::Functions qw ( rel2abs );
+use File::Temp qw (tempdir);
+
+use PDL;
+use PDL::NiceSlice;
+
+use RCommon qw ($verbose $nan $feetToCms);
+use RCommonPlot3D qw ($headless RCommonLoad3D);
+use RCommonSweep qw (NumCores);
+
+
+my $usage = "\n$0: Usage:RHexAnimate3D[.pl] dataFile outDir [-every k] [-trail n] [-jobs n] [-size WxH] [-view rotX,rotZ] [-zScale z] [-terminal name] [-gnuplot path] [-video file] [-fps n] [-verbose n]\n";
+
+my %opts;
+if (!GetOptions(\%opts,'every=i','trail=i','jobs=i','size=s','view=s','zScale=f','terminal=s','gnuplot=s','video=s','fps=f','verbose=i')
+		or @ARGV != 2){
+	print STDERR $usage;
+	exit 1;
+}
+
+my ($dataFile,$outDir) = map {rel2abs($_,$launchDir)} @ARGV;
+my $every		= $opts{every} || 1;
+my $trail		= $opts{trail} || 0;
+my $numJobs		= $opts{jobs} || NumCores();
+my $zScale		= $opts{zScale} || 1;
+my $terminal	= $opts{terminal} || 'pngcairo';
+my $gnuplotExe	= $opts{gnuplot} || 'gnuplot';
+my $fps			= $opts{fps} || 30;
+$verbose		= (defined($opts{verbose})) ? $opts{verbose} : 1;
+
+my ($width,$height) = (900,900);
+if (defined($opts{size})){
+	if ($opts{size} !~ /^(\d+)x(\d+)$/){print STDERR "ERROR: -size must be WxH, as 900x900.\n"; exit 1}
+	($width,$height) = ($1,$2);
+}
+my ($rotX,$rotZ) = (60,30);
+if (defined($opts{view})){
+	if ($opts{view} !~ /^\s*([-+\d.eE]+)\s*,\s*([-+\d.eE]+)\s*$/){print STDERR "ERROR: -view must be rotX,rotZ, as 60,30.\n"; exit 1}
+	($rotX,$rotZ) = ($1,$2);
+}
+if ($every < 1 or $trail < 0 or $numJobs < 1 or $zScale <= 0 or $fps <= 0){print STDERR "ERROR: -every, -jobs, -zScale and -fps must be positive, -trail non-negative.\n"; exit 1}
+if (defined($opts{video})){$opts{video} = rel2abs($opts{video},$launchDir)}
+
+$headless = 1;
+
+
+my $run = RCommonLoad3D($dataFile);
+if (!defined($run)){exit 1}
+
+# Work in feet, as the plot windows do:
+my ($Ts,$Xs,$Ys,$Zs) = map {$run->{$_}} qw(PlotTs PlotXs PlotYs PlotZs);
+($Xs,$Ys,$Zs) = map {$_/$feetToCms} ($Xs,$Ys,$Zs);
+my $plotBottom	= $run->{PlotBottom}/$feetToCms;
+my $numRodNodes	= ($run->{NumRodNodes} < 1) ? 1 : $run->{NumRodNodes};
+my ($numNodes,$numTimes) = $Xs->dims;
+my $showLine	= ($numRodNodes < $numNodes) ? 1 : 0;
+
+my $frameIndices = sequence(long,POSIX::floor(($numTimes-1)/$every)+1)*$every;
+my $numFrames	= $frameIndices->nelem;
+if ($numJobs > $numFrames){$numJobs = $numFrames}
+
+# Colors run from green at the start of the run to red at its end, as in the plot windows:
+my $fracts	= ($numTimes > 1) ? sequence($numTimes)/($numTimes-1) : zeros(1);
+my $rgbs	= floor(255*$fracts)*65536 + floor(255*(1-$fracts))*256;
+
+
+## The fixed camera.  The same plot box and view for every frame, found as RCommonPlot3D() finds them, but over the whole run.
+
+sub FiniteRange {
+	my ($vals) = @_;
+	$vals = $vals->where($vals->isfinite);
+	return ($vals->isempty) ? (0,0) : ($vals->min,$vals->max);
+}
+
+my ($xMin,$xMax) = FiniteRange($Xs);
+my ($yMin,$yMax) = FiniteRange($Ys);
+my ($zMin,$zMax) = FiniteRange($Zs);
+
+my ($cx,$cy,$cz) = (($xMin+$xMax)/2,($yMin+$yMax)/2,($zMin+$zMax)/2);
+my ($dx,$dy,$dz) = ($xMax-$xMin,$yMax-$yMin,$zMax-$zMin);
+my $range	= ($dy>$dx)?$dy:$dx;
+$range		= ($range>$dz)?$range:$dz;
+if ($range <= 0){$range = 1}
+
+my @xRange	= ($cx-$range/2,$cx+$range/2);
+my @yRange	= ($cy-$range/2,$cy+$range/2);
+my @zRange	= ($numRodNodes == 1) ? ($cz-abs($plotBottom),$cz+abs($plotBottom)) : ($cz-$dz/2,$cz+$dz/2);
+if ($zRange[1] <= $zRange[0]){@zRange = ($cz-$range/2,$cz+$range/2)}
+my $zMag	= $zScale*($zRange[1]-$zRange[0])/$range;
+my $xyplane	= ($numRodNodes == 1) ? $plotBottom : $zMin;
+
+my $titleBase = "$run->{RunIdentifier}";
+$titleBase =~ s/["\t\n]/ /g;
+
+my $setup = join("\n",
+	"set terminal $terminal size $width,$height",
+	"set xlabel 'X (ft)'; set ylabel 'Y (ft)'; set zlabel 'Z (ft)'",
+	"set xrange [$xRange[0]:$xRange[1]]; set yrange [$yRange[0]:$yRange[1]]; set zrange [$zRange[0]:$zRange[1]]",
+	"set view $rotX,$rotZ,1.25,$zMag",
+	"set xyplane at $xyplane",
+	"set key off",
+	'');
+
+
+sub PackPolylines {
+	my ($traceIndices,$i0,$i1) = @_;
+
+	## (x,y,z,rgb) double rows for nodes $i0 to $i1 of each trace, each followed by a nan row.
+
+	my $num		= $traceIndices->nelem;
+	my $gaps	= $nan*ones(1,$num);
+	my $rows	= cat(map {$_($i0:$i1,$traceIndices)->glue(0,$gaps)} ($Xs,$Ys,$Zs))
+					->glue(2,$rgbs($traceIndices)->dummy(0,$i1-$i0+2)->dummy(2))->reorder(2,0,1)->double->copy;
+	return ${$rows->get_dataref};
+}
+
+sub WriteRaw {
+	my ($filename,$bytes) = @_;
+	open(my $fh,'>:raw',$filename) or die "ERROR: Cannot write $filename ($!).\nStopped";
+	print $fh $bytes;
+	close $fh;
+}
+
+sub RenderFrames {
+	my ($iFirst,$iLast,$workDir) = @_;
+
+	## Writes the data and a gnuplot script for frames $iFirst to $iLast, and runs gnuplot on it.  Returns gnuplot's exit status.
+
+	my $spec	= "binary format='%4double' using 1:2:3:4";
+	my $script	= $setup;
+
+	for (my $iFrame=$iFirst;$iFrame<=$iLast;$iFrame++){
+		my $iTrace	= $frameIndices($iFrame)->sclr;
+		my $iStart	= $iFrame-$trail;
+		if ($iStart < 0){$iStart = 0}
+		my $traces	= $frameIndices($iStart:$iFrame);
+		my $base	= sprintf("$workDir/d%05d",$iFrame);
+
+		WriteRaw("${base}_rod.bin",PackPolylines($traces,0,$numRodNodes-1));
+		my @plots = ("'${base}_rod.bin' $spec with lines linecolor rgb variable linewidth 2");
+		if ($showLine){
+			WriteRaw("${base}_line.bin",PackPolylines($traces,$numRodNodes-1,$numNodes-1));	# Sic, line starts at rod tip.
+			push @plots,"'${base}_line.bin' $spec with lines linecolor rgb variable dashtype 2";
+		}
+		WriteRaw("${base}_fly.bin",PackPolylines(long([$iTrace]),$numNodes-1,$numNodes-1));
+		push @plots,"'${base}_fly.bin' $spec with points pointtype 7 linecolor rgb variable";
+
+		$script .= sprintf("set output '%s/frame_%05d.png'\n",$outDir,$iFrame);
+		$script .= sprintf("set title \"%s -- t=%.3f\"\n",$titleBase,$Ts($iTrace)->sclr);
+		$script .= "splot ".join(", ",@plots)."\n";
+		$script .= "unset output\n";
+	}
+
+	my $scriptFile = "$workDir/frames.gp";
+	WriteRaw($scriptFile,$script);
+	return system($gnuplotExe,$scriptFile);
+}
+
+
+if (!-d $outDir and !make_path($outDir)){die "ERROR: Cannot make $outDir.\nStopped"}
+my $dataDir = tempdir(CLEANUP => 1);
+
+if ($verbose>=1){print "Rendering $numFrames frames of $dataFile in $numJobs processes.\n"}
+my $timeStart = time();
+
+# Contiguous blocks, so each worker's gnuplot draws its frames in order:
+my %workers;
+for (my $iJob=0;$iJob<$numJobs;$iJob++){
+	my $iFirst	= POSIX::floor($iJob*$numFrames/$numJobs);
+	my $iLast	= POSIX::floor(($iJob+1)*$numFrames/$numJobs)-1;
+	if ($iLast < $iFirst){next}
+
+	my $workDir = "$dataDir/job$iJob";
+	make_path($workDir);
+
+	my $pid = fork();
+	if (!defined($pid)){die "ERROR: Cannot fork ($!).\nStopped"}
+	if (!$pid){
+		my $status = eval {RenderFrames($iFirst,$iLast,$workDir)};
+		if (!defined($status)){print STDERR $@; $status = 1}
+		POSIX::_exit(($status) ? 1 : 0);	# Skip the parent's temp directory cleanup.
+	}
+	$workers{$pid} = [$iFirst,$iLast];
+}
+
+my $numFailed = 0;
+while (%workers){
+	my $pid = wait();
+	if ($pid < 0){last}
+	my ($iFirst,$iLast) = @{delete $workers{$pid}};
+	if ($?){
+		$numFailed += $iLast-$iFirst+1;
+		print STDERR "ERROR: gnuplot failed on frames $iFirst to $iLast.\n";
+	}
+}
+
+if ($verbose>=1){printf("Wrote %d frames to $outDir in %.1f secs.\n",$numFrames-$numFailed,time()-$timeStart)}
+
+
+sub FindOnPath {
+	my ($name) = @_;
+	foreach my $dir (File::Spec->path()){
+		foreach my $candidate ("$dir/$name","$dir/$name.exe"){
+			if (-f $candidate and -x $candidate){return $candidate}
+		}
+	}
+	return '';
+}
+
+if (defined($opts{video}) and !$numFailed){
+	my @ffmpegArgs = ('-y','-loglevel','error','-framerate',$fps,'-i',"$outDir/frame_%05d.png",'-pix_fmt','yuv420p',$opts{video});
+	my $ffmpeg = FindOnPath('ffmpeg');
+	if (!$ffmpeg){
+		print "WARNING: ffmpeg not found.  To make the video yourself:\n  ffmpeg ".join(' ',map {"'$_'"} @ffmpegArgs)."\n";
+	} elsif (system($ffmpeg,@ffmpegArgs)){
+		print STDERR "ERROR: ffmpeg failed to make $opts{video}.\n";
+		exit 2;
+	} elsif ($verbose>=1){
+		print "Wrote $opts{video}\n";
+	}
+}
+
+exit (($numFailed) ? 2 : 0);
+
+
+__END__
+
+=head1 NAME
+
+RHexAnimate3D - Render the traces of a saved RHex run to PNG frames, in parallel, for an animation.
+
+=head1 SYNOPSIS
+
+  perl RHexAnimate3D.pl _RUN_cast.rhb frames -every 2 -trail 5 -video cast.mp4
+
+=head1 DESCRIPTION
+
+Loads a run saved as text or binary by RHexCast3D, RHexSwing3D or RHexBatch3D, and draws each reporting time, or every k-th, as a PNG frame from one fixed camera.  The frames are shared out among worker processes, each running its own gnuplot.  Works with no display.  If ffmpeg is available, the frames can be assembled into a video.
+
+=head1 AUTHOR
+
+Rich Miller, E<lt>rich@ski.orgE<gt>
+
+=head1 COPYRIGHT AND LICENSE
+
+RHex - 3D dyanmic simulation of fly casting and swinging.
+
+Copyright (C) 2019 Rich Miller
+
+This file is part of RHex.
+
+RHex is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RHex is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RHex.  If not, see <https://www.gnu.org/licenses/>.
+
+=cut
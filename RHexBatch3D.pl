@@ -0,0 +1,319 @@
+#!/usr/bin/env perl
+
+# This shebang causes the first perl on the path to be used, which will be the perlbrew choice if using perlbrew.
+
+# RHexBatch3D.pl
+
+#################################################################################
+##
+## RHex - 3D dyanmic simulation of fly casting and swinging.
+## Copyright (C) 2019 Rich Miller <rich@ski.org>
+##
+## This file is part of RHex.
+##
+## RHex is free software: you can redistribute it and/or modify it under the
+## terms of the GNU General Public License as published by the Free Software
+## Foundation, either version 3 of the License, or (at your option) any later
+## version.
+##
+## RHex is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+## without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+## PURPOSE.  See the GNU General Public License for more details.
+##
+## You should have received a copy of the GNU General Public License along with RHex.
+## If not, see <https://www.gnu.org/licenses/>.
+##
+## RHex makes system calls to the Gnuplot executable, Copyright 1986 - 1993, 1998,
+## 2004 Thomas Williams, Colin Kelley.  It makes static links to the Gnu Scientific
+## Library, which is copyrighted and available under the GNU General Public License.
+## In addition, RHex incorporates code from the Perl core and numerous Perl libraries,
+## all of which are free software, redistributable and/or modifable under the same
+## terms as Perl itself (Perl License).  Finally, the modules Brent, DiffEq, and
+## Numjac in the directory RUtils are modifications and translations into Perl of
+## copyrighted material.  You can find the details in the individual files.
+##
+##################################################################################
+
+## Headless batch runner for RCast3D and RSwing3D.  Loads a settings (.prefs) file exactly as the control panel's Select & Load does, optionally overrides the rod, line, leader and driver spec files, the output file and a few integration fields, then runs setup, integration and save with no Tk and no gnuplot windows.  The results go to the data (.txt) file that SAVE OUT would write.
+#
+# Usage: RHexBatch3D[.pl] cast|swing settingsFile [options]
+#
+#   -rod file, -line file, -leader file, -driver file
+#           Replace the corresponding spec file named in the settings.
+#   -out fileBase
+#           Output file name without extension.  Defaults to the run name DoRun() chooses, placed in the settings file's directory.
+#   -t1 secs
+#           Replace the integration end time.
+#   -verbose n
+#           Replace the settings verbosity.  Batch runs default to 1.
+#   -savePlot
+#           Also write the .eps plot.  This needs gnuplot, but no display.
+#   -binary
+#           Write the data as a binary .rhb file instead of the text .txt.  See RCommonSaveBinary3D().
+#   -stream
+#           Also append the rows to fileBase_stream.txt as they are computed, so a run that dies part way still leaves its data.  Without -out, the settings file name is used as the base.
+#   -memoryRows n
+#           Keep only the last n to 3n rows in memory, so a long run doesn't grow without bound.  The plot and data are read back from the stream file at the end.  Implies -stream.
+#   -resume
+#           If the stream file holds an earlier run of these same settings that stopped short of t1, continue it from its last row rather than starting over.  Implies -stream.
+#   -cache dir
+#           Use dir as the run cache, so repeating a run, or lengthening one, reuses what was already integrated.  See RCommonCache.
+#
+# Relative file names on the command line are taken relative to the directory the command was issued from.  Relative spec file names inside the settings file are, as always, relative to the RHex directory.
+#
+# A .stats file with the exit code, solver status, wall time and DE call counts is written next to the data file.
+#
+# Exit codes:  0 run completed and saved, 1 bad usage or settings file, 2 setup failed (bad params or spec file), 3 the integration stopped early (solver error), 4 died with an error.
+
+use warnings;
+use strict;
+
+our $VERSION='0.01';
+
+our $OS;
+our $program;
+our ($exeName,$exeDir,$basename,$suffix);
+our $launchDir;
+use File::Basename;
+use Cwd;
+
+BEGIN {
+	$exeName = $0;
+
+	($basename,$exeDir,$suffix) = fileparse($exeName,'.pl');
+
+	$launchDir = getcwd();
+	chdir "$exeDir";  # See perldoc -f chdir.  The settings files name their spec files relative to here.
+
+	chomp($OS = `echo $^O`);
+}
+
+# Put the launch directory on the perl path. This needs to be here, outside and below the BEGIN block.
+use lib ($exeDir);
+
+use Carp;
+use Getopt::Long;
+use Time::HiRes qw (time);
+use Config::General;
+use File::Spec::Functions qw ( rel2abs abs2rel );
+
+use RUtils::Print;
+
+use RCommon qw (DEBUG $verbose $restoreVerbose $debugVerbose $reportVerbose $switchVerbose $rps %runControl $doSetup $doRun $doSave $vs PrintSeparator HashCopyContent);
+use RCommonPlot3D qw ($gnuplot $headless);
+
+# The loaders in the run modules look at these, but there is no control panel:
+our (@rodFields,@lineFields,@leaderFields,@driverFields,@verboseFields);
+our %runParams;
+
+
+use constant {
+	EXIT_OK			=> 0,
+	EXIT_USAGE		=> 1,
+	EXIT_SETUP		=> 2,
+	EXIT_SOLVER		=> 3,
+	EXIT_DIED		=> 4,
+};
+
+my $usage = "\n$0: Usage:RHexBatch3D[.pl] cast|swing settingsFile [-rod file] [-line file] [-leader file] [-driver file] [-out fileBase] [-t1 secs] [-verbose n] [-savePlot] [-binary] [-stream] [-memoryRows n] [-resume] [-cache dir]\n";
+
+my %opts;
+if (!GetOptions(\%opts,'rod=s','line=s','leader=s','driver=s','out=s','t1=f','verbose=i','savePlot','binary','stream','memoryRows=i','resume','cache=s')
+		or @ARGV != 2){
+	print STDERR $usage;
+	exit EXIT_USAGE;
+}
+
+my ($runType,$settingsFile) = @ARGV;
+my $tStr;
+if ($runType eq "cast"){
+	$program	= "RCast3D";
+	$tStr		= "rCast";
+} elsif ($runType eq "swing"){
+	$program	= "RSwing3D";
+	$tStr		= "rSwing";
+} else {
+	print STDERR $usage;
+	exit EXIT_USAGE;
+}
+
+# Load only the module we run, since each sets the shared $doSetup, $doRun, $doSave, $loadRod and $loadDriver pointers, and fills in its own default $rps:
+if (!eval "require $program; $program->import; 1"){
+	print STDERR "ERROR: Could not load $program.\n$@";
+	exit EXIT_DIED;
+}
+
+$headless	= 1;
+$gnuplot	= '';
+
+# No control panel to pump or to pause us:
+$runControl{callerUpdate}			= sub {};
+$runControl{callerStop}				= sub {$runControl{callerRunState} = 0};
+$runControl{callerRunState}			= 1;
+$runControl{callerChangeVerbose}	= sub {$verbose = shift};
+
+
+sub LaunchPath {
+	my ($path) = @_;
+
+	## Command line paths are relative to where the command was issued.
+	return ($path) ? rel2abs($path,$launchDir) : $path;
+}
+
+
+sub LoadBatchSettings {
+	my ($filename) = @_;
+
+	## The same permissive copy RCommonInterface::LoadSettings() makes, without the widgets.
+
+	if (!-e $filename){print STDERR "ERROR: Settings file $filename not found.\n"; return 0}
+
+	my $conf = Config::General->new($filename);
+	my %src = $conf->getall();
+	if (!%src or !exists($src{file}{$tStr})){
+		print STDERR "ERROR: File $filename is not an $tStr settings file.\n";
+		return 0;
+	}
+
+	HashCopyContent(\%src,$rps);
+	foreach my $key (qw(rod line leader driver save)){
+		$rps->{file}{$key} = $src{file}{$key};
+	}
+	$rps->{file}{settings} = abs2rel($filename,$exeDir);
+
+	return 1;
+}
+
+
+my $settingsPath = LaunchPath($settingsFile);
+if (!LoadBatchSettings($settingsPath)){exit EXIT_USAGE}
+
+foreach my $key (qw(rod line leader driver)){
+	if (defined($opts{$key})){$rps->{file}{$key} = LaunchPath($opts{$key})}
+}
+if (defined($opts{t1})){$rps->{integration}{t1} = $opts{t1}}
+if (defined($opts{cache})){$rps->{integration}{runCacheDir} = LaunchPath($opts{cache})}
+if ($opts{stream} or defined($opts{memoryRows}) or $opts{resume}){
+	my $streamBase = (defined($opts{out})) ? LaunchPath($opts{out}) :
+								dirname($settingsPath).'/'.basename($settingsPath,'.prefs');
+	$rps->{integration}{streamFile} = $streamBase.'_stream.txt';
+	if (defined($opts{memoryRows})){$rps->{integration}{streamMemoryRows} = $opts{memoryRows}}
+	$rps->{integration}{streamResume} = ($opts{resume}) ? 1 : 0;
+}
+
+$rps->{integration}{savePlot}	= ($opts{savePlot}) ? 1 : 0;
+$rps->{integration}{saveData}	= ($opts{binary}) ? 0 : 1;
+$rps->{integration}{saveBinary}	= ($opts{binary}) ? 1 : 0;
+
+# Verbosity, as the control panel's verbose menus would set it, except that nothing is ever switched to the (absent) status window:
+$verbose = (defined($opts{verbose})) ? $opts{verbose} : 1;
+$restoreVerbose = $verbose;
+if (DEBUG){$debugVerbose = substr($rps->{integration}{debugVerboseName},15)}
+$reportVerbose	= (defined($opts{verbose})) ? 0 : substr($rps->{integration}{reportVerboseName},13);
+$switchVerbose	= ($rps->{integration}{switchOnSlowing}) ? 1 : 0;
+$vs = "\n";
+
+PrintSeparator("*** RHex batch $runType run, settings $settingsPath ***",0,$verbose>=1);
+
+my $exitCode = EXIT_OK;
+my $outBase;
+my $tStatus = '';
+my $timeStart = time();
+
+sub WriteBatchStats {
+	my ($filename) = @_;
+
+	## Tab separated key-value lines, for sweep drivers and other scripts.  Written next to the data file.
+
+	my ($DE_numCalls,$DEfunc_numCalls,$DEjac_numCalls) = RHamilton3D::DE_GetCounts();
+	my @stats = (
+		runType			=> $runType,
+		settings		=> $settingsPath,
+		exitCode		=> $exitCode,
+		solverStatus	=> $tStatus,
+		elapsedSecs		=> sprintf("%.1f",time()-$timeStart),
+		DE_numCalls		=> $DE_numCalls,
+		DEfunc_numCalls	=> $DEfunc_numCalls,
+		DEjac_numCalls	=> $DEjac_numCalls);
+
+	open STATSFILE,"> $filename".'.stats' or die $!;
+	while (my ($key,$val) = splice(@stats,0,2)){
+		if (!defined($val)){$val = ''}
+		print STATSFILE "$key\t$val\n";
+	}
+	close STATSFILE;
+}
+
+my $ok = eval {
+
+	if (!&$doSetup()){
+		print STDERR "ERROR: Setup failed.  Cannot proceed.\n";
+		$exitCode = EXIT_SETUP;
+		return 1;
+	}
+
+	$tStatus = &$doRun();
+	if ($tStatus){
+		print STDERR "ERROR: Integration stopped early (status $tStatus).  Saving the data obtained.\n";
+		$exitCode = EXIT_SOLVER;
+	}
+
+	$outBase = (defined($opts{out})) ? LaunchPath($opts{out}) :
+								dirname($settingsPath).'/'.basename($rps->{file}{save});
+	&$doSave($outBase);
+	WriteBatchStats($outBase);
+
+	1;
+};
+
+if (!$ok){
+	my $err = $@;
+	print STDERR "ERROR: Batch run died:\n$err";
+	exit EXIT_DIED;
+}
+
+if ($exitCode != EXIT_SETUP){print "Saved to $outBase".(($opts{binary}) ? '.rhb' : '.txt')."\n"}
+
+exit $exitCode;
+
+
+__END__
+
+=head1 NAME
+
+RHexBatch3D - Run RCast3D or RSwing3D from the command line, without the control panel or plot windows.
+
+=head1 SYNOPSIS
+
+  perl RHexBatch3D.pl swing SpecFiles_Preference/mySwing.prefs -out results/swing1 -t1 20
+
+=head1 DESCRIPTION
+
+Loads a settings file saved from RHexCast3D or RHexSwing3D, optionally replaces its spec files, the end time and the verbosity, runs the setup, the integration and the data save, and exits with a status code.  Suitable for compute servers with no display, and as the unit of work for scripted sweeps.
+
+=head1 AUTHOR
+
+Rich Miller, E<lt>rich@ski.orgE<gt>
+
+=head1 COPYRIGHT AND LICENSE
+
+RHex - 3D dyanmic simulation of fly casting and swinging.
+
+Copyright (C) 2019 Rich Miller
+
+This file is part of RHex.
+
+RHex is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RHex is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RHex.  If not, see <https://www.gnu.org/licenses/>.
+
+=cut
@@ -400,14 +400,15 @@ our @driverFields;
     $int_fr->LabEntry(-textvariable=>\$rps->{integration}{plotDt},-label=>'plotDt',-labelPack=>[qw/-side left/],-width=>8)->grid(-row=>4,-column=>0,-sticky=>'e');
     my @aStepperItems = ("msbdf_j","rk4imp_j","rk2imp_j","rk1imp_j","bsimp_j","rkf45","rk4","rk2","rkck","rk8pd","msadams");
     $int_fr->Optionmenu(-options=>\@aStepperItems,-textvariable=>\$rps->{integration}{stepperName},-relief=>'sunken')->grid(-row=>5,-column=>0,-sticky=>'e');
-    $int_fr->Label(-text=>'',-width=>8)->grid(-row=>6,-column=>0,-sticky=>'e');
+    $int_fr->Checkbutton(-variable=>\$rps->{integration}{staticStart},-text=>'staticStart',-anchor=>'center',-offrelief=>'groove')->grid(-row=>6,-column=>0);
 
     my $saveOptionsMB = $int_fr->Menubutton(-state=>'normal',-text=>'saveOptions',-relief=>'sunken',-direction=>'below',-width=>12)->grid(-row=>7,-column=>0,-sticky=>'e');
         my $saveOptionsMenu = $saveOptionsMB->Menu();
             $saveOptionsMenu->add('checkbutton',-label=>'plot',-variable=>\$rps->{integration}{savePlot});        
             $saveOptionsMenu->add('checkbutton',-label=>'data',-variable=>\$rps->{integration}{saveData});    
+            $saveOptionsMenu->add('checkbutton',-label=>'binary data',-variable=>\$rps->{integration}{saveBinary});
         $saveOptionsMB->configure(-menu=>$saveOptionsMenu);   # Attach menu to button.
-	$int_fr->Label(-text=>'',-width=>8)->grid(-row=>8,-column=>0,-sticky=>'e');
+	$int_fr->Checkbutton(-variable=>\$rps->{integration}{livePlot},-text=>'livePlot',-anchor=>'center',-offrelief=>'groove')->grid(-row=>8,-column=>0);
 
 our @verboseFields;
 
@@ -976,6 +977,15 @@ saveOptions - When you hit the Save Out button if the \"plot\" box is checked (c
 	editor, and you can read the actual coordinate numbers that define the traces, as well as the parameter
 	settings that gave rise to those traces.  In addition, that file can be opened in RHexReplot3D, and from there
 	replotted in live, rotatable form.
+
+staticStart - If checked (colored red), and the rod file holds no saved state, the rod and line are first brought
+	to rest in static equilibrium, under gravity and the holding spring, with the handle held in its starting pose.
+	The run then starts from that rest configuration, rather than from the unloaded one set by the rod and line
+	fields, so there is no need to integrate for a while with the handle still just to let the rod settle.
+
+livePlot - If checked (colored red), a separate window shows the traces as the solver computes them, redrawn at
+	most livePlotFPS times a second (set in the settings file).  A run that goes bad early can then be seen at once
+	and stopped with PAUSE.  The window closes when the run ends, and the usual plot takes its place.
 }
 		)->pack;
 
@@ -0,0 +1,301 @@
+#!/usr/bin/env perl
+
+# This shebang causes the first perl on the path to be used, which will be the perlbrew choice if using perlbrew.
+
+# RHexMonteCarlo3D.pl
+
+#################################################################################
+##
+## RHex - 3D dyanmic simulation of fly casting and swinging.
+## Copyright (C) 2019 Rich Miller <rich@ski.org>
+##
+## This file is part of RHex.
+##
+## RHex is free software: you can redistribute it and/or modify it under the
+## terms of the GNU General Public License as published by the Free Software
+## Foundation, either version 3 of the License, or (at your option) any later
+## version.
+##
+## RHex is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+## without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+## PURPOSE.  See the GNU General Public License for more details.
+##
+## You should have received a copy of the GNU General Public License along with RHex.
+## If not, see <https://www.gnu.org/licenses/>.
+##
+## RHex makes system calls to the Gnuplot executable, Copyright 1986 - 1993, 1998,
+## 2004 Thomas Williams, Colin Kelley.  It makes static links to the Gnu Scientific
+## Library, which is copyrighted and available under the GNU General Public License.
+## In addition, RHex incorporates code from the Perl core and numerous Perl libraries,
+## all of which are free software, redistributable and/or modifable under the same
+## terms as Perl itself (Perl License).  Finally, the modules Brent, DiffEq, and
+## Numjac in the directory RUtils are modifications and translations into Perl of
+## copyrighted material.  You can find the details in the individual files.
+##
+##################################################################################
+
+## Monte Carlo drag variation.  Runs one cast or swing settings file many times, each replica with its own seed for the per-segment drag multipliers (see ambient dragVariation), through the RHexSweep3D machinery, so the replicas run in parallel locally and, with -listen, on remote workers too.  Then reads back only the line tip and fly tracks of each replica, never the full solution, and writes them out together with their mean and percentile envelopes over the replicas, and, for casts, the distribution of turnover times.
+#
+# Usage: RHexMonteCarlo3D[.pl] cast|swing settingsFile outDir [-replicas n] [-variation v] [-seed s] [-percentiles list] [-summaryOnly] [sweep options]
+#
+#   -replicas n
+#           Number of runs.  Default 20.
+#   -variation v
+#           Replaces the settings' ambient dragVariation, the standard deviation of the segment drag multipliers.  One or the other must be positive.
+#   -seed s
+#           The replicas use drag seeds s, s+1, ...  Default 1.
+#   -percentiles list
+#           Comma separated percentiles for the envelopes.  Default 5,25,50,75,95.
+#   -summaryOnly
+#           Skip the runs and just redo the summary from an existing outDir.
+#   -jobs n, -timeout secs, -retries n, -verbose n, -listen [host:]port, -workerTimeout secs
+#           Passed to RHexSweep3D.
+#
+# Besides what RHexSweep3D leaves in outDir, this writes:
+#   tracks.tsv      replica, seed, t, line tip x y z, fly x y z, one line per replica per plotted time.
+#   summary.tsv     t, then for each of those six coordinates its mean and percentiles over the replicas that completed.
+#   turnover.tsv    (cast only) replica, seed, and the first time the fly passes the line tip in x, or NaN if it never does.
+#   report.txt      Replica counts and the turnover time distribution.
+#
+# Replicas that did not complete are left out of the summary, which is cut to the shortest completed track.
+
+use warnings;
+use strict;
+
+our $VERSION='0.01';
+
+our $OS;
+our ($exeName,$exeDir,$basename,$suffix);
+our $launchDir;
+use File::Basename;
+use Cwd;
+
+BEGIN {
+	$exeName = $0;
+
+	($basename,$exeDir,$suffix) = fileparse($exeName,'.pl');
+
+	$launchDir = getcwd();
+	chdir "$exeDir";  # See perldoc -f chdir.
+
+	chomp($OS = `echo $^O`);
+}
+
+use lib ($exeDir);
+
+use Carp;
+use Getopt::Long;
+use Config::General;
+use File::Path qw (make_path);
+use File::Spec::Functions qw ( rel2abs );
+
+use PDL;
+use PDL::NiceSlice;
+
+use RCommonPlot3D qw ($headless RCommonLoadBinary3D TurnoverTime);
+
+
+my $sweepExe = rel2abs('RHexSweep3D.pl',$exeDir);
+my @coordNames = qw(lineTipX lineTipY lineTipZ flyX flyY flyZ);
+
+
+my $usage = "\n$0: Usage:RHexMonteCarlo3D[.pl] cast|swing settingsFile outDir [-replicas n] [-variation v] [-seed s] [-percentiles list] [-summaryOnly] [-jobs n] [-timeout secs] [-retries n] [-verbose n] [-listen [host:]port] [-workerTimeout secs]\n";
+
+my %opts;
+my @sweepOpts = qw(jobs=i timeout=f retries=i verbose=i listen=s workerTimeout=f);
+if (!GetOptions(\%opts,'replicas=i','variation=f','seed=i','percentiles=s','summaryOnly',@sweepOpts)
+		or @ARGV != 3 or $ARGV[0] !~ /^(cast|swing)$/){
+	print STDERR $usage;
+	exit 1;
+}
+
+my ($runType,$settingsFile,$outDir) = ($ARGV[0],rel2abs($ARGV[1],$launchDir),rel2abs($ARGV[2],$launchDir));
+my $tStr		= ($runType eq 'cast') ? 'rCast' : 'rSwing';
+my $numReplicas	= $opts{replicas} || 20;
+my $seed0		= (defined($opts{seed})) ? $opts{seed} : 1;
+my @percentiles	= split(/\s*,\s*/,$opts{percentiles} // '5,25,50,75,95');
+foreach my $pct (@percentiles){
+	if ($pct !~ /^\d+(\.\d*)?$/ or $pct > 100){die "ERROR: Percentiles must be numbers in [0,100].\nStopped"}
+}
+
+$headless = 1;
+
+
+sub RunReplicas {
+
+	## Writes the base settings, with the variation in place, and a list mode sweep over the drag seed, and runs it.  Returns the sweep's exit code.
+
+	if (!-e $settingsFile){die "ERROR: Settings file $settingsFile not found.\nStopped"}
+	my %settings = Config::General->new($settingsFile)->getall();
+	if (!exists($settings{file}{$tStr})){die "ERROR: $settingsFile is not an $tStr settings file.\nStopped"}
+
+	if (defined($opts{variation})){$settings{ambient}{dragVariation} = $opts{variation}}
+	if (!$settings{ambient}{dragVariation} or $settings{ambient}{dragVariation} <= 0){
+		die "ERROR: Nothing varies.  Set ambient dragVariation in the settings, or use -variation.\nStopped";
+	}
+
+	make_path($outDir);
+	Config::General->new(\%settings)->save_file("$outDir/base.prefs");
+
+	my %sweep = (
+		sweep	=> {runType=>$runType,settings=>'base.prefs',mode=>'list',binary=>1},
+		params	=> {'ambient.dragSeed'=>join(', ',map {$seed0+$_} (0..$numReplicas-1))});
+	Config::General->new(\%sweep)->save_file("$outDir/montecarlo_sweep.txt");
+
+	my @args;
+	foreach my $opt (@sweepOpts){
+		my ($name) = split(/=/,$opt);
+		if (defined($opts{$name})){push @args,"-$name",$opts{$name}}
+	}
+
+	printf("Monte Carlo: %d %s replicas, drag variation %s\n",$numReplicas,$runType,$settings{ambient}{dragVariation});
+	system($^X,$sweepExe,"$outDir/montecarlo_sweep.txt",$outDir,@args);
+	return $? >> 8;
+}
+
+
+sub ReadIndex {
+
+	## The sweep's index.tsv as a list of hashes keyed by its header.
+	open(my $fh,'<',"$outDir/index.tsv") or die "ERROR: No sweep index in $outDir.\nStopped";
+	chomp(my $header = <$fh>);
+	my @cols = split(/\t/,$header,-1);
+	my @rows;
+	while (my $line = <$fh>){
+		chomp($line);
+		my @vals = split(/\t/,$line,-1);
+		push @rows,{map {$cols[$_] => $vals[$_]} (0..$#cols)};
+	}
+	close $fh;
+	return @rows;
+}
+
+
+sub Summarize {
+
+	my @rows = ReadIndex();
+	my (@tracks,@turnovers);
+	my $numFailed = 0;
+
+	open(my $tracksFh,'>',"$outDir/tracks.tsv") or die $!;
+	print $tracksFh join("\t",'replica','seed','t',@coordNames)."\n";
+
+	foreach my $row (@rows){
+		if ($row->{status} ne 'ok' or $row->{dataFile} !~ /\.rhb$/){$numFailed++; next}
+		my $data = RCommonLoadBinary3D($row->{dataFile});
+		if (!defined($data)){$numFailed++; next}
+
+		# Only these small pieces are kept.  The rest stays in the (memory mapped) file:
+		my ($xs,$ys,$zs) = @{$data}{qw(PlotXs PlotYs PlotZs)};
+		my $ts		= $data->{PlotTs}->flat->copy;
+		my $track	= cat($data->{PlotXLineTips}->flat,$data->{PlotYLineTips}->flat,$data->{PlotZLineTips}->flat,
+						$xs(-1,:)->flat,$ys(-1,:)->flat,$zs(-1,:)->flat)->transpose->copy;
+			# Dims (6,numTimes), the fly being the last node.
+		my $seed	= $row->{'ambient.dragSeed'};
+
+		for (my $jj=0;$jj<$ts->nelem;$jj++){
+			print $tracksFh join("\t",$row->{index},$seed,sprintf("%.6g",$ts->at($jj)),
+				map {sprintf("%.6g",$_)} $track(:,$jj)->list)."\n";
+		}
+
+		push @tracks,[$ts,$track];
+		if ($runType eq 'cast'){push @turnovers,[$row->{index},$seed,TurnoverTime($ts,$track(0,:)->flat,$track(3,:)->flat)]}
+	}
+	close $tracksFh;
+
+	my $numOk = scalar(@tracks);
+	my $report = sprintf("Replicas: %d run, %d completed, %d left out\n",scalar(@rows),$numOk,$numFailed);
+	if (!$numOk){print $report; return 0}
+
+	my $numTimes	= min(pdl(map {$_->[0]->nelem} @tracks));
+	my $ts			= $tracks[0][0]->slice("0:".($numTimes-1));
+	my $all			= cat(map {$_->[1]->slice(":,0:".($numTimes-1))} @tracks);
+		# Dims (6,numTimes,numOk).
+	my $acrossReplicas = $all->mv(2,0);
+
+	my @stats	= ($acrossReplicas->average);
+	my @names	= ('mean');
+	foreach my $pct (@percentiles){
+		push @stats,$acrossReplicas->pctover($pct/100);
+		push @names,sprintf("p%02g",$pct);
+	}
+
+	open(my $summaryFh,'>',"$outDir/summary.tsv") or die $!;
+	print $summaryFh join("\t",'t',map {my $coord = $_; map {"${coord}_$_"} @names} @coordNames)."\n";
+	for (my $jj=0;$jj<$numTimes;$jj++){
+		my @vals;
+		for (my $cc=0;$cc<@coordNames;$cc++){push @vals,map {sprintf("%.6g",$_->at($cc,$jj))} @stats}
+		print $summaryFh join("\t",sprintf("%.6g",$ts->at($jj)),@vals)."\n";
+	}
+	close $summaryFh;
+
+	if (@turnovers){
+		open(my $turnoverFh,'>',"$outDir/turnover.tsv") or die $!;
+		print $turnoverFh join("\t",'replica','seed','turnoverT')."\n";
+		foreach my $turnover (@turnovers){print $turnoverFh join("\t",@$turnover)."\n"}
+		close $turnoverFh;
+
+		my $turnoverTs = pdl(grep {$_ ne 'NaN'} map {$_->[2]} @turnovers);
+		$report .= sprintf("Turnover: %d of %d completed casts turned over\n",$turnoverTs->nelem,$numOk);
+		if (!$turnoverTs->isempty){
+			my ($mean,$prms,$median,$minT,$maxT) = stats($turnoverTs);
+			$report .= sprintf("Turnover time: mean %.4f, sd %.4f, min %.4f, max %.4f\n",$mean,($turnoverTs->nelem > 1) ? $prms : 0,$minT,$maxT);
+			$report .= "Turnover time percentiles: ".join(", ",map {sprintf("p%g %.4f",$_,$turnoverTs->pct($_/100))} @percentiles)."\n";
+		}
+	}
+
+	open(my $reportFh,'>',"$outDir/report.txt") or die $!;
+	print $reportFh $report;
+	close $reportFh;
+	print $report;
+
+	return ($numFailed) ? 3 : 0;
+}
+
+
+my $sweepStatus = ($opts{summaryOnly}) ? 0 : RunReplicas();
+if ($sweepStatus and $sweepStatus != 3){die "ERROR: The replica sweep failed (exit $sweepStatus).\nStopped"}
+
+exit Summarize();
+
+
+__END__
+
+=head1 NAME
+
+RHexMonteCarlo3D - Run a cast or swing many times with random segment drag variation, and summarize the spread of the line tip and fly tracks.
+
+=head1 SYNOPSIS
+
+  perl RHexMonteCarlo3D.pl cast SpecFiles_Preference/RHexCast3D.prefs mc/cast1 -replicas 200 -variation 0.2
+
+=head1 DESCRIPTION
+
+See the comments at the top of this file for the options and the output files.
+
+=head1 AUTHOR
+
+Rich Miller, E<lt>rich@ski.orgE<gt>
+
+=head1 COPYRIGHT AND LICENSE
+
+RHex - 3D dyanmic simulation of fly casting and swinging.
+
+Copyright (C) 2019 Rich Miller
+
+This file is part of RHex.
+
+RHex is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RHex is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RHex.  If not, see <https://www.gnu.org/licenses/>.
+
+=cut
@@ -0,0 +1,406 @@
+#!/usr/bin/env perl
+
+# This shebang causes the first perl on the path to be used, which will be the perlbrew choice if using perlbrew.
+
+# RHexOptimizeCast3D.pl
+
+#################################################################################
+##
+## RHex - 3D dyanmic simulation of fly casting and swinging.
+## Copyright (C) 2019 Rich Miller <rich@ski.org>
+##
+## This file is part of RHex.
+##
+## RHex is free software: you can redistribute it and/or modify it under the
+## terms of the GNU General Public License as published by the Free Software
+## Foundation, either version 3 of the License, or (at your option) any later
+## version.
+##
+## RHex is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+## without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+## PURPOSE.  See the GNU General Public License for more details.
+##
+## You should have received a copy of the GNU General Public License along with RHex.
+## If not, see <https://www.gnu.org/licenses/>.
+##
+## RHex makes system calls to the Gnuplot executable, Copyright 1986 - 1993, 1998,
+## 2004 Thomas Williams, Colin Kelley.  It makes static links to the Gnu Scientific
+## Library, which is copyrighted and available under the GNU General Public License.
+## In addition, RHex incorporates code from the Perl core and numerous Perl libraries,
+## all of which are free software, redistributable and/or modifable under the same
+## terms as Perl itself (Perl License).  Finally, the modules Brent, DiffEq, and
+## Numjac in the directory RUtils are modifications and translations into Perl of
+## copyrighted material.  You can find the details in the individual files.
+##
+##################################################################################
+
+## Inverse casting.  Adjusts chosen driver (handle motion) fields of a cast settings file to bring the simulated fly as close as possible to a target path or landing point.  Uses a compass search: each iteration tries a step up and a step down in every field, all in parallel RHexBatch3D processes, moves to the best candidate if it improves on the current one, and otherwise halves the steps.
+#
+# Candidates are first run only to a screening time.  The fit error is a sum over the target times, so the part due to targets before the screening time is a lower bound on the whole, and any candidate whose partial error already exceeds the current best is dropped without being run further.  The rest are continued to the end time, and the run cache (RCommonCache) supplies the screened part, so it is not integrated twice.  The cache is not used for casts with tip holding, which are then rerun from the start.
+#
+# Usage: RHexOptimizeCast3D[.pl] settingsFile targetFile outDir [-param field=step ...] [-iterations n] [-minStep frac] [-screenFrac f] [-jobs n] [-timeout secs] [-verbose n]
+#
+#   -param field=step
+#           A driver field to vary and its initial step.  Repeat for each.  Coordinate fields take an index, as powerEndCoordsIn[0]=2.  The default varies the power end x and z coords, the handle end angle, and the max velocity and power end times.
+#   -iterations n
+#           Maximum number of iterations.  Default 20.
+#   -minStep frac
+#           Stop when every step has shrunk below this fraction of its initial size.  Default 0.05.
+#   -screenFrac f
+#           Screening time, as a fraction of the way from t0 to t1.  Default 0.5.  Set to 1 to run every candidate to the end.
+#   -jobs n
+#           Simultaneous runs.  Defaults to the number of cores.
+#   -timeout secs
+#           Per run.  Runs that time out count as failures.
+#
+# The target file gives fly positions in feet, in the plot coordinates.  Blank lines and lines starting with # are ignored.  Either a path, one line per target time:
+#
+#   t x y z
+#
+# or a single landing point, matched against the fly position at the end of the run:
+#
+#   landing x y z
+#
+# The fit error is the sum over the targets of the squared distance from the fly, reported as the rms distance.  outDir gets iter_NN/cand_NN run directories, a cache directory, progress.tsv with every candidate's values and errors, and best.prefs, the best settings found.
+
+use warnings;
+use strict;
+
+our $VERSION='0.01';
+
+our $OS;
+our ($exeName,$exeDir,$basename,$suffix);
+our $launchDir;
+use File::Basename;
+use Cwd;
+
+BEGIN {
+	$exeName = $0;
+
+	($basename,$exeDir,$suffix) = fileparse($exeName,'.pl');
+
+	$launchDir = getcwd();
+	chdir "$exeDir";  # See perldoc -f chdir.
+
+	chomp($OS = `echo $^O`);
+}
+
+use lib ($exeDir);
+
+use Carp;
+use Getopt::Long;
+use POSIX qw (:sys_wait_h);
+use Time::HiRes qw (time sleep);
+use Config::General;
+use File::Path qw (make_path);
+use File::Spec::Functions qw ( rel2abs );
+
+use PDL;
+use PDL::NiceSlice;
+
+use RCommon qw ($feetToCms);
+use RCommonPlot3D qw ($headless RCommonLoadBinary3D);
+use RCommonSweep qw (NumCores);
+
+
+my $batchExe		= rel2abs('RHexBatch3D.pl',$exeDir);
+my $killGraceSecs	= 5;
+my $pollSecs		= 0.2;
+
+my @defaultParams = ('powerEndCoordsIn[0]=2','powerEndCoordsIn[2]=2','powerHandleEndDeg=5','powerVMaxTime=0.02','powerEndTime=0.02');
+
+
+my $usage = "\n$0: Usage:RHexOptimizeCast3D[.pl] settingsFile targetFile outDir [-param field=step ...] [-iterations n] [-minStep frac] [-screenFrac f] [-jobs n] [-timeout secs] [-verbose n]\n";
+
+my %opts = (param=>[]);
+if (!GetOptions(\%opts,'param=s@','iterations=i','minStep=f','screenFrac=f','jobs=i','timeout=f','verbose=i') or @ARGV != 3){
+	print STDERR $usage;
+	exit 1;
+}
+
+my ($settingsFile,$targetFile,$outDir) = map {rel2abs($_,$launchDir)} @ARGV;
+my $maxIterations	= $opts{iterations} || 20;
+my $minStepFrac		= $opts{minStep} || 0.05;
+my $screenFrac		= (defined($opts{screenFrac})) ? $opts{screenFrac} : 0.5;
+my $numJobs			= $opts{jobs} || NumCores();
+my $timeout			= $opts{timeout} || 0;
+my $childVerbose	= (defined($opts{verbose})) ? $opts{verbose} : 0;
+my $cacheDir		= "$outDir/cache";
+
+$headless = 1;
+
+
+# The base settings:
+if (!-e $settingsFile){die "ERROR: Settings file $settingsFile not found.\nStopped"}
+my %baseSettings = Config::General->new($settingsFile)->getall();
+if (!exists($baseSettings{file}{rCast})){die "ERROR: $settingsFile is not a cast settings file.\nStopped"}
+my ($t0,$t1) = map {eval($baseSettings{integration}{$_})} qw(t0 t1);
+
+
+# The fields to vary, as [field,index or undef,step]:
+my @params;
+foreach my $spec ((@{$opts{param}}) ? @{$opts{param}} : @defaultParams){
+	if ($spec !~ /^(\w+)(?:\[(\d)\])?=([-+.\deE]+)$/ or $3 <= 0){die "ERROR: Bad -param $spec.  Use field=step or field[index]=step, with step > 0.\nStopped"}
+	if (!exists($baseSettings{driver}{$1})){die "ERROR: $1 is not a driver field.\nStopped"}
+	push @params,[$1,$2,$3];
+}
+my @paramNames = map {$_->[0].((defined($_->[1])) ? "[$_->[1]]" : '')} @params;
+
+
+sub GetParam {
+	my ($settings,$param) = @_;
+
+	my ($field,$index) = @$param;
+	my $val = $settings->{driver}{$field};
+	if (defined($index)){$val = (split(/\s*,\s*/,$val))[$index]}
+	if (!defined($val)){die "ERROR: Driver field $field has no element $index.\nStopped"}
+	return eval($val);
+}
+
+
+sub SetParams {
+	my ($values) = @_;
+
+	## A copy of the base settings with the driver fields replaced.
+	my %settings = map {$_ => (ref($baseSettings{$_}) eq 'HASH') ? {%{$baseSettings{$_}}} : $baseSettings{$_}} keys %baseSettings;
+	for (my $ii=0;$ii<@params;$ii++){
+		my ($field,$index) = @{$params[$ii]};
+		my $val = sprintf("%.6g",$values->[$ii]);
+		if (defined($index)){
+			my @elts = split(/\s*,\s*/,$settings{driver}{$field});
+			$elts[$index] = $val;
+			$val = join(',',@elts);
+		}
+		$settings{driver}{$field} = $val;
+	}
+	return \%settings;
+}
+
+
+# The target, converted to the plot's cm:
+my ($targetTs,$targetXYZs);		# Undef times for a landing point.
+{
+	open(my $fh,'<',$targetFile) or die "ERROR: Could not open target file $targetFile.\nStopped";
+	my (@ts,@xyzs);
+	while (my $line = <$fh>){
+		$line =~ s/^\s+|\s+$//g;
+		if ($line eq '' or $line =~ /^#/){next}
+		my @fields = split(/[\s,]+/,$line);
+		if (@fields != 4){die "ERROR: Target lines are \"t x y z\" or \"landing x y z\".\nStopped"}
+		if ($fields[0] eq 'landing'){
+			if (@ts or @xyzs){die "ERROR: A landing target must be the only one.\nStopped"}
+			$targetXYZs = pdl(@fields[1..3])->dummy(1)*$feetToCms;
+			last;
+		}
+		push @ts,$fields[0];
+		push @xyzs,[@fields[1..3]];
+	}
+	close $fh;
+	if (@ts){
+		$targetTs	= pdl(@ts);
+		$targetXYZs	= pdl(\@xyzs)*$feetToCms;		# Dims (3,numTargets).
+	}
+	if (!defined($targetXYZs)){die "ERROR: No targets in $targetFile.\nStopped"}
+}
+
+# Screening only helps if some targets come before the screening time:
+my $tScreen = $t0 + $screenFrac*($t1-$t0);
+if (!defined($targetTs) or $screenFrac >= 1 or !any($targetTs <= $tScreen)){$tScreen = $t1}
+
+
+sub FitError {
+	my ($filename,$tEnd) = @_;
+
+	## The sum of squared fly to target distances (cm^2) over the targets no later than $tEnd, or undef if the run is unusable.
+	my $data = RCommonLoadBinary3D($filename);
+	if (!defined($data)){return undef}
+
+	my $ts		= $data->{PlotTs}->flat;
+	my $flyXYZs	= cat(map {my $coords = $data->{$_}; $coords(-1,:)->flat} qw(PlotXs PlotYs PlotZs))->transpose;
+		# Dims (3,numTimes).  The fly is the last node.
+
+	if (!defined($targetTs)){
+		return sum(($flyXYZs(:,-1)-$targetXYZs)**2);
+	}
+
+	my $iUse = which($targetTs <= $tEnd);
+	if ($iUse->isempty){return 0}
+	if ($targetTs($iUse)->max > $ts(-1)+1e-9){return undef}	# The run stopped short.
+	my $tts = $targetTs($iUse);
+	my $flyAts = cat(map {$tts->interpol($ts,$flyXYZs($_,:)->flat)} (0..2))->transpose;
+	return sum(($flyAts-$targetXYZs(:,$iUse))**2);
+}
+
+
+sub RunCandidates {
+	my ($cands,$tEnd) = @_;
+
+	## Runs each candidate ({dir,values}) to $tEnd, at most $numJobs at a time, and fills in its status.  Reruns in the same directory reuse the cached run.
+	my @queue = @$cands;
+	my %running;	# pid => {cand, start, killedAt}
+
+	while (@queue or %running){
+		while (@queue and keys(%running) < $numJobs){
+			my $cand = shift @queue;
+			make_path($cand->{dir});
+			Config::General->new(SetParams($cand->{values}))->save_file("$cand->{dir}/settings.prefs");
+
+			my $pid = fork();
+			if (!defined($pid)){die "ERROR: Could not fork: $!\nStopped"}
+			if (!$pid){
+				open(STDOUT,'>>',"$cand->{dir}/run.log") or exit 4;
+				open(STDERR,'>&',\*STDOUT) or exit 4;
+				exec($^X,$batchExe,'cast',"$cand->{dir}/settings.prefs",'-out',"$cand->{dir}/result",
+					'-t1',$tEnd,'-binary','-cache',$cacheDir,'-verbose',$childVerbose);
+				exit 4;
+			}
+			$running{$pid} = {cand=>$cand,start=>time(),killedAt=>0};
+		}
+
+		my $pid = waitpid(-1,WNOHANG);
+		if ($pid > 0 and exists($running{$pid})){
+			my $entry = delete $running{$pid};
+			$entry->{cand}{ok} = (!$entry->{killedAt} and $? == 0) ? 1 : 0;
+			next;
+		}
+
+		if ($timeout){
+			my $now = time();
+			foreach my $pid (keys %running){
+				my $entry = $running{$pid};
+				if (!$entry->{killedAt} and $now-$entry->{start} > $timeout){
+					kill('TERM',$pid);
+					$entry->{killedAt} = $now;
+				} elsif ($entry->{killedAt} and $now-$entry->{killedAt} > $killGraceSecs){
+					kill('KILL',$pid);
+				}
+			}
+		}
+		sleep($pollSecs);
+	}
+}
+
+
+make_path($outDir);
+open(my $progressFh,'>',"$outDir/progress.tsv") or die $!;
+$progressFh->autoflush(1);
+print $progressFh join("\t",'iteration','candidate','stage',@paramNames,'rmsDistFt')."\n";
+
+my $numTargets = (defined($targetTs)) ? $targetTs->nelem : 1;
+
+sub Record {
+	my ($iter,$cand,$stage,$err) = @_;
+	my $rms = (defined($err)) ? sprintf("%.4f",sqrt($err/$numTargets)/$feetToCms) : 'failed';
+	print $progressFh join("\t",$iter,$cand->{index},$stage,(map {sprintf("%.6g",$_)} @{$cand->{values}}),$rms)."\n";
+	return $rms;
+}
+
+
+# Start from the base settings:
+my @current	= map {GetParam(\%baseSettings,$_)} @params;
+my @steps	= map {$_->[2]} @params;
+my $start	= {index=>0,dir=>"$outDir/iter_00/cand_00",values=>[@current]};
+RunCandidates([$start],$t1);
+my $bestErr = ($start->{ok}) ? FitError("$start->{dir}/result.rhb",$t1) : undef;
+if (!defined($bestErr)){die "ERROR: The starting settings do not run.  See $start->{dir}/run.log.\nStopped"}
+printf("Start: rms distance %s ft\n",Record(0,$start,'full',$bestErr));
+
+for (my $iter=1;$iter<=$maxIterations;$iter++){
+
+	if (!grep {$steps[$_] >= $minStepFrac*$params[$_][2]} (0..$#params)){last}
+
+	my @cands;
+	for (my $ii=0;$ii<@params;$ii++){
+		foreach my $sign (1,-1){
+			my @values = @current;
+			$values[$ii] += $sign*$steps[$ii];
+			push @cands,{index=>scalar(@cands),values=>\@values,
+				dir=>sprintf("%s/iter_%02d/cand_%02d",$outDir,$iter,scalar(@cands))};
+		}
+	}
+
+	# Screen, dropping the candidates that can no longer beat the current best:
+	my @survivors = @cands;
+	if ($tScreen < $t1){
+		RunCandidates(\@cands,$tScreen);
+		@survivors = ();
+		foreach my $cand (@cands){
+			my $err = ($cand->{ok}) ? FitError("$cand->{dir}/result.rhb",$tScreen) : undef;
+			Record($iter,$cand,'screen',$err);
+			if (defined($err) and $err < $bestErr){push @survivors,$cand}
+		}
+	}
+
+	RunCandidates(\@survivors,$t1);
+	my $improved;
+	foreach my $cand (@survivors){
+		my $err = ($cand->{ok}) ? FitError("$cand->{dir}/result.rhb",$t1) : undef;
+		Record($iter,$cand,'full',$err);
+		if (defined($err) and $err < $bestErr){
+			$bestErr	= $err;
+			$improved	= $cand;
+		}
+	}
+
+	if ($improved){
+		@current = @{$improved->{values}};
+		printf("Iteration %d: %d of %d candidates screened out, rms distance now %.4f ft\n",
+			$iter,@cands-@survivors,scalar(@cands),sqrt($bestErr/$numTargets)/$feetToCms);
+	} else {
+		@steps = map {$_/2} @steps;
+		printf("Iteration %d: %d of %d candidates screened out, no improvement, halving the steps\n",
+			$iter,@cands-@survivors,scalar(@cands));
+	}
+}
+close $progressFh;
+
+my $best = SetParams(\@current);
+$best->{file}{settings} = "$outDir/best.prefs";
+Config::General->new($best)->save_file("$outDir/best.prefs");
+printf("Best: rms distance %.4f ft, %s\n",sqrt($bestErr/$numTargets)/$feetToCms,
+	join(", ",map {sprintf("%s=%.6g",$paramNames[$_],$current[$_])} (0..$#params)));
+print "Settings in $outDir/best.prefs\n";
+
+exit 0;
+
+
+__END__
+
+=head1 NAME
+
+RHexOptimizeCast3D - Search the driver fields of a cast settings file for the handle motion that best puts the fly on a target path or landing point.
+
+=head1 SYNOPSIS
+
+  perl RHexOptimizeCast3D.pl SpecFiles_Preference/RHexCast3D.prefs myTarget.txt opt/run1 -param powerEndCoordsIn[0]=3 -param powerEndTime=0.03
+
+=head1 DESCRIPTION
+
+See the comments at the top of this file for the options, the target file format and the output files.
+
+=head1 AUTHOR
+
+Rich Miller, E<lt>rich@ski.orgE<gt>
+
+=head1 COPYRIGHT AND LICENSE
+
+RHex - 3D dyanmic simulation of fly casting and swinging.
+
+Copyright (C) 2019 Rich Miller
+
+This file is part of RHex.
+
+RHex is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RHex is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RHex.  If not, see <https://www.gnu.org/licenses/>.
+
+=cut
@@ -116,9 +116,9 @@ PDL::no_clone_skip_warning;
 use RUtils::Print;
 #use RUtils::Plot;	# Only for TEST_FORK_SYSTEM() if you want to use that.
 
-use RCommon qw ($inf $rSwingOutFileTag $rCastOutFileTag GetValueFromDataString GetWordFromDataString  GetQuotedStringFromDataString GetMatFromDataString Str2Vect);
+use RCommon qw ($inf Str2Vect);
 use RCommonHelp qw (OnGnuplotView OnGnuplotViewCont);
-use RCommonPlot3D qw ($gnuplot RCommonPlot3D);
+use RCommonPlot3D qw ($gnuplot RCommonPlot3D RCommonLoad3D RCommonLoadTraces3D);
 
 
 # See if gnuplot is installed:
@@ -192,7 +192,12 @@ $rps->{traces} = {
     eachText		=> 'showEach - 1',
     zScale			=> 1,
 	ticksText		=> 'showTicks - no',
-#	partsText		=> 'show - rod & line',
+	maxTraces		=> 300, # Empty or 0 to draw every trace in the time range, else at most this many.  Only the plot is thinned, the source data is untouched.
+	selectText		=> 'traceSelect - uniform',
+		# Which traces to keep when thinning:  uniform in time, or uniform in the motion of the rod and line, which keeps more of the traces where things move fast.
+	nodeTolerance	=> 0.25,    # Inches.  The rod and line polylines are drawn with as few nodes as keep them within this distance of the full ones.  Empty or 0 to draw every node.  Ignored when ticks are shown.
+	partsText		=> 'plotParts - rod & line',
+		# Which nodes to read and draw.  The rod alone is much less to read from a big source file.
 };
 
 
@@ -302,8 +307,12 @@ my @aTPlotEachItems = ("showEach - 1","showEach - 2","showEach - 3","showEach -
 my @aTicksItems = ("showTicks - no","showTicks - yes");
     $traces_fr->Optionmenu(-options=>\@aTicksItems,-textvariable=>\$rps->{traces}{ticksText},-relief=>'sunken',-width=>18)->grid(-row=>1,-column=>1,-padx=>60,-sticky=>'e');
     $traces_fr->LabEntry(-textvariable=>\$rps->{traces}{zScale},-label=>'zScale',-labelPack=>[qw/-side left/],-width=>8)->grid(-row=>0,-column=>2,-padx=>60,-sticky=>'e');
-#my @aPartsItems = ("plotParts - rod & line","plotParts - rod","plotParts - line");
-#    $traces_fr->Optionmenu(-options=>\@aPartsItems,-textvariable=>\$rps->{traces}{style},-relief=>'sunken')->grid(-row=>2,-column=>0,-sticky=>'e');
+    $traces_fr->LabEntry(-textvariable=>\$rps->{traces}{maxTraces},-label=>'maxTraces',-labelPack=>[qw/-side left/],-width=>8)->grid(-row=>1,-column=>2,-padx=>60,-sticky=>'e');
+my @aSelectItems = ("traceSelect - uniform","traceSelect - motion");
+    $traces_fr->Optionmenu(-options=>\@aSelectItems,-textvariable=>\$rps->{traces}{selectText},-relief=>'sunken',-width=>18)->grid(-row=>0,-column=>3,-padx=>20,-sticky=>'e');
+    $traces_fr->LabEntry(-textvariable=>\$rps->{traces}{nodeTolerance},-label=>'nodeTolerance(in)',-labelPack=>[qw/-side left/],-width=>8)->grid(-row=>1,-column=>3,-padx=>20,-sticky=>'e');
+my @aPartsItems = ("plotParts - rod & line","plotParts - rod");
+    $traces_fr->Optionmenu(-options=>\@aPartsItems,-textvariable=>\$rps->{traces}{partsText},-relief=>'sunken',-width=>18)->grid(-row=>2,-column=>1,-padx=>60,-sticky=>'e');
 
 
 
@@ -415,7 +424,9 @@ sub LoadSettings {
 }
 
 
-my ($inParamsStr,$numRodNodes,$inTs,$inXs,$inYs,$inZs,$inXLineTips,$inYLineTips,$inZLineTips,$inXLeaderTips,$inYLeaderTips,$inZLeaderTips,$plotBottom);
+my ($inParamsStr,$numRodNodes,$inTs,$inXLineTips,$inYLineTips,$inZLineTips,$inXLeaderTips,$inYLeaderTips,$inZLeaderTips,$plotBottom);
+my $inRun;
+    # The loaded source.  The node coords are taken from it with RCommonLoadTraces3D(), only for the traces plotted.
 
 my $inRunIdentifier;
 
@@ -424,112 +435,21 @@ sub LoadSource {
     
     if ($verbose>=1){print "Loading simulation data from $filename.\n"}        
 
-    my $ok = 0;
-    if ($filename){
-        if (-e $filename) {
+    ## Text (.txt) or binary (.rhb) output from either RHexSwing3D or RHexCast3D.  Binary arrays are memory maps of the file, and text files are loaded lazily, so the node coords are only read, and only for the traces in the time range, when they are plotted.
 
-            $ok = 1;
-            my ($nrows,$ncols);
-
-            $/ = undef;
-            open INFILE, "< $filename" or $ok = 0;
-            if (!$ok){warn $!;return 0}
-            my $inData = <INFILE>;
-            close INFILE;
-            
-            if (!($inData =~ /$rSwingOutFileTag/)){  # later, also cast.
-                warn "Error: $filename is not a recognized output file.\n";
-                return 0;
-            }
-            
-            if ($verbose>=2){pq $inData}
-            my $eh = "Error:  Could not load plot data from $filename - ";
-            my $et = "data not found or corrupted.\n";
-            
-            $inParamsStr = GetQuotedStringFromDataString($inData,"ParamsString");
-            if ($inParamsStr eq '')
-                {warn "$eh ParamsString $et";return 0};
-
-            $numRodNodes = GetValueFromDataString($inData,"NumRodNodes");
-            if ($numRodNodes eq '')
-                {warn "$eh NumRodNodes $et";return 0};
-
-            $inTs = GetMatFromDataString($inData,"PlotTs");
-#pq $inTs;
-            my ($nTimes,$unused) = $inTs->dims;    
-            if ($nTimes == 0 or defined($unused))
-                {warn "$eh PlotTs $et"; return 0};
-
-            $inXs = GetMatFromDataString($inData,"PlotXs");            
-#pq $inXs;
-            my ($nNodesX,$nTimesX) = $inXs->dims;
-            if (!defined($nTimesX)){$nTimesX = 1}   
-            if ($nNodesX == 0 or $nTimesX != $nTimes)
-                {warn "$eh PlotXs $et"; return 0};
-
-            $inYs = GetMatFromDataString($inData,"PlotYs");
-            my ($nNodesY,$nTimesY) = $inYs->dims;
-            if (!defined($nTimesY)){$nTimesY = 1}
-            #pq $inYs;
-            if ($nNodesY != $nNodesX or $nTimesY != $nTimes)
-            {warn "$eh PlotYs $et"; return 0};
-            if ($numRodNodes > $nNodesX)
-            {warn "$eh detected bad inNumRodNodes.\n"; return 0};
-            
-            $inZs = GetMatFromDataString($inData,"PlotZs");
-            my ($nNodesZ,$nTimesZ) = $inZs->dims;
-            if (!defined($nTimesZ)){$nTimesZ = 1}
-            #pq $inZs;
-            if ($nNodesZ != $nNodesX or $nTimesZ != $nTimes)
-            {warn "$eh PlotZs $et"; return 0};
-            if ($numRodNodes > $nNodesZ)
-            {warn "$eh detected bad inNumRodNodes.\n"; return 0};
-            
-            
-            $inXLineTips = GetMatFromDataString($inData,"PlotXLineTips");
-            ($ncols,$nrows) = $inXLineTips->dims;
-            if ($ncols != 1 or $nrows != $nTimes)
-            {warn "$eh PlotXLineTips $et"; return 0};
-            
-            $inYLineTips = GetMatFromDataString($inData,"PlotYLineTips");
-            ($ncols,$nrows) = $inYLineTips->dims;
-            if ($ncols != 1 or $nrows != $nTimes)
-            {warn "$eh PlotYLineTips $et"; return 0};
-            
-            $inZLineTips = GetMatFromDataString($inData,"PlotZLineTips");
-            ($ncols,$nrows) = $inZLineTips->dims;
-            if ($ncols != 1 or $nrows != $nTimes)
-            {warn "$eh PlotZLineTips $et"; return 0};
-            
-            $inXLeaderTips = GetMatFromDataString($inData,"PlotXLeaderTips");
-            ($ncols,$nrows) = $inXLeaderTips->dims;
-            if ($ncols != 1 or $nrows != $nTimes)
-            {warn "$eh PlotXLeaderTips $et"; return 0};
-            
-            $inYLeaderTips = GetMatFromDataString($inData,"PlotYLeaderTips");
-            ($ncols,$nrows) = $inYLeaderTips->dims;
-            if ($ncols != 1 or $nrows != $nTimes)
-            {warn "$eh PlotYLeaderTips $et"; return 0};
-            
-            $inZLeaderTips = GetMatFromDataString($inData,"PlotZLeaderTips");
-            ($ncols,$nrows) = $inZLeaderTips->dims;
-            if ($ncols != 1 or $nrows != $nTimes)
-            {warn "$eh PlotZLeaderTips $et"; return 0};
-            
-            $plotBottom = GetValueFromDataString($inData,"PlotBottom");
-            if ($plotBottom eq '')
-            {warn "$eh PlotBottom $et";return 0};
-            
-            #pq($inXLineTips,$inYLineTips,$inZLineTips,$inXLeaderTips,$inYLeaderTips,$inZLeaderTips);
-
-            $inRunIdentifier = GetWordFromDataString($inData,"RunIdentifier");
-            #pq($inRunIdentifier);
-            if (!defined($inRunIdentifier))
-               {warn "$eh RunIdentifier $et";return 0};
-
-        }else{ warn "Could not find $filename\n"}
-    }
-    return $ok;
+    my $run = RCommonLoad3D($filename,1);
+    if (!defined($run)){return 0}
+    $inRun = $run;
+
+    $inParamsStr        = $run->{ParamsString};
+    $numRodNodes        = $run->{NumRodNodes};
+    $plotBottom         = $run->{PlotBottom};
+    $inRunIdentifier    = $run->{RunIdentifier};
+    $inTs               = $run->{PlotTs};
+    ($inXLineTips,$inYLineTips,$inZLineTips,$inXLeaderTips,$inYLeaderTips,$inZLeaderTips) =
+        map {$run->{$_}} qw(PlotXLineTips PlotYLineTips PlotZLineTips PlotXLeaderTips PlotYLeaderTips PlotZLeaderTips);
+
+    return 1;
 }
 
 
@@ -566,7 +486,7 @@ sub OnSourceSelect {
 	my ($dirs,$filename) = StrictRel2Abs($rps->{file}{source},$exeDir);
 
     my $FSref = $mw->FileSelect(    -directory=>"$dirs",
-                                    -filter=>'(*.txt)');
+                                    -filter=>'(*.txt|*.rhb)');
     $FSref->geometry('700x500');        
     $filename = $FSref->Show;
     if ($filename){
@@ -649,14 +569,14 @@ sub OnPlot{
 			warn "- ERROR:  No loaded trace times in plot range.\n";
 			return;
 		}
-		if ($its(0)>$it0){$it0=$its(0)}
+		if ($its(0)>$it0){$it0=$its(0)->sclr}
 		
 		$its = which($inTs<=$t1);
 		if ($its->isempty){
 			warn "- ERROR:  No loaded trace times in plot range.\n";
 			return;
 		}
-		if ($its(-1)<$it1){$it1=$its(-1)}
+		if ($its(-1)<$it1){$it1=$its(-1)->sclr}
 		
 		#pq($it0,$it1);
 		#pq($inTs);
@@ -666,10 +586,18 @@ sub OnPlot{
            # Want to show actual time range in title.
     }
 
+    # Only the rod nodes if that's all that is to be shown:
+    my $partsText	= $rps->{traces}{partsText};
+    my $showLine	= (defined($partsText) and $partsText eq "plotParts - rod") ? 0 : 1;
+    my $nodes;
+    if (!$showLine){
+        if ($numRodNodes < 1){print "- ERROR: This run has no rod to plot on its own.\n"; return}
+        $nodes = sequence(long,$numRodNodes);
+    }
+
     $Ts = $inTs($it0:$it1:$iDelta);
-    $Xs = $inXs(:,$it0:$it1:$iDelta);
-    $Ys = $inYs(:,$it0:$it1:$iDelta);
-    $Zs = $inZs(:,$it0:$it1:$iDelta);
+    ($Xs,$Ys,$Zs) = RCommonLoadTraces3D($inRun,$it0,$it1,$iDelta,$nodes);
+    if (!defined($Xs)){print "- ERROR: Could not read the traces from the source.\n"; return}
 	
     #pq($inXLineTips,$inYLineTips,$inZLineTips,$inXLeaderTips,$inYLeaderTips,$inZLeaderTips);
     
@@ -691,10 +619,25 @@ sub OnPlot{
 	my $showTicks = ($ticksStr eq "yes")?1:0;
 	#pq($showTicks);
 
+	my $maxTraces = $rps->{traces}{maxTraces};
+	if (!defined($maxTraces) or $maxTraces eq ""){$maxTraces = 0}
+	if (!looks_like_number($maxTraces) or $maxTraces<0 or $maxTraces==1 or $maxTraces != int($maxTraces)){print "- ERROR: maxTraces must be empty, 0, or an integer at least 2\n"; return}
+
+	my $nodeTolerance = $rps->{traces}{nodeTolerance};
+	if (!defined($nodeTolerance) or $nodeTolerance eq ""){$nodeTolerance = 0}
+	if (!looks_like_number($nodeTolerance) or $nodeTolerance<0){print "- ERROR: nodeTolerance must be empty or a non-negative number\n"; return}
+
+	my $selectText = $rps->{traces}{selectText};
+	my $traceSelect = (defined($selectText) and $selectText ne '') ? substr($selectText,14) : "uniform";
+
     %opts = (	gnuplot		=> $gnuplot,
 				ZScale      => $zScale,
                 RodTicks    => $showTicks,
-                LineTicks   => $showTicks  );
+                LineTicks   => $showTicks,
+				ShowLine		=> $showLine,
+				MaxTraces		=> $maxTraces,
+				TraceSelect		=> $traceSelect,
+				NodeTolerance	=> $nodeTolerance  );
 
 	#TEST_FORK_EXEC();
 	#TEST_FORK_SYSTEM();
@@ -729,7 +672,7 @@ sub OnSaveOut{
 	
 	# Build the save filename from the current source:
 	my $filename = $rps->{file}{source};
-    $filename = fileparse($rps->{file}{source},'.txt');
+    $filename = fileparse($rps->{file}{source},'.txt','.rhb');
     $filename = "_".$filename."_Replot";
 	
 	# Start navigating where the last save was located:
@@ -882,6 +825,25 @@ showTicks - Show tick marks at the segment boundaries.
 
 zScale - A positive number in the range [1,5] that sets the vertical scale magnification
 relative to the fixed (and equal) X and Y scales.
+
+maxTraces - Empty, 0, or an integer at least 2.  If there are more traces left after the
+time range and showEach, draws only this many, always including the first and last.
+Long runs then stay quick to draw and rotate.  The data source is not changed.
+
+traceSelect - How maxTraces chooses:  uniform spaces the traces evenly in time, motion
+spaces them evenly in the accumulated movement of the rod and line, keeping more of
+them where things move fast.
+
+nodeTolerance - Empty or a non-negative number of inches.  Draws the rod and line with
+only as many nodes as keep them within this distance of the full polylines.  Ignored when
+ticks are shown.
+
+plotParts - Draw the rod and line, or the rod alone.
+
+Text sources are loaded lazily:  on Select & Load only the times and the small items are
+read, and PLOT reads just the traces in the time range, and just the rod if that is all
+that is drawn.  An index kept in the system temporary directory makes reopening a large
+source quick.
 )
 		)->pack;
 
@@ -957,6 +919,16 @@ showTicks - Show tick marks at the segment boundaries.
 
 zScale - A positive number in the range [1,5] that sets the vertical scale magnification relative to the fixed (and equal) X and Y scales.
 
+maxTraces - Empty, 0, or an integer at least 2.  If there are more traces left after the time range and showEach, draws only this many, always including the first and last.  Long runs then stay quick to draw and rotate.  The data source is not changed.
+
+traceSelect - How maxTraces chooses:  uniform spaces the traces evenly in time, motion spaces them evenly in the accumulated movement of the rod and line, keeping more of them where things move fast.
+
+nodeTolerance - Empty or a non-negative number of inches.  Draws the rod and line with only as many nodes as keep them within this distance of the full polylines.  Ignored when ticks are shown.
+
+plotParts - Draw the rod and line, or the rod alone.
+
+Text sources are loaded lazily:  on Select & Load only the times and the small items are read, and PLOT reads just the traces in the time range, and just the rod if that is all that is drawn.  An index kept in the system temporary directory makes reopening a large source quick.
+
 =head1 A USEFUL NOTE
 
 As with the swinging and casting programs, plots here persist while the program is running. To unclutter, rather than manually closing each, first save your parameters, and then just close the Terminal window that appeared when this program was launched.  That will cause all the plots to disappear.  Then simply relaunch this program.  Because you have saved the parameters, the new launch will start where the old one left off.
@@ -0,0 +1,533 @@
+#!/usr/bin/env perl
+
+# This shebang causes the first perl on the path to be used, which will be the perlbrew choice if using perlbrew.
+
+# RHexSweep3D.pl
+
+#################################################################################
+##
+## RHex - 3D dyanmic simulation of fly casting and swinging.
+## Copyright (C) 2019 Rich Miller <rich@ski.org>
+##
+## This file is part of RHex.
+##
+## RHex is free software: you can redistribute it and/or modify it under the
+## terms of the GNU General Public License as published by the Free Software
+## Foundation, either version 3 of the License, or (at your option) any later
+## version.
+##
+## RHex is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+## without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+## PURPOSE.  See the GNU General Public License for more details.
+##
+## You should have received a copy of the GNU General Public License along with RHex.
+## If not, see <https://www.gnu.org/licenses/>.
+##
+## RHex makes system calls to the Gnuplot executable, Copyright 1986 - 1993, 1998,
+## 2004 Thomas Williams, Colin Kelley.  It makes static links to the Gnu Scientific
+## Library, which is copyrighted and available under the GNU General Public License.
+## In addition, RHex incorporates code from the Perl core and numerous Perl libraries,
+## all of which are free software, redistributable and/or modifable under the same
+## terms as Perl itself (Perl License).  Finally, the modules Brent, DiffEq, and
+## Numjac in the directory RUtils are modifications and translations into Perl of
+## copyrighted material.  You can find the details in the individual files.
+##
+##################################################################################
+
+## Parameter sweep driver.  Reads a sweep file naming a base settings file and the parameters to vary, writes one settings file per run, and runs each one in its own RHexBatch3D process, several at a time.  The module globals in RHamilton3D, RCast3D and RSwing3D make it unsafe to run more than one integration in a process, so each run gets a fresh interpreter.  With -listen, runs are also handed out to RHexWorker3D processes, on this or other machines, that connect to us.
+#
+# Usage: RHexSweep3D[.pl] sweepFile outDir [-jobs n] [-timeout secs] [-retries n] [-verbose n] [-listen [host:]port] [-workerTimeout secs]
+#
+# The sweep file is in the same (Config::General) format as the settings files:
+#
+#   <sweep>
+#       runType     = swing                 # cast or swing.
+#       settings    = RHexSwing3D.prefs     # The base settings.  Relative to the sweep file.
+#       mode        = grid                  # grid, list or random.
+#       numDraws    = 20                    # random only.
+#       seed        = 1                     # random only.  Omit for a different sweep each time.
+#       timeout     = 600                   # secs per attempt, 0 for none.
+#       retries     = 1                     # extra attempts after a timeout or crash.
+#       binary      = 0                     # 1 for local runs to write binary (.rhb) data.  Remote runs always do.
+#   </sweep>
+#   <params>
+#       line.nomWtGrsPerFt      = 4:8:1             # lo:hi:step.
+#       integration.stepperName = msbdf_j, rk4imp   # A list.
+#       driver.startTime        = uniform(0,0.2)    # random only.  Also loguniform(lo,hi).
+#       file.line               = SpecFiles_Line/a.txt, SpecFiles_Line/b.txt
+#   </params>
+#
+# Parameter names are section.field, as in the settings files.  Spec file names are, as always, relative to the RHex directory.  In grid mode every combination of the lists and ranges is run, in list mode the lists (which must all have the same length) are run in parallel, and in random mode each of numDraws runs draws every parameter independently, choosing uniformly among list and range values.
+#
+# The output directory gets one run_NNNN subdirectory per run holding its settings file, its log, and the data and stats files RHexBatch3D writes, plus index.tsv with one line per run giving its status, attempts, solver counts and parameter values.  The index is rewritten as each run finishes.
+#
+# The number of simultaneous local runs defaults to the number of cores, or to none with -listen.
+#
+# With -listen, we accept worker connections on the port (on all interfaces unless host is given, so 127.0.0.1:port keeps everything on this machine).  Each idle worker is sent the next run's settings file together with the spec files it names, and sends back the binary (.rhb) data, stats and log, which land in the run's directory just as for a local run.  A busy worker that has not been heard from for workerTimeout seconds (default 30) is dropped and its run requeued, which counts as an attempt.  The per-attempt timeout is enforced by the worker.  See RHexWorker3D and RCommonSweep.
+
+use warnings;
+use strict;
+
+our $VERSION='0.01';
+
+our $OS;
+our ($exeName,$exeDir,$basename,$suffix);
+our $launchDir;
+use File::Basename;
+use Cwd;
+
+BEGIN {
+	$exeName = $0;
+
+	($basename,$exeDir,$suffix) = fileparse($exeName,'.pl');
+
+	$launchDir = getcwd();
+	chdir "$exeDir";  # See perldoc -f chdir.
+
+	chomp($OS = `echo $^O`);
+}
+
+use lib ($exeDir);
+
+use Carp;
+use Getopt::Long;
+use POSIX qw (:sys_wait_h);
+use Time::HiRes qw (time sleep);
+use Config::General;
+use File::Path qw (make_path);
+use File::Copy;
+use File::Spec::Functions qw ( rel2abs );
+use IO::Socket::INET;
+use IO::Select;
+
+use RCommonSweep;
+
+
+my $batchExe		= rel2abs('RHexBatch3D.pl',$exeDir);
+my $killGraceSecs	= 5;
+my $pollSecs		= 0.2;
+
+
+my $usage = "\n$0: Usage:RHexSweep3D[.pl] sweepFile outDir [-jobs n] [-timeout secs] [-retries n] [-verbose n] [-listen [host:]port] [-workerTimeout secs]\n";
+
+my %opts;
+if (!GetOptions(\%opts,'jobs=i','timeout=f','retries=i','verbose=i','listen=s','workerTimeout=f') or @ARGV != 2){
+	print STDERR $usage;
+	exit 1;
+}
+
+my $sweepFile	= rel2abs($ARGV[0],$launchDir);
+my $outDir		= rel2abs($ARGV[1],$launchDir);
+
+
+sub ParseValueSpec {
+	my ($key,$spec,$mode) = @_;
+
+	## Returns {kind=>'list',values=>[...]} or {kind=>'uniform'|'loguniform',lo=>,hi=>}.  Ranges become lists.
+
+	my $num = qr/[-+]?(?:\d+\.?\d*|\.\d+)(?:[eE][-+]?\d+)?/;
+
+	if ($spec =~ /^\s*(uniform|loguniform)\s*\(\s*($num)\s*,\s*($num)\s*\)\s*$/){
+		my ($kind,$lo,$hi) = ($1,$2,$3);
+		if ($mode ne 'random'){die "ERROR: $key = $spec - Random draws are only allowed in random mode.\nStopped"}
+		if ($hi < $lo or ($kind eq 'loguniform' and $lo <= 0)){die "ERROR: $key = $spec - Bad bounds.\nStopped"}
+		return {kind=>$kind,lo=>$lo,hi=>$hi};
+	}
+
+	if ($spec =~ /^\s*($num)\s*:\s*($num)\s*:\s*($num)\s*$/){
+		my ($lo,$hi,$step) = ($1,$2,$3);
+		if ($step <= 0 or $hi < $lo){die "ERROR: $key = $spec - Need lo <= hi and step > 0.\nStopped"}
+		my $numSteps = int(($hi-$lo)/$step + 1e-9);
+		return {kind=>'list',values=>[map {sprintf("%.10g",$lo+$_*$step)} (0..$numSteps)]};
+			# Multiplying rather than accumulating keeps the values exact to the step.
+	}
+
+	my @values = map {s/^\s+|\s+$//gr} split(/,/,$spec);
+	if (!@values){die "ERROR: $key - Empty value list.\nStopped"}
+	return {kind=>'list',values=>\@values};
+}
+
+
+sub DrawValue {
+	my ($param) = @_;
+
+	if ($param->{kind} eq 'list'){
+		my $values = $param->{values};
+		return $values->[int(rand(scalar(@$values)))];
+	}
+	my ($lo,$hi) = ($param->{lo},$param->{hi});
+	my $val = ($param->{kind} eq 'uniform') ?
+		$lo + rand()*($hi-$lo) : exp(log($lo) + rand()*(log($hi)-log($lo)));
+	return sprintf("%.10g",$val);
+}
+
+
+sub MakeRuns {
+	my ($mode,$keys,$params,$numDraws) = @_;
+
+	## Returns a list of hashes of parameter values, one per run.
+
+	my @runs;
+	if ($mode eq 'grid'){
+		@runs = ({});
+		foreach my $key (@$keys){
+			my @next;
+			foreach my $run (@runs){
+				foreach my $val (@{$params->{$key}{values}}){
+					push @next, {%$run,$key=>$val};
+				}
+			}
+			@runs = @next;
+		}
+	} elsif ($mode eq 'list'){
+		my $numRuns = scalar(@{$params->{$keys->[0]}{values}});
+		foreach my $key (@$keys){
+			if (@{$params->{$key}{values}} != $numRuns){die "ERROR: In list mode all the parameters must have the same number of values.\nStopped"}
+		}
+		for (my $ii=0;$ii<$numRuns;$ii++){
+			push @runs, {map {$_=>$params->{$_}{values}[$ii]} @$keys};
+		}
+	} elsif ($mode eq 'random'){
+		if (!$numDraws or $numDraws < 1){die "ERROR: Random mode needs numDraws >= 1.\nStopped"}
+		for (my $ii=0;$ii<$numDraws;$ii++){
+			push @runs, {map {$_=>DrawValue($params->{$_})} @$keys};
+		}
+	} else {
+		die "ERROR: Unknown sweep mode \"$mode\".  Use grid, list or random.\nStopped";
+	}
+	return @runs;
+}
+
+
+# Read the sweep file:
+if (!-e $sweepFile){die "ERROR: Sweep file $sweepFile not found.\nStopped"}
+my %sweepSrc	= Config::General->new($sweepFile)->getall();
+my $sweep		= $sweepSrc{sweep};
+my $paramSrc	= $sweepSrc{params};
+if (!$sweep or !$paramSrc or !%$paramSrc){die "ERROR: Sweep file $sweepFile needs <sweep> and <params> blocks.\nStopped"}
+
+my $runType = $sweep->{runType} // '';
+if ($runType ne 'cast' and $runType ne 'swing'){die "ERROR: Sweep runType must be cast or swing.\nStopped"}
+my $tStr	= ($runType eq 'cast') ? 'rCast' : 'rSwing';
+
+my $mode	= $sweep->{mode} // 'grid';
+my $timeout	= (defined($opts{timeout})) ? $opts{timeout} : ($sweep->{timeout} // 0);
+my $retries	= (defined($opts{retries})) ? $opts{retries} : ($sweep->{retries} // 1);
+my $numJobs	= (defined($opts{jobs})) ? $opts{jobs} : (($opts{listen}) ? 0 : NumCores());
+my $workerTimeout = $opts{workerTimeout} || 30;
+if ($numJobs < 1 and !$opts{listen}){die "ERROR: Need at least one job, or workers.\nStopped"}
+my $childVerbose = (defined($opts{verbose})) ? $opts{verbose} : 1;
+my @childFormat	= ($sweep->{binary}) ? ('-binary') : ();
+if (defined($sweep->{seed})){srand($sweep->{seed})}
+
+my $baseFile = rel2abs($sweep->{settings} // '',dirname($sweepFile));
+if (!-e $baseFile){die "ERROR: Base settings file $baseFile not found.\nStopped"}
+my %baseSettings = Config::General->new($baseFile)->getall();
+if (!exists($baseSettings{file}{$tStr})){die "ERROR: $baseFile is not an $tStr settings file.\nStopped"}
+
+my @keys = sort keys %$paramSrc;
+my %params;
+foreach my $key (@keys){
+	if ($key !~ /^(\w+)\.(\w+)$/){die "ERROR: Parameter name $key must have the form section.field.\nStopped"}
+	if (!exists($baseSettings{$1}) or !exists($baseSettings{$1}{$2})){
+		print "WARNING: $key is not in the base settings.  It will be added, but check the spelling.\n";
+	}
+	$params{$key} = ParseValueSpec($key,$paramSrc->{$key},$mode);
+}
+
+my @runs = MakeRuns($mode,\@keys,\%params,$sweep->{numDraws});
+printf("Sweep: %d %s runs, mode %s, %d at a time locally\n",scalar(@runs),$runType,$mode,$numJobs);
+
+
+# Lay out the output directory:
+make_path($outDir);
+copy($sweepFile,"$outDir/sweep.txt");
+
+my @jobs;
+for (my $ii=0;$ii<@runs;$ii++){
+	my $runDir = sprintf("%s/run_%04d",$outDir,$ii);
+	make_path($runDir);
+
+	# Two level copy, so the base is untouched:
+	my %settings = map {$_ => (ref($baseSettings{$_}) eq 'HASH') ? {%{$baseSettings{$_}}} : $baseSettings{$_}} keys %baseSettings;
+	foreach my $key (@keys){
+		my ($section,$field) = split(/\./,$key);
+		$settings{$section}{$field} = $runs[$ii]{$key};
+	}
+	$settings{file}{settings} = "$runDir/settings.prefs";
+	Config::General->new(\%settings)->save_file("$runDir/settings.prefs");
+
+	push @jobs, {index=>$ii,dir=>$runDir,values=>$runs[$ii],attempts=>0,status=>'pending'};
+}
+
+
+sub WriteIndex {
+
+	## Rewritten whole after each run finishes, so it is always complete up to that point.
+	my @statKeys = qw(elapsedSecs solverStatus DE_numCalls DEfunc_numCalls DEjac_numCalls);
+
+	open INDEXFILE,"> $outDir/index.tsv" or die $!;
+	print INDEXFILE join("\t",'index','status','exitCode','attempts',@statKeys,@keys,'dataFile')."\n";
+	foreach my $job (@jobs){
+		my $stats = $job->{stats} // {};
+		my ($dataFile) = grep {-e $_} map {"$job->{dir}/result$_"} ('.txt','.rhb');
+		if (!defined($dataFile)){$dataFile = ''}
+		print INDEXFILE join("\t",$job->{index},$job->{status},$job->{exitCode} // '',$job->{attempts},
+			(map {$stats->{$_} // ''} @statKeys),(map {$job->{values}{$_}} @keys),$dataFile)."\n";
+	}
+	close INDEXFILE;
+}
+
+
+sub ReadStats {
+	my ($filename) = @_;
+
+	my %stats;
+	if (open(my $fh,'<',$filename)){
+		while (my $line = <$fh>){
+			chomp($line);
+			my ($key,$val) = split(/\t/,$line,2);
+			if (defined($key)){$stats{$key} = $val}
+		}
+		close $fh;
+	}
+	return \%stats;
+}
+
+
+sub StartJob {
+	my ($job) = @_;
+
+	$job->{attempts}++;
+	$job->{status} = 'running';
+
+	my $pid = fork();
+	if (!defined($pid)){die "ERROR: Could not fork: $!\nStopped"}
+	if (!$pid){
+		# Child.  Send all its output to the run's log:
+		open(STDOUT,'>>',"$job->{dir}/run.log") or exit 4;
+		open(STDERR,'>&',\*STDOUT) or exit 4;
+		exec($^X,$batchExe,$runType,"$job->{dir}/settings.prefs",'-out',"$job->{dir}/result",@childFormat,'-verbose',$childVerbose);
+		exit 4;
+	}
+	return $pid;
+}
+
+
+sub WorkBundle {
+	my ($job) = @_;
+
+	## The run's settings file and every spec file it names, for a worker that may share no files with us.  Spec bundle names start with the settings field, so the worker knows which is which.
+	my %settings = Config::General->new("$job->{dir}/settings.prefs")->getall();
+	my %paths = ('settings.prefs' => "$job->{dir}/settings.prefs");
+	foreach my $key (qw(rod line leader driver)){
+		my $file = $settings{file}{$key};
+		if (defined($file) and $file ne '' and -e $file){$paths{"$key.".basename($file)} = $file}
+	}
+	return BundleFromFiles(%paths);
+}
+
+
+WriteIndex();
+
+my @queue = @jobs;
+my %running;	# pid => {job, start, killedAt}
+my $numDone = 0;
+
+
+sub AttemptStatus {
+	my ($killed,$signal,$exitCode) = @_;
+
+	## Returns the status, the exit code for the index, and whether a retry may help.  Timeouts, crashes and unexpected deaths may be transient.  Bad settings and solver failures are not:
+	if ($killed){return ('timeout','',1)}
+	if ($signal){return ("signal$signal",'',1)}
+	return ($batchStatusNames{$exitCode} // "exit$exitCode",$exitCode,($exitCode == 4) ? 1 : 0);
+}
+
+
+sub EndAttempt {
+	my ($job,$status,$exitCode,$retry) = @_;
+
+	if ($retry and $job->{attempts} <= $retries){
+		print "Run $job->{index}: $status, retrying.\n";
+		push @queue, $job;
+		return;
+	}
+
+	$job->{status}		= $status;
+	$job->{exitCode}	= $exitCode;
+	$job->{stats}		= ReadStats("$job->{dir}/result.stats");
+	$numDone++;
+	printf("Run %d: %s (%d of %d done)\n",$job->{index},$status,$numDone,scalar(@jobs));
+	WriteIndex();
+}
+
+
+my ($listenSock,$select);
+my %workers;	# fileno => {conn, name, job}
+
+if ($opts{listen}){
+	if ($opts{listen} !~ /^(?:(.+):)?(\d+)$/){die "ERROR: -listen takes [host:]port.\nStopped"}
+	my ($host,$port) = ($1 // '0.0.0.0',$2);
+	$listenSock = IO::Socket::INET->new(LocalAddr=>$host,LocalPort=>$port,Proto=>'tcp',Listen=>16,ReuseAddr=>1)
+		or die "ERROR: Could not listen on $host:$port: $@\nStopped";
+	$select = IO::Select->new($listenSock);
+	print "Listening for workers on $host:$port\n";
+}
+
+
+sub DropWorker {
+	my ($worker,$why) = @_;
+
+	$select->remove($worker->{conn}{sock});
+	delete $workers{fileno($worker->{conn}{sock})};
+	close($worker->{conn}{sock});
+
+	my $job = $worker->{job};
+	if ($job){
+		print "Worker $worker->{name} $why during run $job->{index}.\n";
+		EndAttempt($job,'workerLost','',1);
+	} else {
+		print "Worker $worker->{name} $why.\n";
+	}
+}
+
+
+sub ServeWorkers {
+
+	## Accepts workers, collects their results, and hands the idle ones the next runs.  Waits up to $pollSecs for something to happen, so it takes the place of the main loop's sleep.
+
+	foreach my $sock ($select->can_read($pollSecs)){
+		if ($sock == $listenSock){
+			my $client = $listenSock->accept();
+			if (!$client){next}
+			$select->add($client);
+			$workers{fileno($client)} = {conn=>NetConnNew($client),name=>$client->peerhost.':'.$client->peerport,job=>undef};
+			next;
+		}
+
+		my $worker = $workers{fileno($sock)};
+		my $msgs = NetReceive($worker->{conn});
+		if (!defined($msgs)){DropWorker($worker,'disconnected'); next}
+
+		# HEARTBEAT needs nothing beyond the lastHeard time NetReceive() keeps:
+		foreach my $msg (@$msgs){
+			my ($word,$args,$payload) = @$msg;
+			if ($word eq 'HELLO'){
+				$worker->{name} = $args->[0].'@'.$worker->{name};
+				print "Worker $worker->{name} connected.\n";
+			} elsif ($word eq 'RESULT'){
+				my ($index,$killed,$signal,$exitCode) = @$args;
+				my $job = $worker->{job};
+				if (!$job or $job->{index} != $index){next}
+				$worker->{job} = undef;
+				if (!eval {BundleToDir($payload,$job->{dir},qr/^run\.log$/); 1}){print "WARNING: Bad result from worker $worker->{name}: $@"}
+				EndAttempt($job,AttemptStatus($killed,$signal,$exitCode));
+			}
+		}
+	}
+
+	# A busy worker that has gone quiet is presumed dead, or cut off:
+	my $now = time();
+	foreach my $worker (values %workers){
+		if ($worker->{job} and $now-$worker->{conn}{lastHeard} > $workerTimeout){DropWorker($worker,"went silent")}
+	}
+
+	foreach my $worker (values %workers){
+		if ($worker->{job} or !@queue){next}
+		my $job = shift @queue;
+		$job->{attempts}++;
+		$job->{status}		= 'running';
+		$worker->{job}		= $job;
+		$worker->{conn}{lastHeard} = $now;
+		if (!NetSend($worker->{conn},'JOB',[$job->{index},$runType,$timeout],WorkBundle($job))){
+			DropWorker($worker,'could not be sent its run');
+		}
+	}
+}
+
+
+while (@queue or %running or grep {$_->{job}} values %workers){
+
+	while (@queue and keys(%running) < $numJobs){
+		my $job = shift @queue;
+		my $pid = StartJob($job);
+		$running{$pid} = {job=>$job,start=>time(),killedAt=>0};
+	}
+
+	my $pid = waitpid(-1,WNOHANG);
+	if ($pid > 0 and exists($running{$pid})){
+		my $entry	= delete $running{$pid};
+		EndAttempt($entry->{job},AttemptStatus($entry->{killedAt},$? & 127,$? >> 8));
+		next;
+	}
+
+	# Enforce the per-attempt time limit, politely first:
+	if ($timeout){
+		my $now = time();
+		foreach my $pid (keys %running){
+			my $entry = $running{$pid};
+			if (!$entry->{killedAt} and $now-$entry->{start} > $timeout){
+				kill('TERM',$pid);
+				$entry->{killedAt} = $now;
+			} elsif ($entry->{killedAt} and $now-$entry->{killedAt} > $killGraceSecs){
+				kill('KILL',$pid);
+			}
+		}
+	}
+
+	if ($listenSock){ServeWorkers()}
+	else {sleep($pollSecs)}
+}
+
+foreach my $worker (values %workers){
+	NetSend($worker->{conn},'DONE',[]);
+	close($worker->{conn}{sock});
+}
+
+my $numOk = grep {$_->{status} eq 'ok'} @jobs;
+printf("Sweep finished: %d of %d runs ok.  Index in %s/index.tsv\n",$numOk,scalar(@jobs),$outDir);
+
+exit(($numOk == @jobs) ? 0 : 3);
+
+
+__END__
+
+=head1 NAME
+
+RHexSweep3D - Run many RHexBatch3D cast or swing runs over a grid, list or random draw of parameter values, several at a time.
+
+=head1 SYNOPSIS
+
+  perl RHexSweep3D.pl SpecFiles_Preference/RHexSwing3D_Sweep.txt sweeps/lineWeights -jobs 8 -timeout 900
+
+=head1 DESCRIPTION
+
+See the comments at the top of this file for the sweep file format and the layout of the output directory.
+
+=head1 AUTHOR
+
+Rich Miller, E<lt>rich@ski.orgE<gt>
+
+=head1 COPYRIGHT AND LICENSE
+
+RHex - 3D dyanmic simulation of fly casting and swinging.
+
+Copyright (C) 2019 Rich Miller
+
+This file is part of RHex.
+
+RHex is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RHex is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RHex.  If not, see <https://www.gnu.org/licenses/>.
+
+=cut
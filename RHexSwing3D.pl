@@ -373,7 +373,7 @@ our @driverFields;
     $driver_fr->LabEntry(-textvariable=>\$rps->{driver}{laydownIntervalSec},-label=>'laydownInterval(sec)',-labelPack=>[qw/-side left/],-width=>12)->grid(-row=>0,-column=>0,-sticky=>'e');
     $driver_fr->LabEntry(-textvariable=>\$rps->{driver}{sinkIntervalSec},-label=>'sinkInterval(sec)',-labelPack=>[qw/-side left/],-width=>12)->grid(-row=>1,-column=>0,-sticky=>'e');
     $driver_fr->LabEntry(-textvariable=>\$rps->{driver}{stripRateFtPerSec},-label=>'stripRate(ft/sec)',-labelPack=>[qw/-side left/],-width=>12)->grid(-row=>2,-column=>0,-sticky=>'e');
-    $driver_fr->Label(-text=>'',-width=>8)->grid(-row=>3,-column=>0,-sticky=>'e');
+    $driver_fr->Checkbutton(-variable=>\$rps->{driver}{continuousStripping},-text=>'continuousStripping',-anchor=>'center',-offrelief=>'groove')->grid(-row=>3,-column=>0);
 
     $driver_fr->LabEntry(-textvariable=>\$rps->{driver}{startCoordsFt},-label=>'tipStartCoords(ft)',-labelPack=>[qw/-side left/],-width=>12)->grid(-row=>4,-column=>0,-sticky=>'e');
     $driverFields[0] = $driver_fr->LabEntry(-textvariable=>\$rps->{driver}{endCoordsFt},-label=>'tipEndCoords(ft)',-labelPack=>[qw/-side left/],-width=>12)->grid(-row=>5,-column=>0,-sticky=>'e');
@@ -408,8 +408,9 @@ our @driverFields;
         my $saveOptionsMenu = $saveOptionsMB->Menu();
             $saveOptionsMenu->add('checkbutton',-label=>'plot',-variable=>\$rps->{integration}{savePlot});        
             $saveOptionsMenu->add('checkbutton',-label=>'data',-variable=>\$rps->{integration}{saveData});    
+            $saveOptionsMenu->add('checkbutton',-label=>'binary data',-variable=>\$rps->{integration}{saveBinary});
         $saveOptionsMB->configure(-menu=>$saveOptionsMenu);   # Attach menu to button.
-    $int_fr->Label(-text=>'',-width=>8)->grid(-row=>11,-column=>0,-sticky=>'e');
+    $int_fr->Checkbutton(-variable=>\$rps->{integration}{livePlot},-text=>'livePlot',-anchor=>'center',-offrelief=>'groove')->grid(-row=>11,-column=>0);
 
 our @verboseFields;
 
@@ -923,6 +924,10 @@ saveOptions - When you hit the Save Out button if the \"plot\" box is checked (c
 	editor, and you can read the actual coordinate numbers that define the traces, as well as the parameter
 	settings that gave rise to those traces.  In addition, that file can be opened in RHexReplot3D, and from there
 	replotted in live, rotatable form.
+
+livePlot - If checked (colored red), a separate window shows the traces as the solver computes them, redrawn at
+	most livePlotFPS times a second (set in the settings file).  A run that goes bad early can then be seen at once
+	and stopped with PAUSE.  The window closes when the run ends, and the usual plot takes its place.
 }
 		)->pack;
 
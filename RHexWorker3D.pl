@@ -0,0 +1,270 @@
+#!/usr/bin/env perl
+
+# This shebang causes the first perl on the path to be used, which will be the perlbrew choice if using perlbrew.
+
+# RHexWorker3D.pl
+
+#################################################################################
+##
+## RHex - 3D dyanmic simulation of fly casting and swinging.
+## Copyright (C) 2019 Rich Miller <rich@ski.org>
+##
+## This file is part of RHex.
+##
+## RHex is free software: you can redistribute it and/or modify it under the
+## terms of the GNU General Public License as published by the Free Software
+## Foundation, either version 3 of the License, or (at your option) any later
+## version.
+##
+## RHex is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+## without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+## PURPOSE.  See the GNU General Public License for more details.
+##
+## You should have received a copy of the GNU General Public License along with RHex.
+## If not, see <https://www.gnu.org/licenses/>.
+##
+## RHex makes system calls to the Gnuplot executable, Copyright 1986 - 1993, 1998,
+## 2004 Thomas Williams, Colin Kelley.  It makes static links to the Gnu Scientific
+## Library, which is copyrighted and available under the GNU General Public License.
+## In addition, RHex incorporates code from the Perl core and numerous Perl libraries,
+## all of which are free software, redistributable and/or modifable under the same
+## terms as Perl itself (Perl License).  Finally, the modules Brent, DiffEq, and
+## Numjac in the directory RUtils are modifications and translations into Perl of
+## copyrighted material.  You can find the details in the individual files.
+##
+##################################################################################
+
+## Remote worker for RHexSweep3D.  Connects to a sweep coordinator started with -listen, and runs the runs it is sent, each in its own RHexBatch3D process in a scratch directory, returning the binary data, stats and log.  While a run is going it sends a heartbeat every few seconds, so the coordinator can tell a slow run from a dead worker.  Exits when the coordinator says there is no more work, or goes away.
+#
+# Usage: RHexWorker3D[.pl] host:port [-jobs n] [-heartbeat secs] [-connectSecs secs] [-verbose n]
+#
+#   -jobs n
+#           Number of runs to take on at once, each over its own connection.  Defaults to the number of cores.
+#   -heartbeat secs
+#           Seconds between heartbeats.  Default 5.  Keep it well under the coordinator's -workerTimeout.
+#   -connectSecs secs
+#           How long to keep trying to reach the coordinator before giving up.  Default 60.
+#   -verbose n
+#           The runs' verbosity.  Default 1.
+#
+# For testing, the coordinator and workers can all run on one machine:
+#
+#   perl RHexSweep3D.pl mySweep.txt sweeps/test -listen 127.0.0.1:7788
+#   perl RHexWorker3D.pl 127.0.0.1:7788 -jobs 2
+
+use warnings;
+use strict;
+
+our $VERSION='0.01';
+
+our $OS;
+our ($exeName,$exeDir,$basename,$suffix);
+use File::Basename;
+
+BEGIN {
+	$exeName = $0;
+
+	($basename,$exeDir,$suffix) = fileparse($exeName,'.pl');
+
+	chdir "$exeDir";  # See perldoc -f chdir.
+
+	chomp($OS = `echo $^O`);
+}
+
+use lib ($exeDir);
+
+use Carp;
+use Getopt::Long;
+use POSIX qw (:sys_wait_h);
+use Time::HiRes qw (time sleep);
+use File::Temp qw (tempdir);
+use File::Path qw (remove_tree);
+use File::Spec::Functions qw ( rel2abs );
+use Sys::Hostname;
+use IO::Socket::INET;
+use IO::Select;
+
+use RCommonSweep;
+
+
+my $batchExe		= rel2abs('RHexBatch3D.pl',$exeDir);
+my $killGraceSecs	= 5;
+my $pollSecs		= 0.2;
+
+
+my $usage = "\n$0: Usage:RHexWorker3D[.pl] host:port [-jobs n] [-heartbeat secs] [-connectSecs secs] [-verbose n]\n";
+
+my %opts;
+if (!GetOptions(\%opts,'jobs=i','heartbeat=f','connectSecs=f','verbose=i') or @ARGV != 1
+		or $ARGV[0] !~ /^(.+):(\d+)$/){
+	print STDERR $usage;
+	exit 1;
+}
+my ($host,$port)	= ($1,$2);
+my $numJobs			= $opts{jobs} || NumCores();
+my $heartbeatSecs	= $opts{heartbeat} || 5;
+my $connectSecs		= (defined($opts{connectSecs})) ? $opts{connectSecs} : 60;
+my $childVerbose	= (defined($opts{verbose})) ? $opts{verbose} : 1;
+
+
+sub Connect {
+
+	## The coordinator may not be up yet.
+	my $giveUp = time()+$connectSecs;
+	while (1){
+		my $sock = IO::Socket::INET->new(PeerAddr=>$host,PeerPort=>$port,Proto=>'tcp');
+		if ($sock){return NetConnNew($sock)}
+		if (time() > $giveUp){die "ERROR: Could not reach the coordinator at $host:$port: $@\nStopped"}
+		sleep(1);
+	}
+}
+
+
+sub RunJob {
+	my ($conn,$select,$index,$runType,$timeout,$bundle) = @_;
+
+	## Runs one work item, heartbeating meanwhile, and returns the RESULT args and payload.  Returns nothing if the coordinator went away, in which case the run has been killed.
+
+	my $dir		= tempdir("RHexWorker_XXXXXX",TMPDIR=>1);
+	my $paths	= BundleToDir($bundle,$dir);
+
+	my @specArgs;
+	foreach my $name (sort keys %$paths){
+		if ($name =~ /^(rod|line|leader|driver)\./){push @specArgs,"-$1",$paths->{$name}}
+	}
+
+	my $pid = fork();
+	if (!defined($pid)){die "ERROR: Could not fork: $!\nStopped"}
+	if (!$pid){
+		open(STDOUT,'>>',"$dir/run.log") or exit 4;
+		open(STDERR,'>&',\*STDOUT) or exit 4;
+		exec($^X,$batchExe,$runType,$paths->{'settings.prefs'},@specArgs,'-out',"$dir/result",'-binary','-verbose',$childVerbose);
+		exit 4;
+	}
+
+	my ($start,$lastBeat,$killedAt) = (time(),time(),0);
+	while (1){
+		if (waitpid($pid,WNOHANG) == $pid){last}
+
+		my $now = time();
+		if ($now-$lastBeat >= $heartbeatSecs){
+			if (!NetSend($conn,'HEARTBEAT',[$index])){$killedAt = -1}
+			$lastBeat = $now;
+		}
+
+		# Nothing more is expected from the coordinator during a run, so readable means it has closed:
+		if ($killedAt >= 0 and $select->can_read(0) and !defined(NetReceive($conn))){$killedAt = -1}
+
+		if ($killedAt < 0){
+			kill('KILL',$pid);
+			waitpid($pid,0);
+			remove_tree($dir);
+			return;
+		}
+
+		if ($timeout and !$killedAt and $now-$start > $timeout){
+			kill('TERM',$pid);
+			$killedAt = $now;
+		} elsif ($killedAt and $now-$killedAt > $killGraceSecs){
+			kill('KILL',$pid);
+		}
+
+		sleep($pollSecs);
+	}
+
+	my @result = ($index,($killedAt) ? 1 : 0,$? & 127,$? >> 8);
+	my $payload = BundleFromFiles(map {$_ => "$dir/$_"} qw(result.rhb result.stats run.log));
+	remove_tree($dir);
+	return (\@result,$payload);
+}
+
+
+sub WorkerLoop {
+	my ($slot) = @_;
+
+	my $conn	= Connect();
+	my $select	= IO::Select->new($conn->{sock});
+	NetSend($conn,'HELLO',[hostname()."#$slot"]);
+
+	while (1){
+		my $msgs = NetReceive($conn);
+		if (!defined($msgs)){print "Coordinator closed the connection.\n"; return}
+
+		foreach my $msg (@$msgs){
+			my ($word,$args,$payload) = @$msg;
+			if ($word eq 'DONE'){return}
+			if ($word ne 'JOB'){next}
+
+			my ($index,$runType,$timeout) = @$args;
+			print "Slot $slot: starting run $index.\n";
+			my ($result,$resultPayload) = RunJob($conn,$select,$index,$runType,$timeout,$payload);
+			if (!defined($result)){print "Coordinator went away during run $index.\n"; return}
+			if (!NetSend($conn,'RESULT',$result,$resultPayload)){return}
+			print "Slot $slot: finished run $index.\n";
+		}
+	}
+}
+
+
+print "RHex worker, $numJobs slot(s), coordinator $host:$port\n";
+
+my %slots;
+for (my $slot=0;$slot<$numJobs;$slot++){
+	my $pid = fork();
+	if (!defined($pid)){die "ERROR: Could not fork: $!\nStopped"}
+	if (!$pid){
+		WorkerLoop($slot);
+		exit 0;
+	}
+	$slots{$pid} = $slot;
+}
+
+while (%slots){
+	my $pid = wait();
+	if ($pid < 0){last}
+	delete $slots{$pid};
+}
+
+exit 0;
+
+
+__END__
+
+=head1 NAME
+
+RHexWorker3D - Take runs from an RHexSweep3D coordinator over the network, and send back the results.
+
+=head1 SYNOPSIS
+
+  perl RHexWorker3D.pl sweephost.example.org:7788 -jobs 16
+
+=head1 DESCRIPTION
+
+See the comments at the top of this file, and of RHexSweep3D.pl.  The worker needs only the RHex code, not the spec files, which come with each run.
+
+=head1 AUTHOR
+
+Rich Miller, E<lt>rich@ski.orgE<gt>
+
+=head1 COPYRIGHT AND LICENSE
+
+RHex - 3D dyanmic simulation of fly casting and swinging.
+
+Copyright (C) 2019 Rich Miller
+
+This file is part of RHex.
+
+RHex is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+RHex is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with RHex.  If not, see <https://www.gnu.org/licenses/>.
+
+=cut
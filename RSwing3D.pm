@@ -78,6 +78,7 @@ use RCommon;
 use RCommonLoad;
 use RHamilton3D;
 use RCommonPlot3D;
+use RCommonCache;
 
 
 # Run params ==================================
@@ -160,6 +161,10 @@ $rps->{ambient} = {
         # Set to 1 to include effect of vertical gravity, 0 is no gravity, any value ok.
     dragSpecsNormal          => "24,-1,1",
     dragSpecsAxial           => "1,-1,0.01",
+    dragVariation            => 0,
+        # If positive, the drag on each segment is multiplied by its own random factor, with mean 1 and this standard deviation, drawn once per run.  A crude stand-in for turbulence and other unresolved variation in the flow.
+    dragSeed                 => 1,
+        # Seeds the drag variation draws, so a run can be repeated exactly.
     # RE in [25,5K], Wolfram given very nearly constant 1.0., this per unit length.
     #    CDragAirAxial         => 0.010,   # 0.008(smooth)-0.011(rough) from OrcaFlex, but water, air?
 };
@@ -192,6 +197,8 @@ $rps->{driver} = {
 
     sinkIntervalSec         => 20,
     stripRateFtPerSec       => 2,
+    continuousStripping     => 0,
+        # If set, strip by resampling the whole line rather than by using up and dropping segments, so there are no solver restarts.
 
     startCoordsFt           => "0,-30,0",
     endCoordsFt             => "10,-40,0",
@@ -203,6 +210,10 @@ $rps->{driver} = {
     velocitySkewness        => 0,   # Positive is faster later later.
 
 	smoothingOrder			=> 8,
+	smoothingMethod			=> "fourier",
+		# "fourier" fits sines and cosines up to smoothingOrder.  "savgol" is Savitzky-Golay smoothing, with smoothingOrder the polynomial order, for very long tracks.
+	savGolHalfWidth			=> 10,
+		# Points on each side of center in the savgol window.
     showTrackPlot           => 1,
 };
 
@@ -219,6 +230,33 @@ $rps->{integration} = {
     plotZScale      => 1.0,
     
     stepperName     => "msbdf_j",
+    energyAccounting    => 0,
+        # If set, keep a record of the kinetic and elastic energies and the cumulative work done by damping, drag, the other applied forces and the driver, one row for each stored time.  Saved with the data.
+    streamFile          => '',
+        # If set, each stored row (time, dynams, node and tip coords, and energies if accounting) is also appended to this tab separated file as the run goes, so a crash doesn't lose it.  Relative to the RHex directory.
+    streamSyncSecs      => 5,
+        # Longest time buffered stream rows wait before being written and synced to disk.
+    streamMemoryRows    => 0,
+        # If positive and streaming, keep only the most recent rows in memory, between this many and three times as many, and no longer have the solver return more than this many at a time.  The plot and saved data are read back from the stream at the end.  Memory then stays bounded however long the run, except when stripping.  Not used with the run cache.
+    streamResume        => 0,
+        # If set, and streamFile holds an earlier run with the same settings, spec files and code that stopped short of t1, continue it from its last row and append to it, rather than starting over.  Not used with energy accounting, or when stripping or remeshing.
+    livePlot            => 0,
+        # If set, while the solver runs a separate window shows the traces as they are computed, so a run that goes bad can be seen and stopped early.  It closes when the run ends, and the usual plot replaces it.
+    livePlotFPS         => 4,
+        # Most times a second the live plot is redrawn.  Redrawing is done by its own gnuplot process and never holds up the solver.
+    runCacheDir         => '',
+        # If set, completed runs are kept in this directory, and a later run with the same settings, spec files and code uses them instead of integrating, or continues from the end of a shorter one.  Not used when stripping or remeshing.  Relative to the RHex directory.
+    
+    adaptiveMesh            => 0,
+        # If set, split and merge line segs every remeshCheckSecs according to the criteria below.  Not used when stripping, continuous or not.
+    remeshSplitAngleDeg     => 20,
+    remeshMergeAngleDeg     => 2,
+    remeshSplitStrainRate   => 5,		# 1/sec.  Pairs are merged only where the strain rate is below half this.
+    remeshMaxSegs           => 30,
+    remeshCheckSecs         => 1,
+        # Time between looks at the mesh, rounded down to whole plot intervals, but at least one.  The solver runs uninterrupted in between.
+    remeshMinDwellSecs      => 3,
+        # A seg made by a split or merge is left as it is for at least this long.
     
     showLineVXs     => 0,
     plotLineVYs     => 0,
@@ -228,6 +266,8 @@ $rps->{integration} = {
 
     savePlot        => 1,
     saveData        => 1,
+    saveBinary      => 0,
+        # Also save the data as an .rhb file, which RHexReplot3D can open much faster than the .txt.
 
     debugVerboseName    => "debugVerbose - 4",
 	switchOnSlowing		=> 1,
@@ -424,6 +464,13 @@ sub CheckParams{
         $a = sclr($tt(0)); $b = sclr($tt(1)); $c = sclr($tt(2));
         if ($verbose>=1 and ($a<10 or $a>12 or $b<-0.78 or $b>-0.70 or $c<0.01 or $c>1)){print "WARNING: $str = $a,$b,$c - Experiments are unclear, try  1,-1,0.01.  The last value should be much less than the equivalent value in the normal spec.\n"}
     }
+
+    $str = "dragVariation"; $sval = $rps->{ambient}{$str}; $val = eval($sval);
+    if (!looks_like_number($val) or $val < 0){$ok=0; print "ERROR: $str - $sval - Must be non-negative.\n"}
+    elsif($verbose>=1 and $val > 0.5){print "WARNING: $str - $sval - Typical range is [0,0.5].\n"}
+
+    $str = "dragSeed"; $sval = $rps->{ambient}{$str};
+    if (!defined($sval) or $sval !~ /^\d+$/){$ok=0; print "ERROR: $str - ".($sval//'')." - Must be a non-negative integer.\n"}
     
     $str = "sinkIntervalSec"; $sval = $rps->{driver}{$str}; $val = eval($sval);
     if (!looks_like_number($val) or $val < 0){$ok=0; print "ERROR: $str = $sval - Sink interval must be must be non-negative.\n"}
@@ -557,6 +604,12 @@ sub CheckParams{
 		elsif($verbose>=1 and ($val < -1 or $val > 1)){print "WARNING: $str = $sval - Zero disables smoothing, higher numbers give closer approximations.\n"}
 	}
 
+    $str = "smoothingMethod"; $sval = $rps->{driver}{$str};
+	if ($sval ne "fourier" and $sval ne "savgol"){$ok=0; print "ERROR: $str = $sval - Must be fourier or savgol.\n"}
+
+    $str = "savGolHalfWidth"; $sval = $rps->{driver}{$str}; $val = eval($sval);
+	if (!looks_like_number($val) or $val<1 or $val != POSIX::floor($val)){$ok=0; print "ERROR: $str = $sval - Must be a positive integer.\n"}
+
     $str = "numSegs"; $sval = $rps->{integration}{$str}; $val = eval($sval);
     if (!looks_like_number($val) or $val < 1 or ceil($val) != $val){$ok=0; print "ERROR: $str = $sval - Must be an integer >= 1.\n"}
     elsif($verbose>=1 and ($val > 20)){print "WARNING: $str = $sval - Typical range is [5,20].\n"}
@@ -589,6 +642,46 @@ sub CheckParams{
     if (!looks_like_number($val) or $val < 1){$ok=0; print "ERROR: $str = $sval - Magnification must be no less than 1.\n"}
     elsif($verbose>=1 and ($val > 5)){print "WARNING: $str = $sval - Typical range is [1/5].\n"}
     
+	if ($rps->{integration}{adaptiveMesh}){
+		$str = "remeshSplitAngleDeg"; $sval = $rps->{integration}{$str}; $val = eval($sval);
+		if (!looks_like_number($val) or $val <= 0 or $val >= 180){$ok=0; print "ERROR: $str = $sval - Must be in the range (0,180).\n"}
+		my $splitAngle = $val;
+		
+		$str = "remeshMergeAngleDeg"; $sval = $rps->{integration}{$str}; $val = eval($sval);
+		if (!looks_like_number($val) or $val < 0 or (looks_like_number($splitAngle) and $val >= $splitAngle)){$ok=0; print "ERROR: $str = $sval - Must be non-negative and less than remeshSplitAngleDeg.\n"}
+		
+		$str = "remeshSplitStrainRate"; $sval = $rps->{integration}{$str}; $val = eval($sval);
+		if (!looks_like_number($val) or $val <= 0){$ok=0; print "ERROR: $str = $sval - Must be positive.\n"}
+		
+		$str = "remeshMaxSegs"; $sval = $rps->{integration}{$str}; $val = eval($sval);
+		if (!looks_like_number($val) or ceil($val) != $val or $val < $rps->{integration}{numSegs}){$ok=0; print "ERROR: $str = $sval - Must be an integer no less than numSegs.\n"}
+		
+		$str = "remeshCheckSecs"; $sval = $rps->{integration}{$str}; $val = eval($sval);
+		if (!looks_like_number($val) or $val <= 0){$ok=0; print "ERROR: $str = $sval - Must be positive.\n"}
+		
+		$str = "remeshMinDwellSecs"; $sval = $rps->{integration}{$str}; $val = eval($sval);
+		if (!looks_like_number($val) or $val < 0){$ok=0; print "ERROR: $str = $sval - Must be non-negative.\n"}
+		
+		if ($verbose>=1 and ($rps->{driver}{stripRateFtPerSec} or $rps->{driver}{continuousStripping})){print "WARNING: adaptiveMesh is not used when stripping, continuous or not.\n"}
+	}
+	
+	if ($rps->{integration}{streamFile}){
+		$str = "streamSyncSecs"; $sval = $rps->{integration}{$str}; $val = eval($sval);
+		if (!looks_like_number($val) or $val < 0){$ok=0; print "ERROR: $str = $sval - Must be non-negative.\n"}
+
+		$str = "streamMemoryRows"; $sval = $rps->{integration}{$str}; $val = eval($sval);
+		if (!looks_like_number($val) or ($val and ($val < 2 or ceil($val) != $val))){$ok=0; print "ERROR: $str = $sval - Must be 0, or an integer no less than 2.\n"}
+		if ($verbose>=1 and $val and $rps->{integration}{runCacheDir}){print "WARNING: The run cache is not used when keeping only the most recent rows in memory.\n"}
+
+		if ($verbose>=1 and $rps->{integration}{streamResume} and $rps->{integration}{energyAccounting}){print "WARNING: streamResume is not used with energy accounting.\n"}
+	}
+
+	if ($rps->{integration}{livePlot}){
+		$str = "livePlotFPS"; $sval = $rps->{integration}{$str}; $val = eval($sval);
+		if (!looks_like_number($val) or $val <= 0){$ok=0; print "ERROR: $str = $sval - Must be positive.\n"}
+		if ($verbose>=1 and $val > 30){print "WARNING: $str = $sval - Redrawing more often than 30 times a second gains nothing, and may slow the machine.\n"}
+	}
+	
 	
     return $ok;
 }
@@ -656,7 +749,7 @@ sub LoadDriver {
     # Unset cast pdls (to empty rather than undef):
     ($driverXs,$driverYs,$driverZs,$driverTs) = map {zeros(0)} (0..3);
 	
-    # The cast drawing is expected to be in SVG.  See http://www.w3.org/TR/SVG/ for the full protocol.  SVG does 2-DIMENSIONAL drawing only! See the function SVG_matrix() below for the details.  Ditto resplines.
+    # The cast drawing is expected to be in SVG.  See http://www.w3.org/TR/SVG/ for the full protocol.  SVG does 2-DIMENSIONAL drawing only! See the function SVG_ParseTransform() in RCast3D for the details.  Ditto resplines.
     
 	my $stdPrint = (!$updatingPanel and $verbose>=2) ? 1 : 0;
 
@@ -913,11 +1006,16 @@ sub SetDriverFromTXT {
 		my %opts = (gnuplot=>$gnuplot);
 		my $plotOpts = ($rps->{driver}{showTrackPlot}) ? \%opts : 0;
 		my $numTimes	= $driverTs->nelem;
-		if (2*$smoothingOrder+1 > $numTimes/2){print "Error: 2*smoothingOrder+1 must be no greater than the number of loaded timesteps divided by 2.\n"; return 0}
+		my %smoothing = (method=>$rps->{driver}{smoothingMethod},order=>$smoothingOrder,halfWidth=>eval($rps->{driver}{savGolHalfWidth}));
+		if ($smoothing{method} eq "savgol"){
+			if (2*$smoothing{halfWidth}+1 > $numTimes){print "Error: 2*savGolHalfWidth+1 must be no greater than the number of loaded timesteps.\n"; return 0}
+			if ($smoothingOrder >= 2*$smoothing{halfWidth}+1){print "Error: With savgol smoothing, smoothingOrder must be less than 2*savGolHalfWidth+1.\n"; return 0}
+		}
+		elsif (2*$smoothingOrder+1 > $numTimes/2){print "Error: 2*smoothingOrder+1 must be no greater than the number of loaded timesteps divided by 2.\n"; return 0}
 
 		my $smoothEnds	= ($numTimes >= 10) ? 5 : POSIX::floor($numTimes/2);
 			# Always smooth ends as well.
-		SmoothDriver($smoothingOrder,$smoothEnds,$plotOpts,
+		SmoothDriver(\%smoothing,$smoothEnds,$plotOpts,
 						$driverTs,$driverXs,$driverYs,$driverZs);
 	}
 
@@ -1312,6 +1410,20 @@ my ($surfaceVel,$bottomDepth);
 my $levelLeaderSinkInPerSec;	# For reporting.
 my ($T,$Dynams);
 	# Will hold the complete integration record.  I put them up here since $T will be undef'd in SetupIntegration() as a way of indicating that the CastRun() initialization has not yet been done.
+my $Energies;
+	# If energy accounting, parallel to $T, one column of DE_EnergyColumns() values per stored time.  Otherwise undef.
+my ($TStore,$DynamsStore,$EnergiesStore);
+	# Growable backing for the three above, which are slices of these.  See RowStoreNew().
+my $resultStream;
+	# Defined only while streaming.  See ResultStreamOpen().
+my ($streamRunKey,$streamMemoryRows);
+	# The key written into the stream header, so a later run can tell whether it may resume from it.  Memory rows are 0 unless only the tail of the record is kept in the stores, the rest being in the stream.
+my $streamedEnergyRows;
+	# When the tail is all that is in memory, the energy rows for saving, read back from the stream with the plot data.
+my $livePlot;
+	# Defined only while the live plot is up.  See LivePlotOpen().
+my ($runCacheKey,$cacheHit);
+	# Key is '' if the run cache is not in use.  Hit is set if the cache supplied the whole run.
 
 
 sub SetupIntegration {
@@ -1413,7 +1525,12 @@ sub SetupIntegration {
     if ($verbose>=3){pq($T0,$Dynams0,$dT)}
     if (DEBUG and $verbose>=5){pqInfo($Dynams0)}
     
-    SetSubsequentSegStartTs($T0,$sinkInterval,$stripRate,$segLens,$shortStopInterval);
+    if ($rps->{driver}{continuousStripping}){
+        # No scheduled events.  The stepper handles the stripping by itself.
+        $segStartTs = zeros(0);
+    } else {
+        SetSubsequentSegStartTs($T0,$sinkInterval,$stripRate,$segLens,$shortStopInterval);
+    }
     
     $T      = $T0;  # Not a pdl yet.  Signals run needs initialization.
     
@@ -1446,7 +1563,8 @@ sub SetupIntegration {
                     $profileStr,$bottomDepth,$surfaceVel,
                     $halfVelThickness,$surfaceLayerThickness,
                     $horizHalfWidth,$horizExponent,
-                    $sinkInterval,$stripRate);
+                    $sinkInterval,$stripRate,
+                    $rps->{driver}{continuousStripping});
     
     return 1;
 }
@@ -1469,6 +1587,9 @@ my $strippingEnabled;
 my $theseDynams_GSL;
 my $segNomLens;		# Probably not necessary.
 
+my ($adaptiveMesh,%opts_remesh,$remeshCheckSteps);
+my @meshHistory;	# Pairs [t,padded nominal seg lens], one for each remesh.
+
 $doRun = \&DoRun;	# Set global pointer for use by RCommonInterface.
 
 sub DoRun {
@@ -1505,6 +1626,10 @@ sub DoRun {
         
 
         $Dynams             = Get_DynamsCopy(); # This includes good initial $ps.
+
+        DE_SetEnergyAccounting($rps->{integration}{energyAccounting});
+        DE_SetDragMultipliers(RandomMultipliers($segLens->nelem,eval($rps->{ambient}{dragVariation}),$rps->{ambient}{dragSeed}));
+        $Energies = ($rps->{integration}{energyAccounting}) ? DE_EnergyColumns($t0_GSL,$Dynams)->dummy(1) : undef;
         if($verbose>=3){pq($t0_GSL,$t1_GSL,$dt_GSL,$Dynams)}
         
         $strippingEnabled	= ($segStartTs->isempty) ? 0 : 1;
@@ -1524,14 +1649,78 @@ sub DoRun {
          }
 		
         $segNomLens     = $segLens;
+		
+		@meshHistory	= ();
+		$adaptiveMesh	= ($rps->{integration}{adaptiveMesh} and !$strippingEnabled and !$rps->{driver}{continuousStripping}) ? 1 : 0;
+			# Remesh_LINE() never remeshes while stripping, and continuous stripping has no restarts to make $strippingEnabled say so.
+		if ($adaptiveMesh){
+			# Reserve room in the stored solution for the largest mesh we allow.  Smaller meshes are padded at the rod tip end, just as when stripping:
+			$init_numSegs	= $rps->{integration}{remeshMaxSegs};
+			(undef,$Dynams)	= PadSolution(pdl($t0_GSL)->glue(0,$Dynams->flat),$init_numSegs);
+			$segNomLens		= zeros($init_numSegs-$numSegs)->glue(0,$segLens);
+			
+			%opts_remesh = (
+				splitAngle		=> $rps->{integration}{remeshSplitAngleDeg}*$pi/180,
+				mergeAngle		=> $rps->{integration}{remeshMergeAngleDeg}*$pi/180,
+				splitStrainRate	=> $rps->{integration}{remeshSplitStrainRate},
+				minSegLen		=> min($segLens)/4,
+				maxSegLen		=> 2*max($segLens),
+				maxSegs			=> $init_numSegs,
+				minDwell		=> eval($rps->{integration}{remeshMinDwellSecs}));
+			$remeshCheckSteps	= DecimalFloor(eval($rps->{integration}{remeshCheckSecs})/$dt_GSL);
+			if ($remeshCheckSteps < 1){$remeshCheckSteps = 1}
+			if ($verbose>=3){pq(\%opts_remesh)}
+		}
         
         my $h_init  = eval($rps->{integration}{dt0});
         %opts_GSL   = (type=>$rps->{integration}{stepperName},h_init=>$h_init);
         if ($verbose>=3){pq(\%opts_GSL)}
             
-        $T = pdl($t0_GSL);   # To indicate that initialization has been done.  Prevents repeated initializations even if the user interrups during the first plot interval.
+        $streamMemoryRows	= ($rps->{integration}{streamFile}) ? eval($rps->{integration}{streamMemoryRows}) : 0;
+
+        # Room for every uniform time plus a held event stop, so a run that isn't interrupted never regrows.  When keeping only the tail, room for the most it can grow to between trims:
+        my $capacity	= ($streamMemoryRows) ? 3*$streamMemoryRows+2 : $lastStep_GSL+2;
+        $TStore			= RowStoreNew(0,$capacity);
+        $DynamsStore	= RowStoreNew($Dynams->dim(0),$capacity);
+        $Dynams			= RowStoreAppend($DynamsStore,$Dynams);
+        if (defined($Energies)){
+			$EnergiesStore	= RowStoreNew($Energies->dim(0),$capacity);
+			$Energies		= RowStoreAppend($EnergiesStore,$Energies);
+		}
+
+        $T = RowStoreAppend($TStore,$t0_GSL);   # To indicate that initialization has been done.  Prevents repeated initializations even if the user interrups during the first plot interval.
         #pq($T);print "init\n";
 
+        ($runCacheKey,$cacheHit) = ('',0);
+        if ($rps->{integration}{runCacheDir} and !$strippingEnabled and !$adaptiveMesh and !$rps->{driver}{continuousStripping} and !$streamMemoryRows){
+            $runCacheKey = RunCacheKey($rps,'swing');
+            $cacheHit = UseCachedRun(RunCacheFind($rps->{integration}{runCacheDir},$runCacheKey));
+        }
+
+        ResultStreamClose($resultStream);   # From any earlier run.
+        $resultStream = undef;
+        if ($rps->{integration}{streamFile}){
+            $streamRunKey = RunCacheKey($rps,'swing');
+            my $resumeBytes;
+            if ($rps->{integration}{streamResume} and $T->nelem == 1 and !defined($Energies)
+                    and !$strippingEnabled and !$adaptiveMesh and !$rps->{driver}{continuousStripping}){
+                $resumeBytes = UseStreamedRun($rps->{integration}{streamFile});
+            }
+            $resultStream = ResultStreamOpen($rps->{integration}{streamFile},$rSwingOutFileTag,$rps->{file}{save},
+                                    [StreamColumnNames()],eval($rps->{integration}{streamSyncSecs}),{runKey=>$streamRunKey,resumeBytes=>$resumeBytes});
+            if (defined($resumeBytes)){StreamRows($T(-1),$Dynams(:,-1),undef)}
+                # The file was cut back to just before its last row, which is held again, as at the end of any block.
+            else {StreamRows($T,$Dynams,$Energies)}
+        }
+        if (!defined($resultStream)){$streamMemoryRows = 0}
+
+        LivePlotClose($livePlot);
+        $livePlot = undef;
+        if ($rps->{integration}{livePlot} and !$cacheHit){
+            $livePlot = LivePlotOpen($rps->{file}{save},0,$t0_GSL,$t1_GSL,eval($rps->{integration}{livePlotFPS}));
+            LiveRows($T,$Dynams);
+        }
+
         if ($verbose>=2){print "Solver startup can be especially slow.  BE PATIENT.\n"}
         else {print "RUNNING SILENTLY, wait for return, or hit PAUSE to see the results thus far.\n"}
     }
@@ -1591,6 +1780,17 @@ sub DoRun {
             $thisStop_GSL		= $t1_GSL;
             $thisNumSteps_GSL	= DecimalFloor(($thisStop_GSL-$thisStart_GSL)/$dt_GSL);
             $stopIsUniform		= 1;
+			
+			if ($adaptiveMesh and $thisNumSteps_GSL > $remeshCheckSteps){
+				# Stop at the next check time to give the mesh a chance to adapt:
+				$thisNumSteps_GSL	= $remeshCheckSteps;
+				$thisStop_GSL		= DecimalRound($thisStart_GSL+$remeshCheckSteps*$dt_GSL);
+			}
+			if ($streamMemoryRows and $thisNumSteps_GSL > $streamMemoryRows){
+				# The solver returns the whole block at once, so it too must be no bigger than the kept tail:
+				$thisNumSteps_GSL	= $streamMemoryRows;
+				$thisStop_GSL		= DecimalRound($thisStart_GSL+$streamMemoryRows*$dt_GSL);
+			}
 
 			if (DEBUG and $verbose>=2){print "thisStop_GSL=$thisStop_GSL,stopIsUniform=$stopIsUniform\n"}
         }
@@ -1706,8 +1906,8 @@ sub DoRun {
             if (DEBUG and $verbose>=4){pq($tStatus,$tErrMsg,$interruptT,$interruptDynams)}
         }
         
-        # Start a subsequent run with the latest average dts of the just completed run:
-        my $next_h_init = Get_movingAvDt();
+        # Start a subsequent run near the step the just completed run had settled on:
+        my $next_h_init = Get_stepHintDt();
         $opts_GSL{h_init} = $next_h_init;
         if (DEBUG and $verbose>=4){pq($next_h_init)}
         
@@ -1719,6 +1919,16 @@ sub DoRun {
 		
         $nextStart_GSL  = $solution(0,-1)->sclr;    # Latest report time.
         $nextDynams_GSL = $solution(1:-1,-1)->flat;
+
+		my $blockEnergies;
+		if (defined($Energies)){
+			# Must be figured on the configuration the solver just used, so before any restart:
+			my ($nCols,$nTimes) = $solution->dims;
+			$blockEnergies = zeros($Energies->dim(0),$nTimes-1);
+			for (my $ii=1;$ii<$nTimes;$ii++){
+				$blockEnergies(:,$ii-1) .= DE_EnergyColumns($solution(0,$ii)->sclr,$solution(1:-1,$ii)->flat);
+			}
+		}
 		
 		if (DEBUG and $verbose>=3){print "END_TIME=$nextStart_GSL\nEND_DYNAMS=$nextDynams_GSL\n\n"}
 		
@@ -1740,6 +1950,18 @@ sub DoRun {
         }
 		
 		if (DEBUG and $verbose>=4){pq($nextStart_GSL,$nextDynams_GSL)}
+		
+		my $remeshed = 0;
+		if ($adaptiveMesh and !$tStatus and $nextStart_GSL == $thisStop_GSL and $nextStart_GSL < $t1_GSL){
+			my ($remeshedDynams,$remeshedSegLens) = Remesh_LINE($nextStart_GSL,$nextDynams_GSL,\%opts_remesh);
+			if (defined($remeshedDynams)){
+				# The stepper has already been restarted on the new mesh.
+				$nextDynams_GSL	= $remeshedDynams;
+				$numSegs_GSL	= $remeshedSegLens->nelem;
+				push @meshHistory,[$nextStart_GSL,zeros($init_numSegs-$numSegs_GSL)->glue(0,$remeshedSegLens)];
+				$remeshed		= 1;
+			}
+		}
  
          # There  is always at least one time (starting) in solution.  Never keep the starting data:
         my ($nRows,$nTimes) = $solution->dims;
@@ -1751,8 +1973,12 @@ sub DoRun {
 		
 			# However, if the start was not uniform, remove the last stored data row, which we can do because we have something more recent to start with next time:
 			if (!$startIsUniform){
-				$T		= $T(0:-2);
-				$Dynams	= $Dynams(:,0:-2);
+				my $numKeep	= $T->nelem-1;
+				$T		= RowStoreTruncate($TStore,$numKeep);
+				$Dynams	= RowStoreTruncate($DynamsStore,$numKeep);
+				if (defined($Energies)){$Energies = RowStoreTruncate($EnergiesStore,$numKeep)}
+				ResultStreamDropLast($resultStream);
+				LivePlotDropLast($livePlot);
 			}
         }
 		#pq($solution);
@@ -1762,12 +1988,21 @@ sub DoRun {
 
         my ($ts,$paddedDynams) = PadSolution($solution,$init_numSegs);
 		
-		$T = $T->glue(0,$ts);
+		$T = RowStoreAppend($TStore,$ts);
 		#pq($T);
-		$Dynams = $Dynams->glue(1,$paddedDynams);
+		$Dynams = RowStoreAppend($DynamsStore,$paddedDynams);
+		if (defined($Energies)){$Energies = RowStoreAppend($EnergiesStore,$blockEnergies)}
+		if (defined($resultStream)){StreamRows($ts,$paddedDynams,$blockEnergies)}
+		if (defined($livePlot)){LiveRows($ts,$paddedDynams)}
+		if ($streamMemoryRows and $T->nelem > 2*$streamMemoryRows){
+			# The older rows are in the stream:
+			$T		= RowStoreKeepLast($TStore,$streamMemoryRows);
+			$Dynams	= RowStoreKeepLast($DynamsStore,$streamMemoryRows);
+			if (defined($Energies)){$Energies = RowStoreKeepLast($EnergiesStore,$streamMemoryRows)}
+		}
 		if (DEBUG and $verbose>=6){pq($T,$Dynams)}
 		
-        if ($nextStart_GSL < $t1_GSL and $numSegs_GSL and $tStatus >= 0) {
+        if ($nextStart_GSL < $t1_GSL and $numSegs_GSL and $tStatus >= 0 and !$remeshed) {
             # Either no error, or there was a user interrupt.
             
             Init_Hamilton("restart_swing",$nextStart_GSL,$nextDynams_GSL,$beginningNewSeg);
@@ -1782,6 +2017,22 @@ sub DoRun {
     my $timeEnd = time();
     $elapsedTime_GSL += $timeEnd-$timeStart;
     
+    # Keep the stream open in case of CONTINUE, but get everything that can't be retracted onto the disk:
+    if (defined($resultStream)){
+        if ($nextStart_GSL >= $t1_GSL or !$numSegs_GSL or $tStatus < 0){
+            ResultStreamClose($resultStream);
+            $resultStream = undef;
+        } else {
+            ResultStreamFlush($resultStream);
+        }
+    }
+
+    # On PAUSE the live plot stays up for CONTINUE:
+    if (defined($livePlot) and ($nextStart_GSL >= $t1_GSL or !$numSegs_GSL or $tStatus < 0)){
+        LivePlotClose($livePlot);
+        $livePlot = undef;
+    }
+    
     if ($verbose>=3){
         my $JACfac = JACget();
         pq($JACfac);
@@ -1790,24 +2041,62 @@ sub DoRun {
     
     if (DEBUG and $verbose>=6){print "After run\n";pq($T,$Dynams)};
 	
-    $finalT     = $T(-1)->flat;
-    $finalState = $Dynams(:,-1)->flat;
+    $finalT     = $T(-1)->flat->copy;
+    $finalState = $Dynams(:,-1)->flat->copy;
+		# Copies, since $T and $Dynams share their stores' buffers, which a CONTINUE may overwrite.
     #pq($finalT,$finalState);
     
-    $plotTs = zeros(0);
-    my $numISegs = $numSegs;
-    ($plotXs,$plotYs,$plotZs) = map {zeros($numISegs,0)} (0..2);
-    my $plotRs = zeros($numISegs-1,0);
+    # If only the tail is in memory, the rows before it come back from the stream, which the flush above has brought up to date except for the held newest row, which is in the tail:
+    my ($streamed,$numStreamed) = (undef,0);
+    $streamedEnergyRows = undef;
+    if ($streamMemoryRows){
+        $streamed = ResultStreamRead($rps->{integration}{streamFile},$rSwingOutFileTag,$streamRunKey,[StreamColumnNames()],0);
+        if (defined($streamed)){$numStreamed = sum($streamed->{rows}(0,:) < $T->at(0))}
+        else {print "WARNING: Could not read back the stream.  Plotting only the last ".$T->nelem." stored rows.\n"}
+    }
+
+    my $traceCount = $T->nelem;
+    my $numTraces = ($tStatus) ? $numStreamed+$traceCount+1 : $numStreamed+$traceCount;
+		# The count is known, so fill preallocated traces rather than glue them on one at a time.
+
+    $plotTs = zeros($numTraces);
+    my $plotRs;
+		# These and the coord traces are sized from the first trace, since the stored dynams may be padded.
     
-    ($plotXLineTips,$plotYLineTips,$plotZLineTips)          = map {zeros(1,0)} (0..2);
-    ($plotXLeaderTips,$plotYLeaderTips,$plotZLeaderTips)    = map {zeros(1,0)} (0..2);
+    ($plotXLineTips,$plotYLineTips,$plotZLineTips)          = map {zeros(1,$numTraces)} (0..2);
+    ($plotXLeaderTips,$plotYLeaderTips,$plotZLeaderTips)    = map {zeros(1,$numTraces)} (0..2);
+
+    if ($numStreamed){
+        my $rows	= $streamed->{rows}(:,0:$numStreamed-1);
+        my $iCols	= $streamed->{columns};
+        my $iX0		= $iCols->{X0};
+        my $numNodes = $iCols->{Y0}-$iX0;
+        
+        $plotTs(0:$numStreamed-1) .= $rows($iCols->{T},:)->flat;
+        ($plotXs,$plotYs,$plotZs) = map {zeros($numNodes,$numTraces)} (0..2);
+        $plotXs(:,0:$numStreamed-1) .= $rows($iX0:$iX0+$numNodes-1,:);
+        $plotYs(:,0:$numStreamed-1) .= $rows($iX0+$numNodes:$iX0+2*$numNodes-1,:);
+        $plotZs(:,0:$numStreamed-1) .= $rows($iX0+2*$numNodes:$iX0+3*$numNodes-1,:);
+        
+        $plotXLineTips(:,0:$numStreamed-1)      .= $rows($iCols->{XLineTip},:);
+        $plotYLineTips(:,0:$numStreamed-1)      .= $rows($iCols->{YLineTip},:);
+        $plotZLineTips(:,0:$numStreamed-1)      .= $rows($iCols->{ZLineTip},:);
+        
+        $plotXLeaderTips(:,0:$numStreamed-1)    .= $rows($iCols->{XLeaderTip},:);
+        $plotYLeaderTips(:,0:$numStreamed-1)    .= $rows($iCols->{YLeaderTip},:);
+        $plotZLeaderTips(:,0:$numStreamed-1)    .= $rows($iCols->{ZLeaderTip},:);
+        
+        if (defined($Energies)){
+            my $numEnergies = $Energies->dim(0);
+            $streamedEnergyRows = $rows($iCols->{T},:)->glue(0,$rows(-$numEnergies:-1,:))->glue(1,$T->dummy(0)->glue(0,$Energies));
+        }
+    }
     
     #my $nextPlotTime = $tt[0];
     
     #my $iTrace=0;
     #my $iLastPlotted = -1;
     my $tPlot;
-    my $traceCount = $T->nelem;
     for (my $ii=0;$ii<$traceCount;$ii++){
         
         # So, if we got here, either this is the next requested trace to plot or it is bad and the previous step was not plotted.
@@ -1821,19 +2110,25 @@ sub DoRun {
 
         if (DEBUG and $verbose>=6){pq($tXs,$tYs,$tZs)}
         
-        $plotTs = $plotTs->glue(0,pdl($tPlot));
-        $plotXs = $plotXs->glue(1,$tXs);
-        $plotYs = $plotYs->glue(1,$tYs);
-        $plotZs = $plotZs->glue(1,$tZs);
-        $plotRs = $plotRs->glue(1,$tRs);
+        if (!$ii){
+            if (!$numStreamed){($plotXs,$plotYs,$plotZs) = map {zeros($tXs->nelem,$numTraces)} (0..2)}
+            $plotRs = zeros($tRs->nelem,$numTraces);
+                # Radii aren't streamed, so those of any streamed traces are left zero.
+        }
+        my $iTrace = $numStreamed+$ii;
+        $plotTs($iTrace) .= $tPlot;
+        $plotXs(:,$iTrace) .= $tXs;
+        $plotYs(:,$iTrace) .= $tYs;
+        $plotZs(:,$iTrace) .= $tZs;
+        $plotRs(:,$iTrace) .= $tRs;
         
-        $plotXLineTips      = $plotXLineTips->glue(1,$XLineTip);
-        $plotYLineTips      = $plotYLineTips->glue(1,$YLineTip);
-        $plotZLineTips      = $plotZLineTips->glue(1,$ZLineTip);
+        $plotXLineTips(:,$iTrace)      .= $XLineTip;
+        $plotYLineTips(:,$iTrace)      .= $YLineTip;
+        $plotZLineTips(:,$iTrace)      .= $ZLineTip;
 
-        $plotXLeaderTips    = $plotXLeaderTips->glue(1,$XLeaderTip);
-        $plotYLeaderTips    = $plotYLeaderTips->glue(1,$YLeaderTip);
-        $plotZLeaderTips    = $plotZLeaderTips->glue(1,$ZLeaderTip);
+        $plotXLeaderTips(:,$iTrace)    .= $XLeaderTip;
+        $plotYLeaderTips(:,$iTrace)    .= $YLeaderTip;
+        $plotZLeaderTips(:,$iTrace)    .= $ZLeaderTip;
 
     }
     #pq($traceCount,$plotTs,$plotXs,$plotYs);
@@ -1855,19 +2150,19 @@ sub DoRun {
             if (DEBUG and $verbose>=6){pq($tXs,$tYs,$tZs)}
             
             
-            $plotTs = $plotTs->glue(0,pdl($tt));
-            $plotXs = $plotXs->glue(1,$tXs);
-            $plotYs = $plotYs->glue(1,$tYs);
-            $plotZs = $plotZs->glue(1,$tZs);
-            $plotRs = $plotRs->glue(1,$tRs);
+            $plotTs(-1) .= $tt;
+            $plotXs(:,-1) .= $tXs;
+            $plotYs(:,-1) .= $tYs;
+            $plotZs(:,-1) .= $tZs;
+            $plotRs(:,-1) .= $tRs;
             
-            $plotXLineTips      = $plotXLineTips->glue(1,$XLineTip);
-            $plotYLineTips      = $plotYLineTips->glue(1,$YLineTip);
-            $plotZLineTips      = $plotZLineTips->glue(1,$ZLineTip);
+            $plotXLineTips(:,-1)      .= $XLineTip;
+            $plotYLineTips(:,-1)      .= $YLineTip;
+            $plotZLineTips(:,-1)      .= $ZLineTip;
             
-            $plotXLeaderTips    = $plotXLeaderTips->glue(1,$XLeaderTip);
-            $plotYLeaderTips    = $plotYLeaderTips->glue(1,$YLeaderTip);
-            $plotZLeaderTips    = $plotZLeaderTips->glue(1,$ZLeaderTip);
+            $plotXLeaderTips(:,-1)    .= $XLeaderTip;
+            $plotYLeaderTips(:,-1)    .= $YLeaderTip;
+            $plotZLeaderTips(:,-1)    .= $ZLeaderTip;
             
             if (DEBUG and $verbose>=6){
                     print "Appending interrupt data\n";
@@ -1908,6 +2203,13 @@ sub DoRun {
     $plotTs,$plotXs,$plotYs,$plotZs,$plotXLineTips,$plotYLineTips,$plotZLineTips,$plotXLeaderTips,$plotYLeaderTips,$plotZLeaderTips,$plotNumRodSegs,$plotBottom,$plotErrMsg,$verbose,\%opts_plot);
     
     
+    if ($runCacheKey and !$cacheHit and !$tStatus and $tPlot >= $t1_GSL){
+        RunCacheStore($rps->{integration}{runCacheDir},$runCacheKey,$T,$Dynams,$Energies,
+            $rSwingOutFileTag,$titleStr,$paramsStr,
+            $plotTs,$plotXs,$plotYs,$plotZs,$plotXLineTips,$plotYLineTips,$plotZLineTips,$plotXLeaderTips,$plotYLeaderTips,$plotZLeaderTips,$plotNumRodSegs,$plotBottom,$plotErrMsg,
+            $finalT,$finalState,$segLens);
+    }
+    
     # If integration has completed, tell the caller:
     if ($tPlot>=$t1_GSL or $tStatus < 0 or !$numSegs_GSL) {
         if ($tStatus < 0){print "\n";pq($tStatus,$tErrMsg)}
@@ -1915,6 +2217,9 @@ sub DoRun {
         &{$runControl{callerStop}}();
     }
     
+
+    return $tStatus;
+        # The control panel ignores this.  Batch runs use it for their exit code.
 }
 
 
@@ -2021,6 +2326,117 @@ sub UnpackQsFromDynams {
 }
 
 
+sub UseCachedRun {
+    my ($cached) = @_;
+
+    ## Replace the just initialized stored solution with as much of a cached one as applies.  Returns 1 if that covers the whole run.  If it covers only part, the run continues from its end, except with energy accounting, whose running totals were not cached.
+
+    if (!defined($cached)){return 0}
+
+    my $cachedTs	= $cached->{StoredTs};
+    my $numUse		= sum($cachedTs <= $t1_GSL);
+    my $tLast		= $cachedTs->at($numUse-1);
+    if ($cachedTs->at(0) != $t0_GSL or $cached->{StoredDynams}->dim(0) != $Dynams->dim(0)
+            or (defined($Energies) and (!defined($cached->{StoredEnergies}) or $tLast < $t1_GSL))){
+        if ($verbose>=2){print "Cached run found, but it can't be used for this one.\n"}
+        return 0;
+    }
+
+    if ($numUse > 1){
+        $T		= RowStoreAppend($TStore,$cachedTs(1:$numUse-1));
+        $Dynams	= RowStoreAppend($DynamsStore,$cached->{StoredDynams}(:,1:$numUse-1));
+        if (defined($Energies)){$Energies = RowStoreAppend($EnergiesStore,$cached->{StoredEnergies}(:,1:$numUse-1))}
+    }
+
+    if ($tLast >= $t1_GSL){
+        if ($verbose>=1){print "Using cached run.  No integration needed.\n"}
+        return 1;
+    }
+
+    if ($verbose>=1){printf("Using cached run up to t=%.4f, continuing from there.\n",$tLast)}
+    Init_Hamilton("restart_swing",$tLast,$Dynams(:,-1)->flat,0);
+    return 0;
+}
+
+
+sub UseStreamedRun {
+    my ($filename) = @_;
+
+    ## Replace the just initialized stored solution with the end of an earlier, unfinished run of this one, read back from its stream.  Returns the length of the stream file up to the start of its last row, or undef if there is nothing to resume.  The run then continues from that last row.  Compare UseCachedRun().
+
+    my $streamed = ResultStreamRead($filename,$rSwingOutFileTag,$streamRunKey,[StreamColumnNames()],$streamMemoryRows);
+    if (!defined($streamed) or !$streamed->{numRows}){return undef}
+
+    my $rows	= $streamed->{rows};
+    my $tLast	= $rows->at(0,-1);
+    if ($streamed->{firstT} != $t0_GSL or $tLast > $t1_GSL){
+        if ($verbose>=2){print "Stream $filename found, but it can't be resumed by this run.\n"}
+        return undef;
+    }
+
+    $T		= RowStoreTruncate($TStore,0);
+    $Dynams	= RowStoreTruncate($DynamsStore,0);
+    $T		= RowStoreAppend($TStore,$rows(0,:)->flat);
+    $Dynams	= RowStoreAppend($DynamsStore,$rows(1:$DynamsStore->{rowLen},:));
+
+    if ($verbose>=1){printf("Resuming the run in $filename from t=%.4f.\n",$tLast)}
+    if ($tLast < $t1_GSL){Init_Hamilton("restart_swing",$tLast,$Dynams(:,-1)->flat,0)}
+    return $streamed->{lastRowBytes};
+}
+
+
+sub StreamColumnNames {
+
+    ## Matches the rows StreamRows() makes.  The dynams are the padded, stored ones, so the node count is fixed for the run.
+
+    my $numDynams	= $Dynams->dim(0);
+    my $numNodes	= $numDynams/6+1;
+    my @names = ('T',(map {"D$_"} (0..$numDynams-1)));
+    foreach my $coord (qw(X Y Z)){push @names,map {"$coord$_"} (0..$numNodes-1)}
+    push @names,qw(XLineTip YLineTip ZLineTip XLeaderTip YLeaderTip ZLeaderTip);
+    if (defined($Energies)){push @names,Get_EnergyColumnNames()}
+    return @names;
+}
+
+
+sub StreamRows {
+    my ($ts,$dynams,$energies) = @_;
+
+    ## Append stored rows to the result stream, with the node and tip coords figured from the dynams.
+
+    my $numTs = $ts->nelem;
+    if (!defined($resultStream) or !$numTs){return}
+
+    my $rows;
+    for (my $ii=0;$ii<$numTs;$ii++){
+        my $t		= $ts($ii)->sclr;
+        my $tDynams	= $dynams(:,$ii);
+        my ($tXs,$tYs,$tZs,$tRs,@tips) = Calc_Qs($t,$tDynams,$lineTipOffset,$leaderTipOffset);
+        my @vals = ($t,$tDynams->list,$tXs->list,$tYs->list,$tZs->list,(map {pdl($_)->list} @tips));
+        if (defined($energies)){push @vals,$energies(:,$ii)->list}
+
+        if (!$ii){$rows = zeros(scalar(@vals),$numTs)}
+        $rows(:,$ii) .= pdl(\@vals);
+    }
+    ResultStreamAppend($resultStream,$rows);
+}
+
+
+sub LiveRows {
+    my ($ts,$dynams) = @_;
+
+    ## Send stored rows to the live plot as node coords.
+
+    if (!defined($livePlot)){return}
+
+    for (my $ii=0;$ii<$ts->nelem;$ii++){
+        my $t = $ts($ii)->sclr;
+        my ($tXs,$tYs,$tZs) = Calc_Qs($t,$dynams(:,$ii),$lineTipOffset,$leaderTipOffset);
+        LivePlotAppend($livePlot,$t,$tXs,$tYs,$tZs);
+    }
+}
+
+
 sub Calc_Qs {
     my ($t,$tDynams,$lineTipOffset,$leaderTipOffset) = @_;
 
@@ -2070,6 +2486,20 @@ sub Calc_Qs {
 }
 
 
+sub NominalSegLensAt {
+    my ($t) = @_;
+	
+	## The padded nominal seg lens of the mesh in use at time $t.  Without adaptive remeshing this is always just $segNomLens.  The row stored at a remesh time holds the dynams from before the remesh, so it goes with the old mesh.
+	
+	my $nomLens = $segNomLens;
+	foreach my $entry (@meshHistory){
+		if ($entry->[0] < $t){$nomLens = $entry->[1]}
+		else {last}
+	}
+	return $nomLens;
+}
+
+
 sub Calc_QOffset {
     my ($t,$Xs,$Ys,$Zs,$drs,$offset) = @_;
 
@@ -2078,7 +2508,10 @@ sub Calc_QOffset {
     #pq($t,$Xs,$Ys,$drs,$offset);
 
     my $tRemainingSegs  = ($drs != 0); # sic
-    my $tSegNomLens     = $segNomLens * $tRemainingSegs; # Deal with the padding.
+    my $tSegNomLens     = NominalSegLensAt($t) * $tRemainingSegs; # Deal with the padding.
+    
+    # With continuous stripping there is no padding, but all the segs shrink together:
+    if ($rps->{driver}{continuousStripping}){$tSegNomLens *= Get_StripRemainingFract($t)}
     
     #pq($tRemainingSegs,$tSegNomLens);
     
@@ -2177,6 +2610,7 @@ sub GetAmbientStr {
     my $str = "AMBIENT: Gravity=$rps->{ambient}{nominalG}; ";
     $str .= "DragSpecsNormal=($rps->{ambient}{dragSpecsNormal}); ";
     $str .= "DragSpecsAxial=($rps->{ambient}{dragSpecsAxial})";
+    if (eval($rps->{ambient}{dragVariation})){$str .= "; DragVariation=$rps->{ambient}{dragVariation}, seed $rps->{ambient}{dragSeed}"}
     
     return $str;
 }
@@ -2282,10 +2716,19 @@ sub DoSave {
 
 #pq($plotTs,$plotXs,$plotYs,$plotZs);
                    
+    my $energyRows = (defined($streamedEnergyRows)) ? $streamedEnergyRows : (defined($Energies)) ? $T->dummy(0)->glue(0,$Energies) : undef;
     if ($rps->{integration}{saveData}){
         RCommonSave3D($dirs.$basename,$rSwingOutFileTag,$titleStr,$paramsStr,
         $plotTs,$plotXs,$plotYs,$plotZs,$plotXLineTips,$plotYLineTips,$plotZLineTips,$plotXLeaderTips,$plotYLeaderTips,$plotZLeaderTips,$plotNumRodSegs,$plotBottom,$plotErrMsg,
-        $finalT,$finalState,$segLens);
+        $finalT,$finalState,$segLens,
+        $energyRows,[Get_EnergyColumnNames()]);
+    }
+
+    if ($rps->{integration}{saveBinary}){
+        RCommonSaveBinary3D($dirs.$basename,$rSwingOutFileTag,$titleStr,$paramsStr,
+        $plotTs,$plotXs,$plotYs,$plotZs,$plotXLineTips,$plotYLineTips,$plotZLineTips,$plotXLeaderTips,$plotYLeaderTips,$plotZLeaderTips,$plotNumRodSegs,$plotBottom,$plotErrMsg,
+        $finalT,$finalState,$segLens,
+        $energyRows,[Get_EnergyColumnNames()]);
     }
 }
 
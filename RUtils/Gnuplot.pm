@@ -2070,6 +2070,7 @@ sub _thaw
     elsif (defined $self->{datafile})
     {
         $string = "'$self->{datafile}'";
+        $string .= " binary $self->{binary}" if (defined $self->{binary});
         $string .= " every $self->{every}" if (defined $self->{every});
         $string .= " index $self->{index}" if (defined $self->{index});
     }
@@ -2113,7 +2114,12 @@ sub _thaw
     $string .= " with $self->{style}" if (defined $self->{style});
     $string .= " linetype ".&_lineType($self->{linetype}) if
         (defined $self->{linetype});
-    $string .= " linecolor rgb \"$self->{color}\"" if (defined $self->{color});
+    if (defined $self->{color})
+    {
+        # "variable" takes each point's color from the last column used.
+        ($self->{color} eq 'variable')? ($string .= " linecolor rgb variable"):
+            ($string .= " linecolor rgb \"$self->{color}\"");
+    }
     $string .= " linewidth $self->{width}" if (defined $self->{width});
     $string .= " pointtype ".&_pointType($self->{pointtype}) if
         (defined $self->{pointtype});
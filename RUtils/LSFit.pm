@@ -6,6 +6,8 @@ package RUtils::LSFit;
 #	($fit,$fits,$coeffs) = lsfit($ys,$fs);
 #	($fit,$fits,$coeffs) = fourfit($xs,$ys,$order);
 #	$fits = fourfitvals($coeffs,$xs);
+#	($fit,$fits,$coeffs) = fourfitqr($xs,$ys,$order);
+#	($fit,$fits) = sgsmooth($ys,$halfWidth,$polyOrder);
 
 use warnings;
 use strict;
@@ -15,9 +17,10 @@ use POSIX ();
 
 #use Carp qw(carp croak confess cluck longmess shortmess);
 use Carp;
+use Digest::SHA qw(sha1_hex);
 
 use Exporter 'import';
-our @EXPORT = qw( lsfit fourfit fourfitvals );
+our @EXPORT = qw( lsfit fourfit fourfitvals fourbasis fourfitqr sgsmooth );
 
 our $VERSION='0.01';
 
@@ -66,17 +69,7 @@ sub fourfit {
 	
 	if ($order < 0 or $order != floor($order) or $order > ($npts-1)/2){croak "Error: \$order must be a non-negative integer no larger than (\$xs-1)/2.\n"}
 	
-	my $fs = zeros($npts,2*$order+1);
-	
-    for (my $ii=0;$ii<=$order;$ii++){
-	
-		if ($ii == 0){ $fs(:,$ii) .= ones($npts)}
-		else {
-			my $txs = $ii*$xs;
-			$fs(:,2*$ii-1)	.= sin($txs);
-			$fs(:,2*$ii)	.= cos($txs);
-		}
-    }
+	my $fs = fourbasis($xs,$order);
 
 	#pq($xs,$ys,$order,$fs);
 	
@@ -105,6 +98,136 @@ sub fourfitvals {
 }
 
 
+sub fourbasis {
+    my ($xs,$order) = @_;
+
+	## The fourfit() fitting functions, one per row: a constant, then sin and cos of each multiple of $xs up to $order.
+
+	my $npts = $xs->nelem;
+	my $fs = zeros($npts,2*$order+1);
+	
+    for (my $ii=0;$ii<=$order;$ii++){
+	
+		if ($ii == 0){ $fs(:,$ii) .= ones($npts)}
+		else {
+			my $txs = $ii*$xs;
+			$fs(:,2*$ii-1)	.= sin($txs);
+			$fs(:,2*$ii)	.= cos($txs);
+		}
+    }
+	
+	return $fs;
+}
+
+
+# Factorizations of the Fourier basis, keyed by order and time grid.  Smoothing the same grid again, as happens with every parameter change in the control panel and with every run of a sweep, skips straight to the projection:
+my %fourFactors;
+my $maxFourFactors = 16;
+my $fourDropTol = 1e-8;
+	# Basis rows whose orthogonalized residual is less than this fraction of their norm are dropped.
+
+sub fourfactor {
+    my ($xs,$order) = @_;
+
+	## Orthonormalizes the rows of fourbasis($xs,$order) by modified Gram-Schmidt, with one reorthogonalization pass, giving $Q with orthonormal rows and upper triangular $R such that the kept rows of the basis are $R->transpose x $Q.  A thin QR factorization of the basis, in other words.  Returns $Q and a matrix, the inverse of $R->transpose spread out over the basis rows, which takes projection coefficients to basis coefficients.
+
+	## The driver times are raw seconds, so on short tracks the low multiples of sin and cos are very nearly linear combinations of one another, and the basis is numerically rank deficient.  A row whose residual after orthogonalization is negligible adds nothing to the fit, so it is dropped, and gets coefficient zero, rather than being normalized into noise.  The fits are then the least squares projection onto the span of the basis, as in fourfit(), but the coefficients are those of the kept rows only.
+
+	my $key = join("\t",$order,$xs->nelem,sha1_hex(pack("d*",$xs->list)));
+	if (exists($fourFactors{$key})){return @{$fourFactors{$key}}}
+
+	my $fs	= fourbasis($xs,$order);
+	my $nfs	= $fs->dim(1);
+	my $Q	= $fs->copy;
+	my $R	= zeros($nfs,$nfs);
+	my @kept;
+
+	for (my $ii=0;$ii<$nfs;$ii++){
+		my $q = $Q(:,$ii);
+		my $nk = @kept;
+		foreach my $pass (0,1){
+			for (my $kk=0;$kk<$nk;$kk++){
+				my $r = sum($Q(:,$kk)*$q);
+				$q		-= $r*$Q(:,$kk);
+				$R($nk,$kk)	+= $r;
+			}
+		}
+		my $norm = sqrt(sum($q**2));
+		if ($norm <= $fourDropTol*sqrt(sum($fs(:,$ii)**2))){
+			$R($nk,:) .= 0;
+			next;
+		}
+		# Move the kept row down into place:
+		$Q(:,$nk) .= $q/$norm;
+		$R($nk,$nk) .= $norm;
+		push @kept,$ii;
+	}
+	if (!@kept){croak "Error: The Fourier basis of order $order vanishes on these points.\n"}
+
+	my $nk		= @kept;
+	$Q			= $Q(:,0:$nk-1)->copy;
+	my $RtInv	= zeros($nfs,$nk);
+	$RtInv(pdl(@kept),:) .= minv($R(0:$nk-1,0:$nk-1)->transpose);
+
+	if (keys(%fourFactors) >= $maxFourFactors){%fourFactors = ()}
+	$fourFactors{$key} = [$Q,$RtInv];
+
+	return ($Q,$RtInv);
+}
+
+
+sub fourfitqr {
+    my ($xs,$ys,$order) = @_;
+
+	## The least squares fit of fourfit(), but solved with the cached orthogonal factor of the basis rather than by forming and solving the normal equations, which are badly conditioned for higher orders and short tracks.  Where the basis is numerically rank deficient, the fits agree with those of fourfit() to within the residual, the coefficients of the dropped basis rows are zero, and fourfitvals() still applies.  The work for each new $ys is then just two matrix products.  See testqr().
+
+	my $npts = $xs->nelem;
+	
+	if ($npts < 1 or $ys->dim(0) != $npts){croak "Error: \$xs and \$ys must be non-empty. \$xs must be a flat PDL, and \$ys a matrix with the same number of columns.\n"}
+	
+	if ($order < 0 or $order != floor($order) or $order > ($npts-1)/2){croak "Error: \$order must be a non-negative integer no larger than (\$xs-1)/2.\n"}
+
+	my ($Q,$RtInv) = fourfactor($xs,$order);
+
+	my $projs	= $ys x $Q->transpose;
+	my $fits	= $projs x $Q;
+	my $coeffs	= $projs x $RtInv;
+	my $fit		= sqrt(sumover(($ys-$fits)**2));
+
+	return ($fit,$fits,$coeffs);
+}
+
+
+sub sgsmooth {
+    my ($ys,$halfWidth,$polyOrder) = @_;
+
+	## Savitzky-Golay smoothing of each row of the matrix $ys, whose columns are taken to be equally spaced.  Each interior point is replaced by the value at the window center of the least squares polynomial of order $polyOrder through the 2*$halfWidth+1 points around it.  The first and last $halfWidth points take their values from the polynomial through the first and last full window.  The weights are computed once, so the cost is linear in the number of points.  Returns ($fit,$fits) as fourfit() does.
+
+	my $npts	= $ys->dim(0);
+	my $width	= 2*$halfWidth+1;
+
+	if ($halfWidth < 1 or $halfWidth != floor($halfWidth) or $width > $npts){croak "Error: \$halfWidth must be a positive integer, with 2*\$halfWidth+1 no more than the number of points.\n"}
+	if ($polyOrder < 0 or $polyOrder != floor($polyOrder) or $polyOrder >= $width){croak "Error: \$polyOrder must be a non-negative integer less than 2*\$halfWidth+1.\n"}
+
+	my $offsets	= sequence($width)-$halfWidth;
+	my $As		= $offsets->dummy(0,$polyOrder+1)**sequence($polyOrder+1);
+	my $Ps		= $As x minv($As->transpose x $As) x $As->transpose;
+		# Row ii gives the weights that evaluate the window's polynomial at its ii-th point.
+
+	my $fits	= zeros($ys);
+	my $nInner	= $npts-$width+1;
+	for (my $ii=0;$ii<$width;$ii++){
+		$fits($halfWidth:$npts-$halfWidth-1,:) += $Ps($ii,$halfWidth)->sclr*$ys($ii:$ii+$nInner-1,:);
+	}
+	$fits(0:$halfWidth-1,:)		.= $ys(0:$width-1,:) x $Ps(:,0:$halfWidth-1)->transpose;
+	$fits(-$halfWidth:-1,:)		.= $ys(-$width:-1,:) x $Ps(:,-$halfWidth:-1)->transpose;
+
+	my $fit = sqrt(sumover(($ys-$fits)**2));
+
+	return ($fit,$fits);
+}
+
+
 sub test {
 
 	#my $xs = sequence(7)**2;
@@ -140,7 +263,30 @@ sub test {
 	die;
 }
 
+
+sub testqr {
+
+	## Compares fourfitqr() with fourfit() on the driver grids the control panels use by default: the cast defaults (0.5 secs, order 8), and the shipped RHexCast3D.prefs (1 sec, order 13).  The basis is nearly degenerate on both, since the times are in raw seconds, so the least squares fit is only defined to within the jiggle the basis can't follow, and the normal equations in fourfit() resolve it less well.  We check that fourfitqr() leaves no more residual than fourfit() does, and that the two fits differ by less than that residual.
+
+	foreach my $case ([0.5,8,101],[1.0,13,101],[1.0,13,1001]){
+		my ($endTime,$order,$npts) = @$case;
+
+		my $xs	= $endTime*sequence($npts)/($npts-1);
+		my $ys	= (10*$xs**2)->glue(1,sin(3*$xs/$endTime))->glue(1,exp(-$xs/$endTime));
+		$ys		+= 0.01*sin(97*$xs/$endTime);	# Some jiggle.
+
+		my ($fit,$fits)		= fourfit($xs,$ys,$order);
+		my ($fitqr,$fitsqr)	= fourfitqr($xs,$ys,$order);
+
+		my $diffs	= sqrt(sumover(($fitsqr-$fits)**2));
+		pq($endTime,$order,$npts,$fit,$fitqr,$diffs);
+		if (!all($fitqr <= $fit*(1+1e-6)) or !all($diffs < $fit)){die "fourfitqr() does not agree with fourfit().\n"}
+	}
+	print "fourfitqr() agrees with fourfit().\n";
+}
+
 #test();
+#testqr();
 
 return 1;
 
@@ -157,6 +303,8 @@ use RUtils::LSFit;
 	($fit,$fits,$coeffs) = lsfit($ys,$fs);
 	($fit,$fits,$coeffs) = fourfit($xs,$ys,$order);
 	$fits = fourfitvals($coeffs,$xs);
+	($fit,$fits,$coeffs) = fourfitqr($xs,$ys,$order);
+	($fit,$fits) = sgsmooth($ys,$halfWidth,$polyOrder);
 
 =head1 DESCRIPTION
 
@@ -164,7 +312,7 @@ For smoothing jiggly data.  A wrapper for PDL::Fit::Linfit that gives a least sq
 
 =head2 EXPORT
 
-lsfit fourfit fourfitvals
+lsfit fourfit fourfitvals fourbasis fourfitqr sgsmooth
 
 =head1 AUTHOR
 